@@ -0,0 +1,53 @@
+// Contour
+
+#pragma once
+
+#include <vector>
+
+#include "mathematics.h"
+
+class Contour
+{
+protected:
+  std::vector<Vector> p; //!< Vertices.
+  bool closed = false;   //!< Closed flag, the last vertex is connected to the first one.
+public:
+  //! Empty.
+  Contour() {}
+  explicit Contour(const std::vector<Vector>&, bool);
+
+  //! Empty.
+  ~Contour() {}
+
+  Vector operator[] (int) const;
+  int Size() const;
+  bool Closed() const;
+  double Length() const;
+
+  static void Chain(const std::vector<long long>&, const std::vector<Vector>&, std::vector<Contour>&);
+};
+
+/*!
+\brief Return the i-th vertex.
+\param i Index.
+*/
+inline Vector Contour::operator[] (int i) const
+{
+  return p[i];
+}
+
+/*!
+\brief Return the number of vertices.
+*/
+inline int Contour::Size() const
+{
+  return int(p.size());
+}
+
+/*!
+\brief Check if the contour is closed.
+*/
+inline bool Contour::Closed() const
+{
+  return closed;
+}
@@ -0,0 +1,104 @@
+// Time-varying implicits
+
+#pragma once
+
+#include <vector>
+
+#include "implicits.h"
+
+class AnimatedScalarField : public AnalyticScalarField
+{
+protected:
+  double time = 0.0; //!< Current time.
+public:
+  AnimatedScalarField();
+  virtual double Value(const Vector&, double) const;
+  double Value(const Vector&) const override;
+
+  void SetTime(double);
+  double Time() const;
+};
+
+/*!
+\brief Compute the value of the field at the current time.
+\param p Point.
+*/
+inline double AnimatedScalarField::Value(const Vector& p) const
+{
+  return Value(p, time);
+}
+
+/*!
+\brief Set the current time.
+
+Functions inherited from AnalyticScalarField, such as AnalyticScalarField::Normal(), are evaluated at the current time.
+\param t Time.
+*/
+inline void AnimatedScalarField::SetTime(double t)
+{
+  time = t;
+}
+
+/*!
+\brief Return the current time.
+*/
+inline double AnimatedScalarField::Time() const
+{
+  return time;
+}
+
+class AnimationPolygonizer
+{
+protected:
+  AnimatedScalarField& field; //!< Animated field.
+  Box box;                    //!< Polygonized region.
+  int n;                      //!< Number of cells along every axis.
+  int dilation;               //!< Number of rings of cells around the previous surface that are searched.
+  Vector d;                   //!< Diagonal of a cell.
+
+  std::vector<long long> active; //!< Cells straddling the surface at the previous frame.
+  std::vector<long long> queue;  //!< Cells to be processed.
+  int frame = 0;              //!< Stamp of the current frame.
+  std::vector<int> visited;   //!< Stamps of the cells, a cell was queued during the current frame if its stamp is the frame stamp.
+  std::vector<int> sampled;   //!< Stamps of the corners, the value of a corner is valid if its stamp is the frame stamp.
+  std::vector<double> values; //!< Field values at the corners.
+  std::vector<int> stamps;    //!< Stamps of the edges, the vertex of an edge is valid if its stamp is the frame stamp.
+  std::vector<int> edges;     //!< Vertices on the edges, three edges per corner.
+  int samples = 0;            //!< Number of field samples at the corners during the current frame.
+
+  std::vector<Vector> vertex; //!< Vertices.
+  std::vector<Vector> normal; //!< Normals.
+  std::vector<int> triangle;  //!< Triangles.
+public:
+  explicit AnimationPolygonizer(AnimatedScalarField&, const Box&, int, int = 1);
+
+  //! Empty.
+  ~AnimationPolygonizer() {}
+
+  void Polygonize(double, Mesh&, const double& = 1e-4);
+  void Reset();
+
+  int ActiveCells() const;
+  int Samples() const;
+protected:
+  double Sample(int, int, int);
+  int Edge(int, int, int, int, const double&);
+  void Cell(long long, const double&);
+  void Visit(long long);
+};
+
+/*!
+\brief Return the number of cells straddling the surface at the last frame.
+*/
+inline int AnimationPolygonizer::ActiveCells() const
+{
+  return int(active.size());
+}
+
+/*!
+\brief Return the number of field samples at the cell corners computed at the last frame.
+*/
+inline int AnimationPolygonizer::Samples() const
+{
+  return samples;
+}
@@ -0,0 +1,86 @@
+// Multiresolution chunked polygonization
+
+#pragma once
+
+#include <vector>
+
+#include "implicits.h"
+
+class ChunkedPolygonizer
+{
+protected:
+  const AnalyticScalarField& field; //!< Polygonized field.
+  Box box;                          //!< Region covered by the chunks.
+  int cx, cy, cz;                   //!< Number of chunks along every axis.
+  int n;                            //!< Number of cells along every axis of a chunk at the finest level.
+  int levels;                       //!< Number of resolution levels.
+  Vector h;                         //!< Finest lattice step.
+  std::vector<int> level;           //!< Resolution level of every chunk.
+public:
+  explicit ChunkedPolygonizer(const AnalyticScalarField&, const Box&, int, int, int, int, int = 4);
+
+  //! Empty.
+  ~ChunkedPolygonizer() {}
+
+  int Chunks() const;
+  int Levels() const;
+  int Level(int, int, int) const;
+  void SetLevel(int, int, int, int);
+  void SetLevels(const Vector&, double);
+  void Balance();
+
+  Box GetBox(int, int, int) const;
+
+  void Polygonize(std::vector<Mesh>&, const double& = 1e-4) const;
+  void Polygonize(int, int, int, Mesh&, const double& = 1e-4) const;
+protected:
+  int Index(int, int, int) const;
+  Vector Vertex(int, int, int) const;
+  int SampleLevel(int, int, int) const;
+  double Sample(int, int, int, int) const;
+
+  static bool OnFace(int, int, int);
+};
+
+/*!
+\brief Return the total number of chunks.
+*/
+inline int ChunkedPolygonizer::Chunks() const
+{
+  return cx * cy * cz;
+}
+
+/*!
+\brief Return the number of resolution levels.
+*/
+inline int ChunkedPolygonizer::Levels() const
+{
+  return levels;
+}
+
+/*!
+\brief Compute the index of a chunk in the level array.
+\param i,j,k Integer coordinates of the chunk.
+*/
+inline int ChunkedPolygonizer::Index(int i, int j, int k) const
+{
+  return (k * cy + j) * cx + i;
+}
+
+/*!
+\brief Return the resolution level of a chunk, 0 being the finest.
+\param i,j,k Integer coordinates of the chunk.
+*/
+inline int ChunkedPolygonizer::Level(int i, int j, int k) const
+{
+  return level[Index(i, j, k)];
+}
+
+/*!
+\brief Compute a vertex of the finest lattice.
+\param x,y,z Global integer coordinates.
+*/
+inline Vector ChunkedPolygonizer::Vertex(int x, int y, int z) const
+{
+  return box[0] + Vector(x * h[0], y * h[1], z * h[2]);
+}
@@ -0,0 +1,68 @@
+// Sharded polygonization
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "implicits.h"
+
+class ShardedPolygonizer
+{
+protected:
+  const AnalyticScalarField& field; //!< Polygonized field.
+  Box box;                          //!< Polygonized region.
+  int n;                            //!< Number of cells along every axis.
+  int shards;                       //!< Number of shards.
+  Vector d;                         //!< Diagonal of a cell.
+
+  std::vector<int> workers;         //!< Process identifiers of the workers, empty if shards are processed by the calling process.
+  std::vector<int> commands;        //!< Pipes sending the shards to the workers.
+  std::vector<int> replies;         //!< Pipes receiving the status of the shards from the workers.
+public:
+  explicit ShardedPolygonizer(const AnalyticScalarField&, const Box&, int, int);
+  ShardedPolygonizer(const ShardedPolygonizer&) = delete;
+  ShardedPolygonizer& operator=(const ShardedPolygonizer&) = delete;
+  ~ShardedPolygonizer();
+
+  bool Spawn();
+  void Stop();
+  int Workers() const;
+
+  int Shards() const;
+  Box GetBox(int) const;
+
+  void Polygonize(int, Mesh&, std::vector<long long>&, const double& = 1e-4) const;
+  bool Polygonize(int, const std::string&, const double& = 1e-4) const;
+  bool Polygonize(Mesh&, const std::string&, const double& = 1e-4) const;
+
+  static bool Merge(const std::vector<std::string>&, Mesh&);
+protected:
+  int Layer(int) const;
+  void Serve(int, int) const;
+};
+
+/*!
+\brief Return the number of worker processes, zero if shards are processed by the calling process.
+*/
+inline int ShardedPolygonizer::Workers() const
+{
+  return int(workers.size());
+}
+
+/*!
+\brief Return the number of shards.
+*/
+inline int ShardedPolygonizer::Shards() const
+{
+  return shards;
+}
+
+/*!
+\brief Compute the first cell layer of a shard.
+\param s Shard index, the number of shards gives the end of the last shard.
+*/
+inline int ShardedPolygonizer::Layer(int s) const
+{
+  return int((long long)(s) * n / shards);
+}
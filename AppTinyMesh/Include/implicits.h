@@ -8,6 +8,9 @@
 
 class AnalyticScalarField
 {
+  friend class ChunkedPolygonizer;
+  friend class AnimationPolygonizer;
+  friend class ShardedPolygonizer;
 protected:
 public:
   AnalyticScalarField();
@@ -21,6 +24,17 @@ public:
   Vector Dichotomy(Vector, Vector, double, double, double, const double& = 1.0e-4) const;
 
   virtual void Polygonize(int, Mesh&, const Box&, const double& = 1e-4) const;
+
+  // Cross-sections
+  void Slice(int, std::vector<Contour>&, const Box&, const Vector&, const Vector&) const;
+  void Slice(int, std::vector<std::vector<Contour>>&, const Box&, const Vector&, const Vector&, double, int) const;
+
+  // Ray intersection
+  virtual double K() const;
+  virtual double Distance(const Vector&) const;
+  bool Intersect(const Ray&, double&, const double& = 1.0e3, const double& = 1.0e-4) const;
+protected:
+  void SliceGrid(int, std::vector<Contour>&, const Vector&, const Vector&, const Vector&) const;
 protected:
   static const double Epsilon; //!< Epsilon value for partial derivatives
 protected:
@@ -0,0 +1,62 @@
+// Memory mapped file
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+protected:
+  const char* data = nullptr; //!< Mapped bytes.
+  size_t size = 0;            //!< Size in bytes.
+#ifdef _WIN32
+  void* file = nullptr;       //!< File handle.
+  void* mapping = nullptr;    //!< File mapping handle.
+#else
+  int file = -1;              //!< File descriptor.
+#endif
+public:
+  //! Empty.
+  MappedFile() {}
+  explicit MappedFile(const std::string&);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool Open(const std::string&);
+  void Close();
+
+  bool IsOpen() const;
+  const char* Data() const;
+  size_t Size() const;
+};
+
+/*!
+\brief Check if a file is mapped.
+*/
+inline bool MappedFile::IsOpen() const
+{
+#ifdef _WIN32
+  return file != nullptr;
+#else
+  return file != -1;
+#endif
+}
+
+/*!
+\brief Return the mapped bytes, the pointer is null for empty files.
+*/
+inline const char* MappedFile::Data() const
+{
+  return data;
+}
+
+/*!
+\brief Return the size of the file in bytes.
+*/
+inline size_t MappedFile::Size() const
+{
+  return size;
+}
@@ -0,0 +1,75 @@
+// Bounding volume hierarchy of triangle meshes
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+#include "triangle-packet.h"
+#include "ray-packet.h"
+
+/*!
+\brief Node of the hierarchy, 32 bytes.
+
+Inner nodes reference their two children, which are adjacent in the array of nodes, and leaves reference a packet of triangles.
+*/
+class MeshBvhNode
+{
+public:
+  float a[3]; //!< Lower vertex of the box.
+  int index;  //!< First child for inner nodes, packet for leaves.
+  float b[3]; //!< Upper vertex of the box.
+  int count;  //!< Number of triangles of leaves, 0 for inner nodes.
+};
+
+class MeshBvh
+{
+public:
+  static const int Leaf = TrianglePacket::Width; //!< Maximum number of triangles in a leaf.
+  static const int Depth = 64;                   //!< Maximum depth of the hierarchy, which is also the size of the traversal stack.
+protected:
+  std::vector<MeshBvhNode> nodes;      //!< Nodes, the root is the first one.
+  std::vector<TrianglePacket> packets; //!< Triangles of the leaves.
+  std::vector<int> triangles;          //!< Triangle indexes of the mesh in the packets, -1 for unused slots.
+public:
+  explicit MeshBvh(const Mesh&);
+
+  //! Empty.
+  ~MeshBvh() {}
+
+  int Nodes() const;
+  int Packets() const;
+  const MeshBvhNode& Node(int) const;
+
+  bool Intersect(const Ray&, double&, int&, double&, double&) const;
+  bool Occluded(const Ray&, double) const;
+
+  // Coherent rays
+  void Intersect(const Ray*, int, MeshHit*) const;
+  void Intersect(const std::vector<Ray>&, std::vector<MeshHit>&) const;
+};
+
+/*!
+\brief Return the number of nodes.
+*/
+inline int MeshBvh::Nodes() const
+{
+  return int(nodes.size());
+}
+
+/*!
+\brief Return the number of packets of triangles, which is the number of leaves.
+*/
+inline int MeshBvh::Packets() const
+{
+  return int(packets.size());
+}
+
+/*!
+\brief Return a node.
+\param i Index, 0 for the root.
+*/
+inline const MeshBvhNode& MeshBvh::Node(int i) const
+{
+  return nodes[i];
+}
@@ -0,0 +1,160 @@
+// Native binary mesh files
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "meshcolor.h"
+#include "mapped-file.h"
+
+class MeshCache
+{
+public:
+  static const uint32_t Version = 1; //!< Version of the file format.
+protected:
+  //! Arrays stored in the file.
+  enum Array { VertexArray, NormalArray, VertexIndexArray, NormalIndexArray, ColorArray, ColorIndexArray, Arrays };
+
+  /*!
+  \brief Header of the file, followed by the arrays aligned on 64 bytes.
+  */
+  struct Header
+  {
+    char magic[8];             //!< Magic string.
+    uint32_t version;          //!< Version.
+    uint32_t endian;           //!< Byte order marker.
+    uint64_t size[Arrays];     //!< Number of elements of every array.
+    uint64_t offset[Arrays];   //!< Offsets of the arrays in the file.
+    uint64_t checksum;         //!< Checksum of the arrays.
+    uint64_t check;            //!< Checksum of the header, excluding this field.
+  };
+
+  MappedFile file;             //!< Mapped file.
+  const Header* header = nullptr; //!< Header of the mapped file.
+public:
+  //! Empty.
+  MeshCache() {}
+  //! Empty.
+  ~MeshCache() {}
+
+  bool Open(const std::string&, bool = false);
+  void Close();
+  bool Validate() const;
+
+  int Vertexes() const;
+  int Normals() const;
+  int Triangles() const;
+  int Colors() const;
+  const Vector* GetVertices() const;
+  const Vector* GetNormals() const;
+  const int* GetVertexIndexes() const;
+  const int* GetNormalIndexes() const;
+  const Color* GetColors() const;
+  const int* GetColorIndexes() const;
+
+  Mesh GetMesh() const;
+  MeshColor GetMeshColor() const;
+
+  static bool Save(const std::string&, const Mesh&);
+  static bool Save(const std::string&, const MeshColor&);
+  static uint64_t Checksum(const char*, uint64_t);
+protected:
+  static bool Save(const std::string&, const Mesh&, const std::vector<Color>&, const std::vector<int>&);
+  const void* Data(Array) const;
+};
+
+/*!
+\brief Return the number of vertices, zero if no file is open.
+*/
+inline int MeshCache::Vertexes() const
+{
+  return header == nullptr ? 0 : int(header->size[VertexArray]);
+}
+
+/*!
+\brief Return the number of normals.
+*/
+inline int MeshCache::Normals() const
+{
+  return header == nullptr ? 0 : int(header->size[NormalArray]);
+}
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int MeshCache::Triangles() const
+{
+  return header == nullptr ? 0 : int(header->size[VertexIndexArray] / 3);
+}
+
+/*!
+\brief Return the number of colors, zero if the file does not store colors.
+*/
+inline int MeshCache::Colors() const
+{
+  return header == nullptr ? 0 : int(header->size[ColorArray]);
+}
+
+/*!
+\brief Return a pointer to an array of the mapped file, null if no file is open.
+\param a Array.
+*/
+inline const void* MeshCache::Data(Array a) const
+{
+  if (header == nullptr)
+    return nullptr;
+  return file.Data() + header->offset[a];
+}
+
+/*!
+\brief Return the vertices, stored in the mapped file.
+*/
+inline const Vector* MeshCache::GetVertices() const
+{
+  return (const Vector*)Data(VertexArray);
+}
+
+/*!
+\brief Return the normals, stored in the mapped file.
+*/
+inline const Vector* MeshCache::GetNormals() const
+{
+  return (const Vector*)Data(NormalArray);
+}
+
+/*!
+\brief Return the vertex indexes, stored in the mapped file.
+*/
+inline const int* MeshCache::GetVertexIndexes() const
+{
+  return (const int*)Data(VertexIndexArray);
+}
+
+/*!
+\brief Return the normal indexes, stored in the mapped file, which are the vertex indexes if they are shared.
+*/
+inline const int* MeshCache::GetNormalIndexes() const
+{
+  if (header == nullptr)
+    return nullptr;
+  return (const int*)Data(header->size[NormalIndexArray] == 0 ? VertexIndexArray : NormalIndexArray);
+}
+
+/*!
+\brief Return the colors, stored in the mapped file.
+*/
+inline const Color* MeshCache::GetColors() const
+{
+  return (const Color*)Data(ColorArray);
+}
+
+/*!
+\brief Return the color indexes, stored in the mapped file, which are the vertex indexes if they are shared.
+*/
+inline const int* MeshCache::GetColorIndexes() const
+{
+  if (header == nullptr)
+    return nullptr;
+  return (const int*)Data(header->size[ColorIndexArray] == 0 ? VertexIndexArray : ColorIndexArray);
+}
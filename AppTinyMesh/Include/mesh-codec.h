@@ -0,0 +1,52 @@
+// Compressed meshes
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+class MeshCodec
+{
+protected:
+  int bits = 16;         //!< Number of bits per quantized coordinate.
+  size_t raw = 0;        //!< Size of the arrays of the last encoded or decoded mesh.
+  size_t compressed = 0; //!< Size of the last encoded or decoded data.
+  double time = 0.0;     //!< Time of the last decoding, in seconds.
+public:
+  explicit MeshCodec(int = 16);
+
+  //! Empty.
+  ~MeshCodec() {}
+
+  void Encode(const Mesh&, std::vector<char>&);
+  bool Decode(const char*, size_t, Mesh&);
+
+  bool Save(const std::string&, const Mesh&);
+  bool Load(const std::string&, Mesh&);
+
+  double Ratio() const;
+  double Throughput() const;
+protected:
+  static void Order(const std::vector<int>&, int, std::vector<int>&, std::vector<int>&);
+  static void Octahedral(const Vector&, int16_t[2]);
+  static Vector Octahedral(const int16_t[2]);
+};
+
+/*!
+\brief Return the compression ratio of the last encoded or decoded mesh, which is the size of the arrays of the mesh divided by the size of the compressed data.
+*/
+inline double MeshCodec::Ratio() const
+{
+  return compressed == 0 ? 0.0 : double(raw) / double(compressed);
+}
+
+/*!
+\brief Return the throughput of the last decoding, in gigabytes of mesh arrays per second.
+*/
+inline double MeshCodec::Throughput() const
+{
+  return time == 0.0 ? 0.0 : double(raw) / time * 1.0e-9;
+}
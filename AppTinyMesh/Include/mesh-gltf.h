@@ -0,0 +1,37 @@
+// glTF 2.0 binary files
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "meshcolor.h"
+
+class MeshGltf
+{
+protected:
+  /*!
+  \brief A mesh of the scene, colors are null for meshes without colors.
+  */
+  struct Entry
+  {
+    const Mesh* mesh;                  //!< Mesh.
+    const std::vector<Color>* colors;  //!< Colors.
+    const std::vector<int>* carray;    //!< Color indexes.
+    std::string name;                  //!< Name.
+  };
+
+  std::vector<Entry> entries; //!< Meshes of the scene, which are referenced and not copied.
+public:
+  //! Empty.
+  MeshGltf() {}
+  //! Empty.
+  ~MeshGltf() {}
+
+  void Add(const Mesh&, const std::string& = "mesh");
+  void Add(const MeshColor&, const std::string& = "mesh");
+  void Clear();
+  bool Save(const std::string&) const;
+
+  static bool Load(const std::string&, std::vector<MeshColor>&, std::vector<std::string>* = nullptr);
+};
@@ -0,0 +1,67 @@
+// Levels of detail of meshes
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mesh.h"
+
+class MeshLod
+{
+public:
+  static const uint32_t Version = 2;        //!< Version of the file format.
+  static constexpr double Tolerance = 0.02; //!< Largest error of a level, relative to the diagonal of the box of the mesh.
+protected:
+  std::vector<Mesh> levels;   //!< Simplified meshes, from the finest to the coarsest.
+  std::vector<double> errors; //!< Geometric error of every level, increasing.
+  int vertexes = 0;           //!< Number of vertices of the mesh the levels were generated from.
+  int triangles = 0;          //!< Number of triangles of the mesh.
+  uint64_t checksum = 0;      //!< Checksum of the vertices and the vertex indexes of the mesh.
+public:
+  //! Empty.
+  MeshLod() {}
+  explicit MeshLod(const Mesh&, int = 6, double = 0.25);
+
+  //! Empty.
+  ~MeshLod() {}
+
+  int Levels() const;
+  const Mesh& Level(int) const;
+  double Error(int) const;
+  int Select(double) const;
+  static int Select(const std::vector<double>&, double);
+  bool Source(const Mesh&) const;
+
+  bool Save(const std::string&) const;
+  bool Load(const std::string&);
+protected:
+  static uint64_t Checksum(const Mesh&);
+};
+
+/*!
+\brief Return the number of levels, excluding the original mesh.
+*/
+inline int MeshLod::Levels() const
+{
+  return int(levels.size());
+}
+
+/*!
+\brief Return a level.
+\param i Level, between 0 for the finest and the number of levels minus 1 for the coarsest.
+*/
+inline const Mesh& MeshLod::Level(int i) const
+{
+  return levels[i];
+}
+
+/*!
+\brief Return the geometric error of a level, in the units of the mesh.
+\param i Level.
+*/
+inline double MeshLod::Error(int i) const
+{
+  return errors[i];
+}
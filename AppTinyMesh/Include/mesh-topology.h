@@ -0,0 +1,275 @@
+// Topology of triangle meshes
+
+#pragma once
+
+#include <vector>
+
+#include "mesh.h"
+
+class MeshTopology
+{
+protected:
+  std::vector<int> varray;       //!< Vertex indexes, the origin of every half-edge.
+  std::vector<int> vstart;       //!< Offsets of the corners of the vertices.
+  std::vector<int> vcorner;      //!< Corners of the vertices.
+  std::vector<int> twin;         //!< Opposite half-edge, -1 on boundary and non-manifold edges.
+  std::vector<int> edge;         //!< Edge of every half-edge.
+  std::vector<int> estart;       //!< Offsets of the half-edges of the edges.
+  std::vector<int> ehalf;        //!< Half-edges of the edges.
+  std::vector<unsigned char> flags; //!< Boundary and non-manifold flags of the vertices.
+  int boundary = 0;              //!< Number of boundary edges.
+  int singular = 0;              //!< Number of non-manifold edges.
+  int nonmanifold = 0;           //!< Number of non-manifold vertices.
+public:
+  explicit MeshTopology(const Mesh&);
+
+  //! Empty.
+  ~MeshTopology() {}
+
+  int Vertexes() const;
+  int Triangles() const;
+  int HalfEdges() const;
+  int Edges() const;
+
+  // Half-edges
+  static int Next(int);
+  static int Prev(int);
+  static int Face(int);
+  int Origin(int) const;
+  int Target(int) const;
+  int Twin(int) const;
+  int Edge(int) const;
+
+  // Vertices
+  int Valence(int) const;
+  int Corner(int, int) const;
+  void Neighbors(int, std::vector<int>&) const;
+  bool IsBoundaryVertex(int) const;
+  bool IsManifoldVertex(int) const;
+
+  // Edges
+  int EdgeFaces(int) const;
+  int EdgeHalfEdge(int, int) const;
+  bool IsBoundaryEdge(int) const;
+  bool IsManifoldEdge(int) const;
+
+  int BoundaryEdges() const;
+  int NonManifoldEdges() const;
+  int NonManifoldVertices() const;
+  bool IsManifold() const;
+  bool IsClosed() const;
+protected:
+  //! Flags of the vertices.
+  enum { Boundary = 1, NonManifold = 2 };
+};
+
+/*!
+\brief Return the number of vertices.
+*/
+inline int MeshTopology::Vertexes() const
+{
+  return int(vstart.size()) - 1;
+}
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int MeshTopology::Triangles() const
+{
+  return int(varray.size()) / 3;
+}
+
+/*!
+\brief Return the number of half-edges, which is three times the number of triangles.
+*/
+inline int MeshTopology::HalfEdges() const
+{
+  return int(varray.size());
+}
+
+/*!
+\brief Return the number of edges.
+*/
+inline int MeshTopology::Edges() const
+{
+  return int(estart.size()) - 1;
+}
+
+/*!
+\brief Return the next half-edge in the same triangle.
+
+Half-edge h goes from the vertex of corner h to the vertex of the next corner of the triangle.
+\param h Half-edge.
+*/
+inline int MeshTopology::Next(int h)
+{
+  return (h % 3 == 2) ? h - 2 : h + 1;
+}
+
+/*!
+\brief Return the previous half-edge in the same triangle.
+\param h Half-edge.
+*/
+inline int MeshTopology::Prev(int h)
+{
+  return (h % 3 == 0) ? h + 2 : h - 1;
+}
+
+/*!
+\brief Return the triangle of a half-edge.
+\param h Half-edge.
+*/
+inline int MeshTopology::Face(int h)
+{
+  return h / 3;
+}
+
+/*!
+\brief Return the origin vertex of a half-edge.
+\param h Half-edge.
+*/
+inline int MeshTopology::Origin(int h) const
+{
+  return varray[h];
+}
+
+/*!
+\brief Return the target vertex of a half-edge.
+\param h Half-edge.
+*/
+inline int MeshTopology::Target(int h) const
+{
+  return varray[Next(h)];
+}
+
+/*!
+\brief Return the opposite half-edge, -1 if the edge is on the boundary or non-manifold.
+\param h Half-edge.
+*/
+inline int MeshTopology::Twin(int h) const
+{
+  return twin[h];
+}
+
+/*!
+\brief Return the edge of a half-edge.
+\param h Half-edge.
+*/
+inline int MeshTopology::Edge(int h) const
+{
+  return edge[h];
+}
+
+/*!
+\brief Return the number of triangles incident to a vertex.
+\param v Vertex.
+*/
+inline int MeshTopology::Valence(int v) const
+{
+  return vstart[v + 1] - vstart[v];
+}
+
+/*!
+\brief Return a corner of a vertex, which is also its outgoing half-edge in the triangle of the corner.
+\param v Vertex.
+\param i Index of the corner, between 0 and the valence of the vertex.
+*/
+inline int MeshTopology::Corner(int v, int i) const
+{
+  return vcorner[vstart[v] + i];
+}
+
+/*!
+\brief Check if a vertex is on the boundary.
+\param v Vertex.
+*/
+inline bool MeshTopology::IsBoundaryVertex(int v) const
+{
+  return (flags[v] & Boundary) != 0;
+}
+
+/*!
+\brief Check if the triangles around a vertex form a single fan, and that its edges are manifold.
+\param v Vertex.
+*/
+inline bool MeshTopology::IsManifoldVertex(int v) const
+{
+  return (flags[v] & NonManifold) == 0;
+}
+
+/*!
+\brief Return the number of triangles sharing an edge.
+\param e Edge.
+*/
+inline int MeshTopology::EdgeFaces(int e) const
+{
+  return estart[e + 1] - estart[e];
+}
+
+/*!
+\brief Return a half-edge of an edge.
+\param e Edge.
+\param i Index of the half-edge, between 0 and the number of triangles sharing the edge.
+*/
+inline int MeshTopology::EdgeHalfEdge(int e, int i) const
+{
+  return ehalf[estart[e] + i];
+}
+
+/*!
+\brief Check if an edge is on the boundary, with a single triangle.
+\param e Edge.
+*/
+inline bool MeshTopology::IsBoundaryEdge(int e) const
+{
+  return EdgeFaces(e) == 1;
+}
+
+/*!
+\brief Check if an edge is manifold, with one triangle or two triangles with consistent orientations.
+\param e Edge.
+*/
+inline bool MeshTopology::IsManifoldEdge(int e) const
+{
+  return EdgeFaces(e) == 1 || twin[ehalf[estart[e]]] != -1;
+}
+
+/*!
+\brief Return the number of boundary edges.
+*/
+inline int MeshTopology::BoundaryEdges() const
+{
+  return boundary;
+}
+
+/*!
+\brief Return the number of non-manifold edges.
+*/
+inline int MeshTopology::NonManifoldEdges() const
+{
+  return singular;
+}
+
+/*!
+\brief Return the number of non-manifold vertices.
+*/
+inline int MeshTopology::NonManifoldVertices() const
+{
+  return nonmanifold;
+}
+
+/*!
+\brief Check if the mesh is manifold, with manifold edges and vertices.
+*/
+inline bool MeshTopology::IsManifold() const
+{
+  return singular == 0 && nonmanifold == 0;
+}
+
+/*!
+\brief Check if the mesh is closed, without boundary edges.
+*/
+inline bool MeshTopology::IsClosed() const
+{
+  return boundary == 0;
+}
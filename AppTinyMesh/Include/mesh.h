@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <string>
+
 #include "box.h"
 #include "sphere.h"
 #include "ray.h"
@@ -8,6 +11,7 @@
 #include "torus.h"
 #include "mathematics.h"
 #include "matrix.h"
+#include "contour.h"
 
 // Triangle
 class Triangle
@@ -84,6 +88,39 @@ inline Triangle::Triangle(const Vector& a, const Vector& b, const Vector& c)
 
 
 class QString;
+class MeshTopology;
+class MeshBvh;
+class MeshLod;
+
+// Statistics of an imported .obj file
+class ObjReport
+{
+public:
+  int lines = 0;     //!< Number of lines that could not be parsed.
+  int triangles = 0; //!< Number of triangles dropped because of invalid vertex indexes.
+  int polygons = 0;  //!< Number of faces with more than three corners that were triangulated.
+  int normals = 0;   //!< Number of face corners without a valid normal, smooth normals were computed for them.
+  int ignored = 0;   //!< Number of lines with unsupported keywords, such as texture coordinates, groups or materials.
+};
+
+// Statistics of the vertex cache optimization
+class CacheReport
+{
+public:
+  double before = 0.0; //!< Average cache miss ratio before the optimization.
+  double after = 0.0;  //!< Average cache miss ratio after the optimization.
+  int clusters = 0;    //!< Number of clusters sorted to reduce overdraw, 0 if overdraw was not optimized.
+};
+
+// Closest intersection of a ray with a mesh
+class MeshHit
+{
+public:
+  double t = 0.0;    //!< Intersection depth.
+  int triangle = -1; //!< Intersected triangle, -1 if the ray missed the mesh.
+  double u = 0.0;    //!< First parametric coordinate in the triangle.
+  double v = 0.0;    //!< Second parametric coordinate in the triangle.
+};
 
 class Mesh
 {
@@ -91,18 +128,36 @@ protected:
   std::vector<Vector> vertices; //!< Vertices.
   std::vector<Vector> normals;  //!< Normals.
   std::vector<int> varray;		//!< Vertex indexes.
-  std::vector<int> narray;		//!< Normal indexes.
+  std::vector<int> narray;		//!< Normal indexes, empty if normals share the vertex indexes.
+  mutable std::shared_ptr<const MeshTopology> topology; //!< Cached topology, built on demand.
+  mutable std::shared_ptr<const MeshBvh> bvh; //!< Cached bounding volume hierarchy, built on demand.
+  std::shared_ptr<const MeshLod> lod; //!< Levels of detail, null if they were not generated.
+
+  friend class MeshCache;
+  friend class MeshGltf;
+  friend class MeshTopology;
+  friend class MeshBvh;
+  friend class MeshCodec;
+  friend class MeshLod;
 
 public:
   explicit Mesh();
   explicit Mesh(const std::vector<Vector>&, const std::vector<int>&);
+  explicit Mesh(const std::vector<Vector>&, const std::vector<Vector>&, const std::vector<int>&);
   explicit Mesh(const std::vector<Vector>&, const std::vector<Vector>&, const std::vector<int>&, const std::vector<int>&);
+  explicit Mesh(std::vector<Vector>&&, std::vector<Vector>&&, std::vector<int>&&);
+  explicit Mesh(std::vector<Vector>&&, std::vector<Vector>&&, std::vector<int>&&, std::vector<int>&&);
+  Mesh(const Mesh&) = default;
+  Mesh(Mesh&&) = default;
   explicit Mesh(const Box&);
   explicit Mesh(const Sphere&, int n);
   explicit Mesh(const Disc& d, int n);
   explicit Mesh(const Cylinder& c, int n);
   explicit Mesh(const Torus& torus, int n, int slice);
-  ~Mesh();
+  virtual ~Mesh();
+
+  Mesh& operator=(const Mesh&) = default;
+  Mesh& operator=(Mesh&&) = default;
 
   void Reserve(int, int, int, int);
   Triangle GetTriangle(int) const;
@@ -111,16 +166,27 @@ public:
   Vector Normal(int) const;
   int Triangles() const;
   int Vertexes() const;
-  std::vector<int> VertexIndexes() const;
-  std::vector<int> NormalIndexes() const;
+  const std::vector<int>& VertexIndexes() const;
+  const std::vector<int>& NormalIndexes() const;
   int VertexIndex(int, int) const;
   int NormalIndex(int, int) const;
+  bool SharedIndexes() const;
+  bool ShareIndexes();
   Vector operator[](int) const;
   Box GetBox() const;
-  void SmoothNormals();
+  void SmoothNormals(bool = false);
+  const MeshTopology& Topology() const;
+  const MeshBvh& Bvh() const;
 
   void Load(const QString&);
-  void SaveObj(const QString&, const QString&) const;
+  bool LoadObj(const std::string&, ObjReport* = nullptr);
+  bool SaveObj(const std::string&, const std::string& = "mesh") const;
+  bool LoadPly(const std::string&);
+  bool SavePly(const std::string&, bool = true) const;
+  bool LoadStl(const std::string&, double = 0.0);
+  bool SaveStl(const std::string&) const;
+  bool LoadGlb(const std::string&);
+  bool SaveGlb(const std::string&) const;
 
   // Affine transformations
   void Rotate(const Matrix3& m);
@@ -130,8 +196,39 @@ public:
   // Deformation
   void SphereWarp(const Vector& c, double r, const Vector& d);
 
+  // Cross-sections
+  void Slice(const Vector&, const Vector&, std::vector<Contour>&) const;
+  void Slice(const Vector&, const Vector&, double, int, std::vector<std::vector<Contour>>&) const;
+
+  // Ray queries
+  bool Intersect(const Ray&, double&, int&, double&, double&) const;
+  bool Occluded(const Ray&, double) const;
+  void Intersect(const std::vector<Ray>&, std::vector<MeshHit>&) const;
+
+  // Simplification
+  int Simplify(int, double = -1.0, double* = nullptr);
+  int Cluster(double, bool = true);
+
+  // Ordering
+  double Acmr(int = 16) const;
+  void OptimizeCache(bool = false, CacheReport* = nullptr);
+  void SortMorton();
+
+  // Levels of detail
+  void GenerateLod(int = 6, double = 0.25);
+  const MeshLod* Lod() const;
+  bool SaveLod(const std::string&) const;
+  bool LoadLod(const std::string&);
+
 protected:
+  void UnshareIndexes();
+  void Invalidate();
+  virtual void Remap(const std::vector<int>&, int, const std::vector<int>&);
+  void VertexCorners(std::vector<int>&, std::vector<int>&) const;
+  static void Buckets(const std::vector<int>&, int, std::vector<int>&, std::vector<int>&);
+  static std::vector<int> MortonOrder(const std::vector<Vector>&, const Box&);
   void AddTriangle(int, int, int, int);
+  void FormatObj(int, int, int, std::vector<char>&) const;
   void AddSmoothTriangle(int, int, int, int, int, int);
   void AddSmoothQuadrangle(int, int, int, int, int, int, int, int);
   void AddQuadrangle(int, int, int, int);
@@ -140,17 +237,17 @@ protected:
 /*!
 \brief Return the set of vertex indexes.
 */
-inline std::vector<int> Mesh::VertexIndexes() const
+inline const std::vector<int>& Mesh::VertexIndexes() const
 {
   return varray;
 }
 
 /*!
-\brief Return the set of normal indexes.
+\brief Return the set of normal indexes, which are the vertex indexes if they are shared.
 */
-inline std::vector<int> Mesh::NormalIndexes() const
+inline const std::vector<int>& Mesh::NormalIndexes() const
 {
-  return narray;
+  return SharedIndexes() ? varray : narray;
 }
 
 /*!
@@ -170,7 +267,47 @@ inline int Mesh::VertexIndex(int t, int i) const
 */
 inline int Mesh::NormalIndex(int t, int i) const
 {
-  return narray.at(t * 3 + i);
+  return NormalIndexes().at(t * 3 + i);
+}
+
+/*!
+\brief Release the data derived from the geometry, the cached topology, the bounding volume hierarchy and the levels of detail.
+
+This should be called whenever triangles or vertices are added, removed or moved.
+*/
+inline void Mesh::Invalidate()
+{
+  topology.reset();
+  bvh.reset();
+  lod.reset();
+}
+
+/*!
+\brief Update the attributes of derived classes when vertices and triangles are renumbered, the geometry, normals and derived data are handled by the caller.
+
+It is called before the vertex indexes are replaced, so that indexes of the attributes can still be compared to them.
+\param vertex New index of every vertex, -1 if it was removed, several vertices may be merged into one.
+\param vertexes New number of vertices.
+\param triangle Former index of every new triangle.
+*/
+inline void Mesh::Remap(const std::vector<int>&, int, const std::vector<int>&)
+{
+}
+
+/*!
+\brief Return the levels of detail, null if they were not generated or loaded.
+*/
+inline const MeshLod* Mesh::Lod() const
+{
+  return lod.get();
+}
+
+/*!
+\brief Check if normals share the vertex indexes, in which case the array of normal indexes is not stored.
+*/
+inline bool Mesh::SharedIndexes() const
+{
+  return narray.size() != varray.size();
 }
 
 /*!
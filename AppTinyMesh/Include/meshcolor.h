@@ -8,17 +8,37 @@ class MeshColor : public Mesh
 {
 protected:
   std::vector<Color> colors; //!< Array of colors.
-  std::vector<int> carray;  //!< Indexes.
+  std::vector<int> carray;  //!< Indexes, empty if colors share the vertex indexes.
+
+  friend class MeshCache;
+  friend class MeshGltf;
 
 public:
   explicit MeshColor();
   explicit MeshColor(const Mesh&);
   explicit MeshColor(const Mesh&, const std::vector<Color>&, const std::vector<int>&);
+  explicit MeshColor(Mesh&&);
+  explicit MeshColor(Mesh&&, std::vector<Color>&&, std::vector<int>&&);
+  MeshColor(const MeshColor&) = default;
+  MeshColor(MeshColor&&) = default;
   ~MeshColor();
 
+  MeshColor& operator=(const MeshColor&) = default;
+  MeshColor& operator=(MeshColor&&) = default;
+
   Color GetColor(int) const;
-  std::vector<Color> GetColors() const;
-  std::vector<int> ColorIndexes() const;
+  const std::vector<Color>& GetColors() const;
+  const std::vector<int>& ColorIndexes() const;
+  bool SharedIndexes() const;
+  bool ShareIndexes();
+  bool Uniform() const;
+
+  bool LoadPly(const std::string&);
+  bool SavePly(const std::string&, bool = true) const;
+  bool LoadGlb(const std::string&);
+  bool SaveGlb(const std::string&) const;
+protected:
+  void Remap(const std::vector<int>&, int, const std::vector<int>&) override;
 };
 
 /*!
@@ -34,17 +54,25 @@ inline Color MeshColor::GetColor(int i) const
 /*!
 \brief Get the array of colors.
 */
-inline std::vector<Color> MeshColor::GetColors() const
+inline const std::vector<Color>& MeshColor::GetColors() const
 {
   return colors;
 }
 
 /*!
-\brief Return the set of color indices.
+\brief Return the set of color indices, which are the vertex indexes if they are shared.
+*/
+inline const std::vector<int>& MeshColor::ColorIndexes() const
+{
+  return carray.size() != varray.size() ? varray : carray;
+}
+
+/*!
+\brief Check if normals and colors share the vertex indexes.
 */
-inline std::vector<int> MeshColor::ColorIndexes() const
+inline bool MeshColor::SharedIndexes() const
 {
-  return carray;
+  return Mesh::SharedIndexes() && carray.size() != varray.size();
 }
 
 #endif
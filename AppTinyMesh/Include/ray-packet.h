@@ -0,0 +1,38 @@
+// Packets of coherent rays for hierarchy traversal
+
+#pragma once
+
+#include "ray.h"
+
+class RayPacket
+{
+public:
+  static const int Width = 8; //!< Maximum number of rays.
+protected:
+  alignas(32) float o[3][Width] = {};   //!< Origins, o[k][i] is the k-th coordinate of the i-th ray.
+  alignas(32) float inv[3][Width] = {}; //!< Inverses of the directions.
+  int count = 0;                        //!< Number of rays.
+  bool coherent = true;                 //!< Whether the directions have the same signs, interval culling only applies in this case.
+  float oa[3], ob[3];                   //!< Bounds of the origins.
+  float ia[3], ib[3];                   //!< Bounds of the inverses of the directions.
+  float d[3];                           //!< Sum of the directions.
+public:
+  explicit RayPacket(const Ray*, int);
+
+  //! Empty.
+  ~RayPacket() {}
+
+  int Count() const;
+
+  int Intersect(const float*, const float*, const float*) const;
+  bool Culled(const float*, const float*, float) const;
+  float Order(const float*, const float*) const;
+};
+
+/*!
+\brief Return the number of rays.
+*/
+inline int RayPacket::Count() const
+{
+  return count;
+}
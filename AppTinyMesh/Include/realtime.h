@@ -108,6 +108,9 @@ protected:
     MeshMaterial material;		//!< Render flag.
     bool useWireframe;			//!< Render flag.
 
+    std::vector<MeshGL*> levels;	//!< Levels of detail, from the finest to the coarsest.
+    std::vector<double> errors;	//!< Geometric error of the levels of detail.
+
   public:
     MeshGL();
     MeshGL(const Mesh& mesh, const Vector& position = Vector::Null);
@@ -133,6 +136,7 @@ protected:
   // Meshes
   GLuint mainShaderProgram;
   QMap<QString, MeshGL*> objects;
+  double lodTolerance = 1.0;		//!< Projected error allowed for levels of detail, in pixels.
 
   // Skybox
   GLuint skyboxShader = 0;
@@ -147,6 +151,8 @@ public:
 
   void AddMesh(const QString&, const Mesh&, const Vector & = Vector::Null);
   void AddMesh(const QString&, const MeshColor&, const Vector & = Vector::Null);
+  void AddMesh(const QString&, Mesh&&, const Vector & = Vector::Null);
+  void AddMesh(const QString&, MeshColor&&, const Vector & = Vector::Null);
   void DeleteMesh(const QString&);
   void ClearAll();
 
@@ -168,8 +174,10 @@ public:
   void UseWireframeGlobal(bool);
   void SetShading(const QString&, MeshShading);
   void SetShadingGlobal(MeshShading);
+  void SetLodTolerance(double);
 
 protected:
+  int SelectLevel(const MeshGL&) const;
   virtual void initializeGL();
   virtual void resizeGL(int, int);
   virtual void paintGL();
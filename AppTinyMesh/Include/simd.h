@@ -0,0 +1,72 @@
+// Lanes of single precision numbers for the packet kernels
+
+#pragma once
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_LANES 4
+#endif
+
+/*!
+\class SimdLanes simd.h
+\brief Single precision lanes, eight with AVX, which includes AVX2 and AVX-512 builds, and four with SSE2 on other x86 builds.
+
+SIMD_LANES is not defined on other builds, and kernels fall back to scalar code.
+*/
+
+#if SIMD_LANES == 8
+class SimdLanes
+{
+public:
+  static const int Width = 8; //!< Number of lanes.
+  typedef __m256 Real;        //!< Lanes.
+  static Real Load(const float* x) { return _mm256_load_ps(x); }
+  static void Store(float* x, Real a) { _mm256_storeu_ps(x, a); }
+  static Real Set(float x) { return _mm256_set1_ps(x); }
+  static Real Zero() { return _mm256_setzero_ps(); }
+  static Real Add(Real a, Real b) { return _mm256_add_ps(a, b); }
+  static Real Sub(Real a, Real b) { return _mm256_sub_ps(a, b); }
+  static Real Mul(Real a, Real b) { return _mm256_mul_ps(a, b); }
+  static Real Div(Real a, Real b) { return _mm256_div_ps(a, b); }
+  static Real Min(Real a, Real b) { return _mm256_min_ps(a, b); }
+  static Real Max(Real a, Real b) { return _mm256_max_ps(a, b); }
+  static Real Lt(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static Real Le(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static Real Eq(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static Real Neq(Real a, Real b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+  static Real And(Real a, Real b) { return _mm256_and_ps(a, b); }
+  static Real Or(Real a, Real b) { return _mm256_or_ps(a, b); }
+  static Real AndNot(Real a, Real b) { return _mm256_andnot_ps(a, b); }
+  static Real Xor(Real a, Real b) { return _mm256_xor_ps(a, b); }
+  static int Mask(Real a) { return _mm256_movemask_ps(a); }
+};
+#elif SIMD_LANES == 4
+class SimdLanes
+{
+public:
+  static const int Width = 4; //!< Number of lanes.
+  typedef __m128 Real;        //!< Lanes.
+  static Real Load(const float* x) { return _mm_load_ps(x); }
+  static void Store(float* x, Real a) { _mm_storeu_ps(x, a); }
+  static Real Set(float x) { return _mm_set1_ps(x); }
+  static Real Zero() { return _mm_setzero_ps(); }
+  static Real Add(Real a, Real b) { return _mm_add_ps(a, b); }
+  static Real Sub(Real a, Real b) { return _mm_sub_ps(a, b); }
+  static Real Mul(Real a, Real b) { return _mm_mul_ps(a, b); }
+  static Real Div(Real a, Real b) { return _mm_div_ps(a, b); }
+  static Real Min(Real a, Real b) { return _mm_min_ps(a, b); }
+  static Real Max(Real a, Real b) { return _mm_max_ps(a, b); }
+  static Real Lt(Real a, Real b) { return _mm_cmplt_ps(a, b); }
+  static Real Le(Real a, Real b) { return _mm_cmple_ps(a, b); }
+  static Real Eq(Real a, Real b) { return _mm_cmpeq_ps(a, b); }
+  static Real Neq(Real a, Real b) { return _mm_cmpneq_ps(a, b); }
+  static Real And(Real a, Real b) { return _mm_and_ps(a, b); }
+  static Real Or(Real a, Real b) { return _mm_or_ps(a, b); }
+  static Real AndNot(Real a, Real b) { return _mm_andnot_ps(a, b); }
+  static Real Xor(Real a, Real b) { return _mm_xor_ps(a, b); }
+  static int Mask(Real a) { return _mm_movemask_ps(a); }
+};
+#endif
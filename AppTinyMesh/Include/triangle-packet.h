@@ -0,0 +1,53 @@
+// Packets of triangles for ray intersection
+
+#pragma once
+
+#include "ray.h"
+
+/*!
+\brief A ray transformed for watertight intersection tests, its dominant axis is mapped to z and the others are sheared.
+*/
+class TrianglePacketRay
+{
+public:
+  float o[3];       //!< Origin.
+  int kx, ky, kz;   //!< Axes, kz is the dominant axis of the direction.
+  float sx, sy, sz; //!< Shear and scale.
+public:
+  //! Empty.
+  TrianglePacketRay() {}
+  explicit TrianglePacketRay(const Ray&);
+};
+
+class TrianglePacket
+{
+public:
+  static const int Width = 8; //!< Number of triangles.
+protected:
+  alignas(32) float p[9][Width] = {}; //!< Coordinates of the vertices, p[3 * i + k][j] is the k-th coordinate of the i-th vertex of the j-th triangle.
+  int count = 0;                      //!< Number of triangles.
+public:
+  //! Empty.
+  TrianglePacket() {}
+
+  //! Empty.
+  ~TrianglePacket() {}
+
+  void Set(int, const Vector&, const Vector&, const Vector&);
+  int Count() const;
+
+  int Intersect(const TrianglePacketRay&, double&, double&, double&) const;
+  bool Occluded(const TrianglePacketRay&, double) const;
+protected:
+  int Hits(const TrianglePacketRay&, float, float*, float*, float*, int&) const;
+  template<typename R>
+  int Intersect(int, const TrianglePacketRay&, R, R&, R&, R&) const;
+};
+
+/*!
+\brief Return the number of triangles.
+*/
+inline int TrianglePacket::Count() const
+{
+  return count;
+}
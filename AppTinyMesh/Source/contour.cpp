@@ -0,0 +1,101 @@
+#include "contour.h"
+
+#include <unordered_map>
+
+/*!
+\class Contour contour.h
+\brief A polyline, open or closed, typically computed as the cross-section of a surface by a plane.
+*/
+
+/*!
+\brief Create a contour.
+\param v Vertices.
+\param c Closed flag.
+*/
+Contour::Contour(const std::vector<Vector>& v, bool c) :p(v), closed(c)
+{
+}
+
+/*!
+\brief Compute the length of the contour.
+*/
+double Contour::Length() const
+{
+  double l = 0.0;
+  for (int i = 1; i < int(p.size()); i++)
+  {
+    l += Norm(p[i] - p[i - 1]);
+  }
+  if (closed && p.size() > 1)
+  {
+    l += Norm(p.front() - p.back());
+  }
+  return l;
+}
+
+/*!
+\brief Chain a soup of segments into contours.
+
+Segment i goes from the end point 2i to the end point 2i+1. End points that coincide share
+the same key, typically the index of the edge of the grid or of the mesh they were computed on.
+Open polylines are chained first, starting from the keys used only once, then closed loops.
+Open polylines whose ends coincide are closed.
+\param keys Keys of the end points.
+\param points End points.
+\param contours Returned contours.
+*/
+void Contour::Chain(const std::vector<long long>& keys, const std::vector<Vector>& points, std::vector<Contour>& contours)
+{
+  const int ns = int(keys.size()) / 2;
+
+  // End points sharing a key, at most two for a manifold cross-section
+  std::unordered_map<long long, std::pair<int, int>> incident;
+  incident.reserve(keys.size());
+  for (int e = 0; e < 2 * ns; e++)
+  {
+    std::pair<int, int>& in = incident.emplace(keys[e], std::pair<int, int>(-1, -1)).first->second;
+    if (in.first == -1)
+      in.first = e;
+    else if (in.second == -1)
+      in.second = e;
+  }
+
+  std::vector<bool> visited(ns, false);
+  auto walk = [&](int e)
+  {
+    const long long start = keys[e];
+    std::vector<Vector> polyline;
+    polyline.push_back(points[e]);
+    while (true)
+    {
+      visited[e / 2] = true;
+      e = e ^ 1;
+      polyline.push_back(points[e]);
+
+      const std::pair<int, int>& in = incident[keys[e]];
+      const int next = (in.first == e) ? in.second : in.first;
+      if (next == -1 || visited[next / 2])
+        break;
+      e = next;
+    }
+
+    // The last end point duplicates the first one for loops, possibly with a different key across the seams of unwelded meshes
+    const bool loop = (polyline.size() > 2) && (keys[e] == start || polyline.back() == polyline.front());
+    if (loop)
+      polyline.pop_back();
+    contours.push_back(Contour(polyline, loop));
+  };
+
+  // Open polylines
+  for (int e = 0; e < 2 * ns; e++)
+  {
+    if (!visited[e / 2] && incident[keys[e]].second == -1)
+      walk(e);
+  }
+  // Closed loops
+  for (int s = 0; s < ns; s++)
+  {
+    if (!visited[s])
+      walk(2 * s);
+  }
+}
@@ -0,0 +1,284 @@
+#include "implicits-animation.h"
+
+#include <climits>
+
+/*!
+\class AnimatedScalarField implicits-animation.h
+\brief A time-dependent scalar field.
+
+Derived classes implement AnimatedScalarField::Value(const Vector&, double) const. The field also stores
+a current time, so that it can be used wherever an AnalyticScalarField is expected.
+*/
+
+/*!
+\brief Constructor.
+*/
+AnimatedScalarField::AnimatedScalarField()
+{
+}
+
+/*!
+\brief Compute the value of the field.
+
+The default field is a unit sphere whose center oscillates along the x axis.
+\param p Point.
+\param t Time.
+*/
+double AnimatedScalarField::Value(const Vector& p, double t) const
+{
+  return Norm(p - Vector(0.5 * sin(t), 0.0, 0.0)) - 1.0;
+}
+
+/*!
+\class AnimationPolygonizer implicits-animation.h
+\brief Polygonization of a time-varying implicit surface with temporal coherence.
+
+The polygonizer keeps the set of cells that straddled the surface at the previous frame.
+At every frame, those cells, dilated by a few rings, are used as seeds and the surface is tracked
+from cell to cell across the faces with a sign change. Only the cells close to the old and the new surface
+are sampled, so that the cost of a frame depends on the area of the surface and on its motion, not on the volume of the box.
+
+Surface components that appear far from the previous surface are not detected, call AnimationPolygonizer::Reset()
+to scan the whole grid at the next frame. The first frame always scans the whole grid.
+
+Cells, corners and edges are marked with flat arrays stamped with the current frame, so that nothing
+needs to be cleared between frames and no memory is allocated once the buffers have grown at the first frame.
+The arrays are proportional to the volume of the grid, about 40 bytes per cell.
+
+\code
+AnimatedScalarField field;
+AnimationPolygonizer animation(field, Box(2.0), 64);
+Mesh mesh;
+for (int i = 0; i < 100; i++)
+{
+  animation.Polygonize(i * 0.04, mesh);
+}
+\endcode
+*/
+
+/*!
+\brief Create the polygonizer.
+\param f Animated field.
+\param box %Box defining the region that will be polygonized.
+\param n Number of cells along every axis.
+\param r Number of rings of cells around the previous surface that are searched, this should exceed the motion of the surface between two frames.
+*/
+AnimationPolygonizer::AnimationPolygonizer(AnimatedScalarField& f, const Box& box, int n, int r) :field(f), box(box), n(n), dilation(r)
+{
+  d = box.Diagonal() / n;
+}
+
+/*!
+\brief Forget the previous surface, the whole grid will be scanned at the next frame.
+*/
+void AnimationPolygonizer::Reset()
+{
+  active.clear();
+}
+
+/*!
+\brief Compute the field value at a corner of the grid, samples are cached during a frame.
+\param x,y,z Integer coordinates of the corner.
+*/
+double AnimationPolygonizer::Sample(int x, int y, int z)
+{
+  const size_t key = (size_t(z) * (n + 1) + y) * (n + 1) + x;
+  if (sampled[key] == frame)
+    return values[key];
+
+  const double v = field.Value(box[0] + Vector(x * d[0], y * d[1], z * d[2]));
+  sampled[key] = frame;
+  values[key] = v;
+  samples++;
+  return v;
+}
+
+/*!
+\brief Compute the vertex on a straddling edge.
+\param x,y,z Integer coordinates of the lower end of the edge.
+\param axis Axis of the edge.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+int AnimationPolygonizer::Edge(int x, int y, int z, int axis, const double& epsilon)
+{
+  const size_t key = ((size_t(z) * (n + 1) + y) * (n + 1) + x) * 3 + axis;
+  if (stamps[key] == frame)
+    return edges[key];
+
+  const int xb = x + (axis == 0);
+  const int yb = y + (axis == 1);
+  const int zb = z + (axis == 2);
+  const Vector a = box[0] + Vector(x * d[0], y * d[1], z * d[2]);
+  const Vector b = box[0] + Vector(xb * d[0], yb * d[1], zb * d[2]);
+  vertex.push_back(field.Dichotomy(a, b, Sample(x, y, z), Sample(xb, yb, zb), d[axis], epsilon));
+  normal.push_back(field.Normal(vertex.back()));
+
+  const int e = int(vertex.size()) - 1;
+  stamps[key] = frame;
+  edges[key] = e;
+  return e;
+}
+
+/*!
+\brief Queue a cell if it was not queued during the current frame.
+\param c Cell.
+*/
+void AnimationPolygonizer::Visit(long long c)
+{
+  if (visited[c] == frame)
+    return;
+  visited[c] = frame;
+  queue.push_back(c);
+}
+
+/*!
+\brief Polygonize a cell and queue its neighbors sharing a face crossed by the surface.
+\param c Cell.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void AnimationPolygonizer::Cell(long long c, const double& epsilon)
+{
+  const int x = int(c % n);
+  const int y = int((c / n) % n);
+  const int z = int(c / n / n);
+
+  double v[8];
+  int cubeindex = 0;
+  for (int b = 0; b < 8; b++)
+  {
+    v[b] = Sample(x + (b & 1), y + ((b >> 1) & 1), z + ((b >> 2) & 1));
+    if (v[b] < 0.0)
+      cubeindex |= 1 << b;
+  }
+
+  // Cube is straddling the surface
+  if ((cubeindex == 255) || (cubeindex == 0))
+    return;
+
+  active.push_back(c);
+
+  int e[12];
+  for (int b = 0; b < 12; b++)
+    e[b] = -1;
+  for (int h = 0; AnalyticScalarField::TriangleTable[cubeindex][h] != -1; h++)
+  {
+    const int te = AnalyticScalarField::TriangleTable[cubeindex][h];
+    if (e[te] == -1)
+    {
+      const int ea = te / 4;
+      const int r = te % 4;
+      int p[3] = { x, y, z };
+      p[ea == 0 ? 1 : 0] += r & 1;
+      p[ea == 2 ? 1 : 2] += r >> 1;
+      e[te] = Edge(p[0], p[1], p[2], ea, epsilon);
+    }
+    triangle.push_back(e[te]);
+  }
+
+  // Neighbors sharing a face crossed by the surface
+  for (int f = 0; f < 6; f++)
+  {
+    const int axis = f / 2;
+    const int side = f % 2;
+    int q[3] = { x, y, z };
+    q[axis] += side ? 1 : -1;
+    if (q[axis] < 0 || q[axis] >= n)
+      continue;
+
+    int inside = 0;
+    for (int b = 0; b < 8; b++)
+    {
+      if (((b >> axis) & 1) == side && v[b] < 0.0)
+        inside++;
+    }
+    if (inside == 0 || inside == 4)
+      continue;
+
+    Visit(((long long)(q[2]) * n + q[1]) * n + q[0]);
+  }
+}
+
+/*!
+\brief Compute the polygonal mesh approximating the implicit surface at a given time.
+\param t Time.
+\param g Returned geometry.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void AnimationPolygonizer::Polygonize(double t, Mesh& g, const double& epsilon)
+{
+  field.SetTime(t);
+
+  // Stamps are allocated at the first frame, and only cleared when the stamp wraps around
+  // Cells and edges are indexed with 64-bit keys, as there are more than 2^31 edges from about 900 cells along every axis
+  const long long cells = (long long)(n) * n * n;
+  const size_t corners = size_t(n + 1) * (n + 1) * (n + 1);
+  if (visited.empty() || frame == INT_MAX)
+  {
+    frame = 0;
+    visited.assign(size_t(cells), 0);
+    sampled.assign(corners, 0);
+    values.resize(corners);
+    stamps.assign(3 * corners, 0);
+    edges.resize(3 * corners);
+  }
+  frame++;
+  samples = 0;
+
+  // Clearing keeps the allocated storage
+  queue.clear();
+  vertex.clear();
+  normal.clear();
+  triangle.clear();
+
+  if (active.empty())
+  {
+    // Scan the whole grid, cells reached by tracking the surface are skipped
+    for (long long c = 0; c < cells; c++)
+    {
+      if (visited[c] == frame)
+        continue;
+      visited[c] = frame;
+      Cell(c, epsilon);
+      while (!queue.empty())
+      {
+        const long long q = queue.back();
+        queue.pop_back();
+        Cell(q, epsilon);
+      }
+    }
+  }
+  else
+  {
+    // Seeds
+    for (long long c : active)
+    {
+      const int x = int(c % n);
+      const int y = int((c / n) % n);
+      const int z = int(c / n / n);
+      for (int k = z - dilation; k <= z + dilation; k++)
+      {
+        for (int j = y - dilation; j <= y + dilation; j++)
+        {
+          for (int i = x - dilation; i <= x + dilation; i++)
+          {
+            if (i < 0 || j < 0 || k < 0 || i >= n || j >= n || k >= n)
+              continue;
+            Visit(((long long)(k) * n + j) * n + i);
+          }
+        }
+      }
+    }
+    active.clear();
+
+    // Track the surface across the faces of the straddling cells
+    while (!queue.empty())
+    {
+      const long long c = queue.back();
+      queue.pop_back();
+      Cell(c, epsilon);
+    }
+  }
+
+  // Arrays are copied so that the buffers keep their storage for the next frame
+  g = Mesh(vertex, normal, triangle);
+}
@@ -0,0 +1,494 @@
+#include "implicits-lod.h"
+
+#include <unordered_map>
+
+/*!
+\class ChunkedPolygonizer implicits-lod.h
+\brief Multiresolution polygonization of an implicit surface split into chunks.
+
+The region is split into cx*cy*cz chunks of the same size. Every chunk is polygonized
+with marching cubes at its own resolution level: a chunk of level l has n/2<sup>l</sup>
+cells along every axis. Levels of adjacent chunks (including edge and corner neighbors)
+may differ by one at most, see ChunkedPolygonizer::Balance().
+
+Independent polygonizations at different resolutions leave cracks along chunk boundaries.
+Those are closed as follows:
+- A sample lying on the boundary of a coarser chunk is not evaluated but interpolated from the
+coarse lattice, so that both chunks agree on the sign of the field along the shared face.
+- Vertices on the fine edges that lie on a coarse edge are snapped onto the coarse edge vertex.
+- The finer chunk emits transition triangles that fill the gap between its own face contour and
+the contour of the coarse cells, within every coarse face.
+
+Every chunk produces its own mesh so that the chunks can be streamed independently.
+
+\code
+AnalyticScalarField field;
+ChunkedPolygonizer chunks(field, Box(2.0), 4, 4, 4, 32);
+chunks.SetLevels(camera.Eye(), 1.5);
+std::vector<Mesh> meshes;
+chunks.Polygonize(meshes);
+\endcode
+*/
+
+/*!
+\brief Create the chunk grid, all chunks are set to the finest level.
+
+The number of levels is clamped so that the coarsest chunks have at least two cells along every axis.
+
+\param f Field.
+\param box %Box defining the region that will be polygonized.
+\param x,y,z Number of chunks along every axis.
+\param n Number of cells along every axis of a chunk at the finest level.
+\param l Number of resolution levels.
+*/
+ChunkedPolygonizer::ChunkedPolygonizer(const AnalyticScalarField& f, const Box& box, int x, int y, int z, int n, int l) :field(f), box(box), cx(x), cy(y), cz(z), n(n)
+{
+  levels = 1;
+  while ((levels < l) && (n % (1 << levels) == 0) && ((n >> levels) >= 2))
+  {
+    levels++;
+  }
+
+  const Vector d = box.Diagonal();
+  h = Vector(d[0] / (cx * n), d[1] / (cy * n), d[2] / (cz * n));
+
+  level.resize(cx * cy * cz, 0);
+}
+
+/*!
+\brief Set the level of a chunk.
+
+Call ChunkedPolygonizer::Balance() once all levels are set.
+\param i,j,k Integer coordinates of the chunk.
+\param l Level.
+*/
+void ChunkedPolygonizer::SetLevel(int i, int j, int k, int l)
+{
+  level[Index(i, j, k)] = l < 0 ? 0 : (l >= levels ? levels - 1 : l);
+}
+
+/*!
+\brief Set the levels of all chunks from their distance to a viewer.
+\param p Viewer.
+\param r Distance covered by every level.
+*/
+void ChunkedPolygonizer::SetLevels(const Vector& p, double r)
+{
+  for (int k = 0; k < cz; k++)
+  {
+    for (int j = 0; j < cy; j++)
+    {
+      for (int i = 0; i < cx; i++)
+      {
+        const Box chunk = GetBox(i, j, k);
+        const Vector q = Vector::Max(chunk[0], Vector::Min(chunk[1], p));
+        SetLevel(i, j, k, int(Norm(p - q) / r));
+      }
+    }
+  }
+  Balance();
+}
+
+/*!
+\brief Refine chunks until the levels of all neighboring chunks differ by one at most.
+*/
+void ChunkedPolygonizer::Balance()
+{
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (int k = 0; k < cz; k++)
+    {
+      for (int j = 0; j < cy; j++)
+      {
+        for (int i = 0; i < cx; i++)
+        {
+          int& l = level[Index(i, j, k)];
+          for (int c = 0; c < 27; c++)
+          {
+            const int ni = i + c % 3 - 1;
+            const int nj = j + (c / 3) % 3 - 1;
+            const int nk = k + c / 9 - 1;
+            if (ni < 0 || nj < 0 || nk < 0 || ni >= cx || nj >= cy || nk >= cz)
+              continue;
+            const int nl = level[Index(ni, nj, nk)];
+            if (l > nl + 1)
+            {
+              l = nl + 1;
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/*!
+\brief Compute the box of a chunk.
+\param i,j,k Integer coordinates of the chunk.
+*/
+Box ChunkedPolygonizer::GetBox(int i, int j, int k) const
+{
+  return Box(Vertex(i * n, j * n, k * n), Vertex((i + 1) * n, (j + 1) * n, (k + 1) * n));
+}
+
+/*!
+\brief Compute the coarsest level among the chunks that contain a vertex of the finest lattice.
+\param x,y,z Global integer coordinates.
+*/
+int ChunkedPolygonizer::SampleLevel(int x, int y, int z) const
+{
+  const int p[3] = { x, y, z };
+  const int c[3] = { cx, cy, cz };
+  int a[3], b[3];
+  for (int i = 0; i < 3; i++)
+  {
+    b[i] = p[i] / n;
+    a[i] = (p[i] % n == 0) ? b[i] - 1 : b[i];
+    if (a[i] < 0) a[i] = 0;
+    if (b[i] > c[i] - 1) b[i] = c[i] - 1;
+  }
+
+  int l = 0;
+  for (int k = a[2]; k <= b[2]; k++)
+    for (int j = a[1]; j <= b[1]; j++)
+      for (int i = a[0]; i <= b[0]; i++)
+        if (level[Index(i, j, k)] > l)
+          l = level[Index(i, j, k)];
+  return l;
+}
+
+/*!
+\brief Compute the field value as seen by a chunk of a given level.
+
+Samples shared with a coarser chunk are trilinearly interpolated from the coarse lattice.
+\param x,y,z Global integer coordinates.
+\param l Level of the chunk.
+*/
+double ChunkedPolygonizer::Sample(int x, int y, int z, int l) const
+{
+  const int sl = SampleLevel(x, y, z);
+  if (sl <= l)
+  {
+    return field.Value(Vertex(x, y, z));
+  }
+
+  const int s = 1 << sl;
+  const int p[3] = { x, y, z };
+  int a[3];
+  double t[3];
+  for (int i = 0; i < 3; i++)
+  {
+    a[i] = p[i] - p[i] % s;
+    t[i] = double(p[i] - a[i]) / s;
+  }
+
+  double v = 0.0;
+  for (int c = 0; c < 8; c++)
+  {
+    double w = 1.0;
+    for (int i = 0; i < 3; i++)
+      w *= ((c >> i) & 1) ? t[i] : 1.0 - t[i];
+    if (w == 0.0)
+      continue;
+    v += w * field.Value(Vertex(a[0] + (c & 1) * s, a[1] + ((c >> 1) & 1) * s, a[2] + ((c >> 2) & 1) * s));
+  }
+  return v;
+}
+
+/*!
+\brief Check if an edge of a marching cube lies on a face of the cube.
+\param e Edge index, as used in AnalyticScalarField::TriangleTable.
+\param axis,side Face axis and side (0 for the lower face, 1 for the upper face).
+*/
+bool ChunkedPolygonizer::OnFace(int e, int axis, int side)
+{
+  const int ea = e / 4;
+  if (ea == axis)
+    return false;
+  const int r = e % 4;
+  const int first = (ea == 0) ? 1 : 0;
+  return ((axis == first) ? (r & 1) : (r >> 1)) == side;
+}
+
+/*!
+\brief Polygonize all chunks in parallel.
+\param meshes Returned meshes, one per chunk, indexed as (k * cy + j) * cx + i.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void ChunkedPolygonizer::Polygonize(std::vector<Mesh>& meshes, const double& epsilon) const
+{
+  const int nc = Chunks();
+  meshes.resize(nc);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int c = 0; c < nc; c++)
+  {
+    Polygonize(c % cx, (c / cx) % cy, c / (cx * cy), meshes[c], epsilon);
+  }
+}
+
+/*!
+\brief Polygonize a single chunk, including the transition triangles towards coarser neighbors.
+\param i,j,k Integer coordinates of the chunk.
+\param g Returned geometry.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void ChunkedPolygonizer::Polygonize(int i, int j, int k, Mesh& g, const double& epsilon) const
+{
+  const int l = Level(i, j, k);
+  const int s = 1 << l;
+  const int m = n >> l;
+  const int o[3] = { i * n, j * n, k * n };
+  const int count[3] = { cx, cy, cz };
+  const int m1 = m + 1;
+
+  std::vector<Vector> vertex;
+  std::vector<Vector> normal;
+  std::vector<int> triangle;
+
+  // Field values at the corners of the cells
+  std::vector<double> a(m1 * m1 * m1);
+  for (int z = 0; z < m1; z++)
+    for (int y = 0; y < m1; y++)
+      for (int x = 0; x < m1; x++)
+        a[(z * m1 + y) * m1 + x] = Sample(o[0] + x * s, o[1] + y * s, o[2] + z * s, l);
+
+  // Level of the face neighbors, a coarser neighbor requires transition triangles
+  int neighbor[6];
+  for (int f = 0; f < 6; f++)
+  {
+    int q[3] = { i, j, k };
+    q[f / 2] += (f % 2) ? 1 : -1;
+    neighbor[f] = (q[f / 2] < 0 || q[f / 2] >= count[f / 2]) ? -1 : Level(q[0], q[1], q[2]);
+  }
+
+  // Vertices snapped onto coarse edges, indexed by the lower end and the axis of the coarse edge
+  std::unordered_map<long long, int> snapped;
+  const long long sx = (long long)(cx) * n + 1;
+  const long long sy = (long long)(cy) * n + 1;
+  auto snap = [&](const int* p, int axis, int cs) -> int
+  {
+    const long long key = (((long long)(p[2]) * sy + p[1]) * sx + p[0]) * 3 + axis;
+    std::unordered_map<long long, int>::const_iterator it = snapped.find(key);
+    if (it != snapped.end())
+      return it->second;
+
+    int q[3] = { p[0], p[1], p[2] };
+    q[axis] += cs;
+    const Vector pa = Vertex(p[0], p[1], p[2]);
+    const Vector pb = Vertex(q[0], q[1], q[2]);
+    vertex.push_back(field.Dichotomy(pa, pb, field.Value(pa), field.Value(pb), cs * h[axis], epsilon));
+    normal.push_back(field.Normal(vertex.back()));
+    snapped[key] = int(vertex.size()) - 1;
+    return int(vertex.size()) - 1;
+  };
+
+  // Vertices on straddling edges, indexed by the lower end and the axis of the edge
+  std::vector<int> edges(m1 * m1 * m1 * 3, -1);
+  auto edge = [&](int x, int y, int z, int axis) -> int
+  {
+    int& e = edges[((z * m1 + y) * m1 + x) * 3 + axis];
+    if (e != -1)
+      return e;
+
+    int p[3] = { o[0] + x * s, o[1] + y * s, o[2] + z * s };
+    int q[3] = { p[0], p[1], p[2] };
+    q[axis] += s;
+    const int r[3] = { x + (axis == 0), y + (axis == 1), z + (axis == 2) };
+    const double va = a[(z * m1 + y) * m1 + x];
+    const double vb = a[(r[2] * m1 + r[1]) * m1 + r[0]];
+
+    const int la = SampleLevel(p[0], p[1], p[2]);
+    const int lb = SampleLevel(q[0], q[1], q[2]);
+    if (la > l && lb > l)
+    {
+      // Edge lying on the face of a coarser chunk
+      const int cs = 1 << la;
+      if (p[(axis + 1) % 3] % cs == 0 && p[(axis + 2) % 3] % cs == 0)
+      {
+        p[axis] -= p[axis] % cs;
+        e = snap(p, axis, cs);
+        return e;
+      }
+
+      // Interpolated values are linear along the edge
+      vertex.push_back((vb * Vertex(p[0], p[1], p[2]) - va * Vertex(q[0], q[1], q[2])) / (vb - va));
+    }
+    else
+    {
+      vertex.push_back(field.Dichotomy(Vertex(p[0], p[1], p[2]), Vertex(q[0], q[1], q[2]), va, vb, s * h[axis], epsilon));
+    }
+    normal.push_back(field.Normal(vertex.back()));
+    e = int(vertex.size()) - 1;
+    return e;
+  };
+
+  // Boundary segments of the triangles lying on the faces shared with a coarser chunk
+  struct Segment
+  {
+    int square; //!< Coarse face cell.
+    int a, b;   //!< Vertices.
+  };
+  std::vector<Segment> segments[6];
+
+  // Marching cubes
+  int e[12];
+  for (int z = 0; z < m; z++)
+  {
+    for (int y = 0; y < m; y++)
+    {
+      for (int x = 0; x < m; x++)
+      {
+        int cubeindex = 0;
+        for (int b = 0; b < 8; b++)
+        {
+          if (a[((z + ((b >> 2) & 1)) * m1 + y + ((b >> 1) & 1)) * m1 + x + (b & 1)] < 0.0)
+            cubeindex |= 1 << b;
+        }
+
+        // Cube is straddling the surface
+        if ((cubeindex == 255) || (cubeindex == 0))
+          continue;
+
+        for (int b = 0; b < 12; b++)
+          e[b] = -1;
+
+        const int cell[3] = { x, y, z };
+        for (int tr = 0; AnalyticScalarField::TriangleTable[cubeindex][tr] != -1; tr += 3)
+        {
+          const int* t = &AnalyticScalarField::TriangleTable[cubeindex][tr];
+          for (int v = 0; v < 3; v++)
+          {
+            if (e[t[v]] == -1)
+            {
+              // Lower end of the edge in cell coordinates
+              const int ea = t[v] / 4;
+              const int r = t[v] % 4;
+              int p[3] = { x, y, z };
+              p[ea == 0 ? 1 : 0] += r & 1;
+              p[ea == 2 ? 1 : 2] += r >> 1;
+              e[t[v]] = edge(p[0], p[1], p[2], ea);
+            }
+            triangle.push_back(e[t[v]]);
+          }
+
+          // Segments on transition faces
+          for (int f = 0; f < 6; f++)
+          {
+            const int axis = f / 2;
+            const int side = f % 2;
+            if (neighbor[f] != l + 1 || cell[axis] != (side ? m - 1 : 0))
+              continue;
+            const int u = cell[axis == 0 ? 1 : 0] / 2;
+            const int w = cell[axis == 2 ? 1 : 2] / 2;
+            for (int v = 0; v < 3; v++)
+            {
+              if (OnFace(t[v], axis, side) && OnFace(t[(v + 1) % 3], axis, side))
+                segments[f].push_back({ w * (m / 2) + u, e[t[v]], e[t[(v + 1) % 3]] });
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // Transition triangles
+  const int cs = 2 * s;
+  const int cm = m / 2;
+  for (int f = 0; f < 6; f++)
+  {
+    if (neighbor[f] != l + 1)
+      continue;
+    const int axis = f / 2;
+    const int side = f % 2;
+    const int ua = axis == 0 ? 1 : 0;
+    const int wa = axis == 2 ? 1 : 2;
+
+    for (int w = 0; w < cm; w++)
+    {
+      for (int u = 0; u < cm; u++)
+      {
+        // Lower corner of the coarse cube in the neighbor
+        int p[3];
+        p[axis] = o[axis] + (side ? n : -cs);
+        p[ua] = o[ua] + u * cs;
+        p[wa] = o[wa] + w * cs;
+
+        int cubeindex = 0;
+        for (int b = 0; b < 8; b++)
+        {
+          if (Sample(p[0] + (b & 1) * cs, p[1] + ((b >> 1) & 1) * cs, p[2] + ((b >> 2) & 1) * cs, l + 1) < 0.0)
+            cubeindex |= 1 << b;
+        }
+
+        // Stitching edges: the boundaries of the coarse and fine contours, reversed
+        std::vector<int> from, to;
+        for (int tr = 0; AnalyticScalarField::TriangleTable[cubeindex][tr] != -1; tr += 3)
+        {
+          const int* t = &AnalyticScalarField::TriangleTable[cubeindex][tr];
+          for (int v = 0; v < 3; v++)
+          {
+            int ev[2] = { t[v], t[(v + 1) % 3] };
+            if (!OnFace(ev[0], axis, 1 - side) || !OnFace(ev[1], axis, 1 - side))
+              continue;
+            int id[2];
+            for (int d = 0; d < 2; d++)
+            {
+              const int ea = ev[d] / 4;
+              const int r = ev[d] % 4;
+              int q[3] = { p[0], p[1], p[2] };
+              q[ea == 0 ? 1 : 0] += (r & 1) * cs;
+              q[ea == 2 ? 1 : 2] += (r >> 1) * cs;
+              id[d] = snap(q, ea, cs);
+            }
+            from.push_back(id[1]);
+            to.push_back(id[0]);
+          }
+        }
+        for (const Segment& sg : segments[f])
+        {
+          if (sg.square != w * cm + u)
+            continue;
+          from.push_back(sg.b);
+          to.push_back(sg.a);
+        }
+
+        // Chain edges into closed loops and triangulate them as fans
+        std::vector<bool> used(from.size(), false);
+        for (int b = 0; b < int(from.size()); b++)
+        {
+          if (used[b])
+            continue;
+          std::vector<int> loop;
+          int current = b;
+          while (current != -1 && !used[current])
+          {
+            used[current] = true;
+            loop.push_back(from[current]);
+            int next = -1;
+            for (int d = 0; d < int(from.size()); d++)
+            {
+              if (!used[d] && from[d] == to[current])
+              {
+                next = d;
+                break;
+              }
+            }
+            current = next;
+          }
+          for (int d = 1; d + 1 < int(loop.size()); d++)
+          {
+            triangle.push_back(loop[0]);
+            triangle.push_back(loop[d]);
+            triangle.push_back(loop[d + 1]);
+          }
+        }
+      }
+    }
+  }
+
+  g = Mesh(std::move(vertex), std::move(normal), std::move(triangle));
+}
@@ -0,0 +1,488 @@
+#include "implicits-shard.h"
+
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+/*!
+\class ShardedPolygonizer implicits-shard.h
+\brief Polygonization of an implicit surface split into shards processed by separate processes.
+
+The grid of n<sup>3</sup> cells is split into slabs of cell layers along the z axis. Shard boundaries
+always lie on grid planes, and all samples and vertices are computed from their integer grid coordinates,
+so that the samples and vertices on a seam are bitwise identical in both shards.
+
+Every shard is written to a file that stores, for every vertex on its lower or upper plane, the key of the grid edge it lies on.
+The merge step welds the seam vertices with those keys, and only keeps the keys of the seam between two consecutive shards. Vertices are created in the order of the triangles
+and the shards are merged in order, so the merged mesh is identical to the one produced by a single shard.
+
+Shards are polygonized by worker processes created with ShardedPolygonizer::Spawn(). Workers are forked, and fork() only duplicates
+the calling thread, so the workers should be spawned at the beginning of the program, before any OpenMP parallel region or other thread
+is started. Workers then wait for shards until the polygonizer is destroyed. Without workers, shards are processed one after the other
+by the calling process.
+
+\code
+AnalyticScalarField field;
+ShardedPolygonizer sharded(field, Box(2.0), 1024, 8);
+sharded.Spawn();
+// ...
+Mesh mesh;
+sharded.Polygonize(mesh, "/tmp/shard");
+\endcode
+*/
+
+#ifndef _WIN32
+/*!
+\brief Write a buffer to a pipe.
+\param fd File descriptor.
+\param data,size Buffer.
+*/
+static bool ShardWrite(int fd, const void* data, size_t size)
+{
+  const char* p = (const char*)data;
+  while (size > 0)
+  {
+    const ssize_t w = write(fd, p, size);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return false;
+    p += w;
+    size -= size_t(w);
+  }
+  return true;
+}
+
+/*!
+\brief Read a buffer from a pipe.
+\param fd File descriptor.
+\param data,size Buffer.
+\return Success, false if the pipe was closed before the buffer was filled.
+*/
+static bool ShardRead(int fd, void* data, size_t size)
+{
+  char* p = (char*)data;
+  while (size > 0)
+  {
+    const ssize_t r = read(fd, p, size);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    p += r;
+    size -= size_t(r);
+  }
+  return true;
+}
+#endif
+
+/*!
+\brief Create the polygonizer.
+\param f Field.
+\param box %Box defining the region that will be polygonized.
+\param n Number of cells along every axis.
+\param s Number of shards, clamped to the number of cell layers.
+*/
+ShardedPolygonizer::ShardedPolygonizer(const AnalyticScalarField& f, const Box& box, int n, int s) :field(f), box(box), n(n)
+{
+  shards = s < 1 ? 1 : (s > n ? n : s);
+  d = box.Diagonal() / n;
+}
+
+/*!
+\brief Stop the worker processes.
+*/
+ShardedPolygonizer::~ShardedPolygonizer()
+{
+  Stop();
+}
+
+/*!
+\brief Fork one worker process per shard.
+
+Workers are copies of the calling process at the time of the call, including the field, which should not be modified afterwards.
+Call this function before any OpenMP parallel region or other thread is started: fork() only duplicates the calling thread, and locks held by other threads
+would never be released in the workers.
+\return Success, false if workers are not supported or could not be created, shards are then processed by the calling process.
+*/
+bool ShardedPolygonizer::Spawn()
+{
+  Stop();
+#ifndef _WIN32
+  for (int s = 0; s < shards; s++)
+  {
+    int command[2], reply[2];
+    if (pipe(command) != 0)
+    {
+      Stop();
+      return false;
+    }
+    if (pipe(reply) != 0)
+    {
+      close(command[0]);
+      close(command[1]);
+      Stop();
+      return false;
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+      // Pipes of the other workers are closed, so that every worker only keeps its own ends
+      close(command[1]);
+      close(reply[0]);
+      for (int c : commands)
+        close(c);
+      for (int r : replies)
+        close(r);
+      Serve(command[0], reply[1]);
+      _exit(0);
+    }
+
+    close(command[0]);
+    close(reply[1]);
+    if (pid < 0)
+    {
+      close(command[1]);
+      close(reply[0]);
+      Stop();
+      return false;
+    }
+    workers.push_back(int(pid));
+    commands.push_back(command[1]);
+    replies.push_back(reply[0]);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*!
+\brief Stop the worker processes, shards are then processed by the calling process.
+*/
+void ShardedPolygonizer::Stop()
+{
+#ifndef _WIN32
+  // Workers exit when their command pipe is closed
+  for (int c : commands)
+    close(c);
+  for (int r : replies)
+    close(r);
+  for (int pid : workers)
+  {
+    int status = 0;
+    while (waitpid(pid_t(pid), &status, 0) < 0 && errno == EINTR)
+      continue;
+  }
+#endif
+  workers.clear();
+  commands.clear();
+  replies.clear();
+}
+
+/*!
+\brief Loop of a worker process, polygonize the shards received on the command pipe until it is closed.
+
+Every command is the shard index, the epsilon value and the file name, and is answered with a status byte.
+\param in,out Command and reply pipes.
+*/
+void ShardedPolygonizer::Serve(int in, int out) const
+{
+#ifndef _WIN32
+  int header[2];
+  double epsilon;
+  while (ShardRead(in, header, sizeof(header)) && ShardRead(in, &epsilon, sizeof(double)) && header[1] >= 0)
+  {
+    std::string url(size_t(header[1]), '\0');
+    if (!ShardRead(in, &url[0], url.size()))
+      break;
+    const char status = (header[0] >= 0 && header[0] < shards && Polygonize(header[0], url, epsilon)) ? 1 : 0;
+    if (!ShardWrite(out, &status, 1))
+      break;
+  }
+  close(in);
+  close(out);
+#else
+  (void)in;
+  (void)out;
+#endif
+}
+
+/*!
+\brief Compute the box of a shard.
+\param s Shard index.
+*/
+Box ShardedPolygonizer::GetBox(int s) const
+{
+  return Box(Vector(box[0][0], box[0][1], box[0][2] + Layer(s) * d[2]), Vector(box[1][0], box[1][1], box[0][2] + Layer(s + 1) * d[2]));
+}
+
+/*!
+\brief Polygonize a shard in memory.
+
+Cells are processed layer by layer so that only two layers of samples are stored.
+\param s Shard index.
+\param g Returned geometry.
+\param keys Returned grid edge key of every vertex on the lower or upper plane of the shard, -1 for the other vertices.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+*/
+void ShardedPolygonizer::Polygonize(int s, Mesh& g, std::vector<long long>& keys, const double& epsilon) const
+{
+  std::vector<Vector> vertex;
+  std::vector<Vector> normal;
+  std::vector<int> triangle;
+  keys.clear();
+
+  const int m = n + 1;
+  const int size = m * m;
+
+  // Intensities of the lower and upper planes
+  std::vector<double> a(size), b(size);
+
+  // Vertices on the edges of the lower and upper planes, and on vertical edges
+  std::vector<int> eax(size), eay(size), ebx(size), eby(size), ez(size);
+
+  auto vertexAt = [&](int x, int y, int z) -> Vector
+  {
+    return box[0] + Vector(x * d[0], y * d[1], z * d[2]);
+  };
+
+  const int z0 = Layer(s);
+  const int z1 = Layer(s + 1);
+
+  for (int i = 0; i < size; i++)
+  {
+    a[i] = field.Value(vertexAt(i % m, i / m, z0));
+    ebx[i] = eby[i] = -1;
+  }
+
+  for (int z = z0; z < z1; z++)
+  {
+    for (int i = 0; i < size; i++)
+    {
+      b[i] = field.Value(vertexAt(i % m, i / m, z + 1));
+      eax[i] = ebx[i];
+      eay[i] = eby[i];
+      ebx[i] = eby[i] = ez[i] = -1;
+    }
+
+    for (int y = 0; y < n; y++)
+    {
+      for (int x = 0; x < n; x++)
+      {
+        const int i = y * m + x;
+        int cubeindex = 0;
+        if (a[i] < 0.0)         cubeindex |= 1;
+        if (a[i + 1] < 0.0)     cubeindex |= 2;
+        if (a[i + m] < 0.0)     cubeindex |= 4;
+        if (a[i + m + 1] < 0.0) cubeindex |= 8;
+        if (b[i] < 0.0)         cubeindex |= 16;
+        if (b[i + 1] < 0.0)     cubeindex |= 32;
+        if (b[i + m] < 0.0)     cubeindex |= 64;
+        if (b[i + m + 1] < 0.0) cubeindex |= 128;
+
+        // Cube is straddling the surface
+        if ((cubeindex == 255) || (cubeindex == 0))
+          continue;
+
+        int* slot[12] = {
+          &eax[i], &eax[i + m], &ebx[i], &ebx[i + m],
+          &eay[i], &eay[i + 1], &eby[i], &eby[i + 1],
+          &ez[i], &ez[i + 1], &ez[i + m], &ez[i + m + 1] };
+
+        for (int h = 0; AnalyticScalarField::TriangleTable[cubeindex][h] != -1; h++)
+        {
+          const int te = AnalyticScalarField::TriangleTable[cubeindex][h];
+          if (*slot[te] == -1)
+          {
+            // Lower end of the edge in grid coordinates
+            const int ea = te / 4;
+            const int r = te % 4;
+            int p[3] = { x, y, z };
+            p[ea == 0 ? 1 : 0] += r & 1;
+            p[ea == 2 ? 1 : 2] += r >> 1;
+            int q[3] = { p[0], p[1], p[2] };
+            q[ea]++;
+
+            const int ia = p[1] * m + p[0];
+            const int ib = q[1] * m + q[0];
+            const double va = (p[2] == z) ? a[ia] : b[ia];
+            const double vb = (q[2] == z) ? a[ib] : b[ib];
+
+            vertex.push_back(field.Dichotomy(vertexAt(p[0], p[1], p[2]), vertexAt(q[0], q[1], q[2]), va, vb, d[ea], epsilon));
+            normal.push_back(field.Normal(vertex.back()));
+            keys.push_back((ea != 2 && (p[2] == z0 || p[2] == z1)) ? ((long long)(p[2]) * size + ia) * 3 + ea : -1);
+            *slot[te] = int(vertex.size()) - 1;
+          }
+          triangle.push_back(*slot[te]);
+        }
+      }
+    }
+
+    std::swap(a, b);
+  }
+
+  g = Mesh(std::move(vertex), std::move(normal), std::move(triangle));
+}
+
+/*!
+\brief Polygonize a shard and write it to a file.
+\param s Shard index.
+\param url File name.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+\return Success.
+*/
+bool ShardedPolygonizer::Polygonize(int s, const std::string& url, const double& epsilon) const
+{
+  Mesh g;
+  std::vector<long long> keys;
+  Polygonize(s, g, keys, epsilon);
+
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+
+  const int nv = g.Vertexes();
+  const int nt = g.Triangles();
+  out.write((const char*)&nv, sizeof(int));
+  out.write((const char*)&nt, sizeof(int));
+  for (int i = 0; i < nv; i++)
+  {
+    const Vector p = g.Vertex(i);
+    const Vector q = g.Normal(i);
+    const double v[6] = { p[0], p[1], p[2], q[0], q[1], q[2] };
+    out.write((const char*)v, sizeof(v));
+  }
+  out.write((const char*)keys.data(), sizeof(long long) * nv);
+  const std::vector<int>& va = g.VertexIndexes();
+  out.write((const char*)va.data(), sizeof(int) * va.size());
+  return bool(out);
+}
+
+/*!
+\brief Merge shard files into a single mesh, welding the vertices that lie on the same grid edge.
+
+Only the vertices on the planes between shards are hashed, and the keys of a seam are released once the next shard is merged.
+\param urls File names, in shard order.
+\param g Returned geometry.
+\return Success.
+*/
+bool ShardedPolygonizer::Merge(const std::vector<std::string>& urls, Mesh& g)
+{
+  std::vector<Vector> vertex;
+  std::vector<Vector> normal;
+  std::vector<int> triangle;
+  std::unordered_map<long long, int> lower, upper; // Seam vertices of the previous and the current shard
+
+  std::vector<long long> keys;
+  std::vector<int> remap;
+  std::vector<int> va;
+  for (const std::string& url : urls)
+  {
+    std::ifstream in(url, std::ios::binary);
+    if (!in)
+      return false;
+
+    int nv = 0, nt = 0;
+    in.read((char*)&nv, sizeof(int));
+    in.read((char*)&nt, sizeof(int));
+    if (!in || nv < 0 || nt < 0)
+      return false;
+
+    std::vector<double> v(nv * 6);
+    keys.resize(nv);
+    va.resize(nt * 3);
+    in.read((char*)v.data(), sizeof(double) * v.size());
+    in.read((char*)keys.data(), sizeof(long long) * nv);
+    in.read((char*)va.data(), sizeof(int) * va.size());
+    if (!in)
+      return false;
+
+    remap.assign(nv, -1);
+    for (int i = 0; i < nt * 3; i++)
+    {
+      const int k = va[i];
+      if (k < 0 || k >= nv)
+        return false;
+      if (remap[k] == -1)
+      {
+        std::unordered_map<long long, int>::const_iterator it = lower.end();
+        if (keys[k] >= 0)
+          it = lower.find(keys[k]);
+        if (it != lower.end())
+        {
+          remap[k] = it->second;
+        }
+        else
+        {
+          vertex.push_back(Vector(v[k * 6 + 0], v[k * 6 + 1], v[k * 6 + 2]));
+          normal.push_back(Vector(v[k * 6 + 3], v[k * 6 + 4], v[k * 6 + 5]));
+          remap[k] = int(vertex.size()) - 1;
+          if (keys[k] >= 0)
+            upper[keys[k]] = remap[k];
+        }
+      }
+      triangle.push_back(remap[k]);
+    }
+
+    // Vertices of the upper plane are welded with the next shard only
+    lower.swap(upper);
+    upper.clear();
+  }
+
+  g = Mesh(std::move(vertex), std::move(normal), std::move(triangle));
+  return true;
+}
+
+/*!
+\brief Polygonize all shards in separate processes and merge them.
+
+Every shard is polygonized by a worker process and written to a file named after the prefix and the shard index.
+The files are removed once merged. If no workers were spawned, see ShardedPolygonizer::Spawn(), shards are processed one after the other.
+\param g Returned geometry.
+\param prefix Prefix of the shard file names.
+\param epsilon Epsilon value for computing vertices on straddling edges.
+\return Success.
+*/
+bool ShardedPolygonizer::Polygonize(Mesh& g, const std::string& prefix, const double& epsilon) const
+{
+  std::vector<std::string> urls;
+  for (int s = 0; s < shards; s++)
+    urls.push_back(prefix + "-" + std::to_string(s) + ".shard");
+
+  bool success = true;
+  if (workers.empty())
+  {
+    for (int s = 0; s < shards; s++)
+      success = Polygonize(s, urls[s], epsilon) && success;
+  }
+  else
+  {
+#ifndef _WIN32
+    // Send all the shards before waiting for the workers
+    for (int s = 0; s < shards; s++)
+    {
+      const int header[2] = { s, int(urls[s].size()) };
+      success = ShardWrite(commands[s], header, sizeof(header)) && ShardWrite(commands[s], &epsilon, sizeof(double))
+        && ShardWrite(commands[s], urls[s].data(), urls[s].size()) && success;
+    }
+    for (int s = 0; s < shards; s++)
+    {
+      char status = 0;
+      success = ShardRead(replies[s], &status, 1) && status == 1 && success;
+    }
+#endif
+  }
+
+  success = success && Merge(urls, g);
+  for (const std::string& url : urls)
+    std::remove(url.c_str());
+  return success;
+}
@@ -236,9 +236,150 @@ void AnalyticScalarField::Polygonize(int n, Mesh& g, const Box& box, const doubl
   delete[]eby;
   delete[]ez;
 
-  std::vector<int> normals = triangle;
+  g = Mesh(std::move(vertex), std::move(normal), std::move(triangle));
+}
+
+/*!
+\brief Compute the cross-section of the implicit surface by a plane.
+\param n Discretization parameter, number of samples along every axis of the plane.
+\param contours Returned contours.
+\param box %Box defining the region that will be sliced.
+\param c,normal Point on the plane and normal.
+*/
+void AnalyticScalarField::Slice(int n, std::vector<Contour>& contours, const Box& box, const Vector& c, const Vector& normal) const
+{
+  std::vector<std::vector<Contour>> stack;
+  Slice(n, stack, box, c, normal, 0.0, 1);
+  contours.swap(stack[0]);
+}
+
+/*!
+\brief Compute the cross-sections of the implicit surface by a stack of parallel planes.
+
+Slices are computed in parallel. Every slice is sampled on a regular grid covering the projection of the box in the plane,
+and contoured with marching squares. Ambiguous cells are resolved with the average of their corner values.
+Contour vertices are linearly interpolated along the edges of the grid.
+
+\param n Discretization parameter, number of samples along every axis of the planes.
+\param stack Returned contours, for every plane.
+\param box %Box defining the region that will be sliced.
+\param c,normal Point on the first plane and normal.
+\param spacing Distance between two planes.
+\param count Number of planes.
+*/
+void AnalyticScalarField::Slice(int n, std::vector<std::vector<Contour>>& stack, const Box& box, const Vector& c, const Vector& normal, double spacing, int count) const
+{
+  stack.clear();
+  stack.resize(count);
+
+  // Orthonormal basis
+  const Vector z = Normalized(normal);
+  Vector x, y;
+  z.Orthonormal(x, y);
+
+  // Projection of the box in the plane
+  double a[2] = { 0.0, 0.0 };
+  double b[2] = { 0.0, 0.0 };
+  for (int i = 0; i < 8; i++)
+  {
+    const Vector q = box.Vertex(i) - c;
+    const double u[2] = { q * x, q * y };
+    for (int k = 0; k < 2; k++)
+    {
+      a[k] = (i == 0) ? u[k] : Math::Min(a[k], u[k]);
+      b[k] = (i == 0) ? u[k] : Math::Max(b[k], u[k]);
+    }
+  }
+  const Vector dx = x * ((b[0] - a[0]) / (n - 1));
+  const Vector dy = y * ((b[1] - a[1]) / (n - 1));
+
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < count; k++)
+  {
+    SliceGrid(n, stack[k], c + z * (k * spacing) + x * a[0] + y * a[1], dx, dy);
+  }
+}
+
+/*!
+\brief Compute the cross-section of the implicit surface over a planar grid, with marching squares.
+\param n Number of samples along every axis of the grid.
+\param contours Returned contours.
+\param o Lower corner of the grid.
+\param dx,dy Steps of the grid.
+*/
+void AnalyticScalarField::SliceGrid(int n, std::vector<Contour>& contours, const Vector& o, const Vector& dx, const Vector& dy) const
+{
+  // Straddling edges for every configuration, edges are numbered as bottom, right, top and left
+  static const int segments[16][4] = {
+    { -1, -1, -1, -1 }, { 3, 0, -1, -1 }, { 0, 1, -1, -1 }, { 3, 1, -1, -1 },
+    { 1, 2, -1, -1 }, { 3, 0, 1, 2 }, { 0, 2, -1, -1 }, { 3, 2, -1, -1 },
+    { 2, 3, -1, -1 }, { 0, 2, -1, -1 }, { 0, 1, 2, 3 }, { 1, 2, -1, -1 },
+    { 1, 3, -1, -1 }, { 0, 1, -1, -1 }, { 3, 0, -1, -1 }, { -1, -1, -1, -1 } };
+
+  // Intensities
+  std::vector<double> v(n * n);
+
+#pragma omp parallel for
+  for (int j = 0; j < n; j++)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      v[j * n + i] = Value(o + double(i) * dx + double(j) * dy);
+    }
+  }
+
+  // Segments, keyed by the edges of the grid
+  std::vector<std::vector<long long>> keys(n);
+  std::vector<std::vector<Vector>> points(n);
+
+#pragma omp parallel for
+  for (int j = 0; j < n - 1; j++)
+  {
+    for (int i = 0; i < n - 1; i++)
+    {
+      const int c[4] = { j * n + i, j * n + i + 1, (j + 1) * n + i + 1, (j + 1) * n + i };
+      int index = 0;
+      for (int k = 0; k < 4; k++)
+      {
+        if (v[c[k]] < 0.0)
+          index |= 1 << k;
+      }
+      if (index == 0 || index == 15)
+        continue;
+
+      // Ambiguous configurations: the inside corners are connected if the center is inside
+      int e[4] = { segments[index][0], segments[index][1], segments[index][2], segments[index][3] };
+      if ((index == 5 || index == 10) && (v[c[0]] + v[c[1]] + v[c[2]] + v[c[3]]) < 0.0)
+      {
+        const int r = (index == 5) ? 0 : 3;
+        for (int k = 0; k < 4; k++)
+          e[k] = (k + r) % 4;
+      }
+
+      for (int k = 0; k < 4 && e[k] != -1; k++)
+      {
+        // End vertices of the edge of the grid
+        const int a = c[e[k]];
+        const int b = c[(e[k] + 1) % 4];
+        const int l = Math::Min(a, b);
+        keys[j].push_back(2 * (long long)(l) + ((e[k] % 2) ? 1 : 0));
+
+        const double t = v[a] / (v[a] - v[b]);
+        const Vector pa = o + double(a % n) * dx + double(a / n) * dy;
+        const Vector pb = o + double(b % n) * dx + double(b / n) * dy;
+        points[j].push_back(pa + t * (pb - pa));
+      }
+    }
+  }
 
-  g = Mesh(vertex, normal, triangle, normals);
+  std::vector<long long> all;
+  std::vector<Vector> ends;
+  for (int j = 0; j < n; j++)
+  {
+    all.insert(all.end(), keys[j].begin(), keys[j].end());
+    ends.insert(ends.end(), points[j].begin(), points[j].end());
+  }
+  Contour::Chain(all, ends, contours);
 }
 
 /*!
@@ -277,6 +418,75 @@ Vector AnalyticScalarField::Dichotomy(Vector a, Vector b, double va, double vb,
 }
 
 
+/*!
+\brief Return the Lipschitz constant of the field.
+
+The default field is a signed distance function, whose Lipschitz constant is 1.
+Derived classes should override this function, as it bounds the steps of AnalyticScalarField::Intersect().
+*/
+double AnalyticScalarField::K() const
+{
+  return 1.0;
+}
+
+/*!
+\brief Compute a conservative signed distance to the surface.
+
+The returned value should never exceed the distance to the surface when positive, and be negative inside.
+The default implementation relies on the Lipschitz constant.
+
+Hierarchical fields such as blend trees should override this function and return the distance
+to the bounding boxes of their nodes for points outside those boxes, so that
+AnalyticScalarField::Intersect() skips empty space in a few steps.
+\param p Point.
+*/
+double AnalyticScalarField::Distance(const Vector& p) const
+{
+  return Value(p) / K();
+}
+
+/*!
+\brief Compute the first intersection between a ray and the implicit surface.
+
+The ray is marched with sphere tracing, using the conservative distance provided by AnalyticScalarField::Distance().
+Once a step crosses the surface, the intersection is refined by dichotomy.
+
+Rays starting inside the surface return an intersection at the origin.
+\param ray The ray (direction should be of unit length).
+\param t Returned intersection depth.
+\param length Maximum depth.
+\param epsilon Precision, which is also the minimum step.
+\return True if the ray hits the surface.
+*/
+bool AnalyticScalarField::Intersect(const Ray& ray, double& t, const double& length, const double& epsilon) const
+{
+  t = 0.0;
+  double d = Distance(ray(t));
+  if (d < 0.0)
+  {
+    return true;
+  }
+
+  while (t < length)
+  {
+    // The last step stops at the maximum depth, so that intersections beyond it are not reported
+    const double step = Math::Min(Math::Max(d, epsilon), length - t);
+    d = Distance(ray(t + step));
+
+    // Crossed the surface
+    if (d < 0.0)
+    {
+      const Vector a = ray(t);
+      const Vector b = ray(t + step);
+      const Vector p = Dichotomy(a, b, Value(a), Value(b), step, epsilon);
+      t = (p - ray.Origin()) * ray.Direction();
+      return true;
+    }
+    t += step;
+  }
+  return false;
+}
+
 /*!
 \brief Compute the gradient of the field.
 \param p Point.
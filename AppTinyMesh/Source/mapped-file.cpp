@@ -0,0 +1,131 @@
+#include "mapped-file.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*!
+\class MappedFile mapped-file.h
+\brief A read-only memory mapped file.
+
+Mapping a file avoids copying it through stream buffers, pages are loaded by the system as they are accessed
+and can be read concurrently by several threads.
+
+\code
+MappedFile file("bunny.obj");
+if (file.IsOpen())
+{
+  const char* p = file.Data();
+  const char* e = p + file.Size();
+}
+\endcode
+*/
+
+/*!
+\brief Map a file.
+\param url File name.
+*/
+MappedFile::MappedFile(const std::string& url)
+{
+  Open(url);
+}
+
+/*!
+\brief Unmap the file.
+*/
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+/*!
+\brief Map a file, the previously mapped file is closed.
+\param url File name.
+\return Success.
+*/
+bool MappedFile::Open(const std::string& url)
+{
+  Close();
+
+#ifdef _WIN32
+  HANDLE h = CreateFileA(url.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (h == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER length;
+  if (!GetFileSizeEx(h, &length))
+  {
+    CloseHandle(h);
+    return false;
+  }
+  file = h;
+  size = size_t(length.QuadPart);
+  if (size == 0)
+    return true;
+
+  mapping = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping != nullptr)
+    data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+  const int fd = open(url.c_str(), O_RDONLY);
+  if (fd == -1)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    return false;
+  }
+  file = fd;
+  size = size_t(info.st_size);
+  if (size == 0)
+    return true;
+
+  void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p != MAP_FAILED)
+  {
+    data = (const char*)p;
+    madvise(p, size, MADV_SEQUENTIAL);
+  }
+#endif
+
+  if (data == nullptr)
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+/*!
+\brief Unmap the file.
+*/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+  if (data != nullptr)
+    UnmapViewOfFile(data);
+  if (mapping != nullptr)
+    CloseHandle(mapping);
+  if (file != nullptr)
+    CloseHandle(file);
+  mapping = nullptr;
+  file = nullptr;
+#else
+  if (data != nullptr)
+    munmap((void*)data, size);
+  if (file != -1)
+    close(file);
+  file = -1;
+#endif
+  data = nullptr;
+  size = 0;
+}
@@ -0,0 +1,714 @@
+#include "mesh-bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+/*!
+\brief Box in single precision, used to bin the triangles.
+*/
+class MeshBvhBox
+{
+public:
+  float a[3] = { INFINITY, INFINITY, INFINITY };    //!< Lower vertex.
+  float b[3] = { -INFINITY, -INFINITY, -INFINITY }; //!< Upper vertex.
+public:
+  //! Extend the box to include a point.
+  void Extend(const float p[3])
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      a[i] = std::min(a[i], p[i]);
+      b[i] = std::max(b[i], p[i]);
+    }
+  }
+  //! Extend the box to include another box.
+  void Extend(const MeshBvhBox& box)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      a[i] = std::min(a[i], box.a[i]);
+      b[i] = std::max(b[i], box.b[i]);
+    }
+  }
+  //! Half of the area of the box, 0 if empty.
+  float Area() const
+  {
+    if (a[0] > b[0])
+      return 0.0f;
+    const float x = b[0] - a[0], y = b[1] - a[1], z = b[2] - a[2];
+    return x * y + y * z + z * x;
+  }
+};
+
+/*!
+\brief Bin of the surface area heuristic.
+*/
+class MeshBvhBin
+{
+public:
+  MeshBvhBox box; //!< Box of the triangles.
+  int count = 0;  //!< Number of triangles.
+};
+
+/*!
+\brief Triangle to be sorted in the hierarchy, its box and centroid are stored alongside so that splits read contiguous memory.
+*/
+class MeshBvhItem
+{
+public:
+  MeshBvhBox box;    //!< Box.
+  float center[3];   //!< Centroid of the box.
+  int triangle;      //!< Triangle index.
+};
+
+/*!
+\brief Range of triangles to be split in the node of a hierarchy.
+*/
+class MeshBvhTask
+{
+public:
+  int node;  //!< Node.
+  int begin; //!< First triangle.
+  int end;   //!< End of the range.
+  int depth; //!< Depth of the node.
+  int mid;   //!< Returned first triangle of the second child, -1 for leaves.
+};
+
+/*!
+\brief Process blocks of items, in parallel if there are several blocks.
+
+Small nodes use a single block, which avoids starting a parallel region for every node.
+\param n Number of blocks.
+\param f Function processing a block.
+*/
+template<typename F>
+static void Blocks(int n, const F& f)
+{
+  if (n == 1)
+  {
+    f(0);
+    return;
+  }
+#pragma omp parallel for
+  for (int k = 0; k < n; k++)
+    f(k);
+}
+
+//! Round to the closest float below.
+static inline float RoundDown(double x)
+{
+  const float f = float(x);
+  return (double(f) > x) ? std::nextafter(f, -INFINITY) : f;
+}
+
+//! Round to the closest float above.
+static inline float RoundUp(double x)
+{
+  const float f = float(x);
+  return (double(f) < x) ? std::nextafter(f, INFINITY) : f;
+}
+
+/*!
+\class MeshBvh mesh-bvh.h
+\brief A bounding volume hierarchy over the triangles of a mesh, for ray queries.
+
+The hierarchy is a binary tree of single precision boxes built with the binned surface area heuristic. Nodes are stored
+in a flat array, siblings are adjacent so that inner nodes only reference their first child, and the triangles of every leaf
+are stored in a TrianglePacket and intersected in parallel. Closest hits are found in logarithmic time on average, visiting the nearest child first, and occlusion
+queries stop at the first hit. Coherent rays are traced in packets of RayPacket::Width rays that traverse the hierarchy together,
+and large batches of rays are sorted into coherent packets, see MeshBvh::Intersect(const std::vector<Ray>&, std::vector<MeshHit>&) const.
+
+The hierarchy of a mesh is cached, see Mesh::Bvh().
+\code
+Mesh mesh(Sphere(Vector(0.0), 1.0), 500);
+double t, u, v;
+int triangle;
+if (mesh.Intersect(Ray(Vector(0.0, 0.0, 5.0), Vector(0.0, 0.0, -1.0)), t, triangle, u, v))
+{
+  Vector p = mesh.GetTriangle(triangle).Vertex(u, v);
+}
+\endcode
+*/
+
+/*!
+\brief Build the hierarchy of a mesh.
+
+Nodes are split level by level. Binning and partitioning are parallel within the few large nodes near the root,
+and the nodes of the lower levels are split in parallel.
+\param mesh The mesh.
+*/
+MeshBvh::MeshBvh(const Mesh& mesh)
+{
+  const int nt = mesh.Triangles();
+  const int Bins = 16;
+  const float Cost = 2.0f; // Cost of intersecting a packet, relative to the cost of traversing a node
+  auto Leaves = [](int n) { return float((n + Leaf - 1) / Leaf); };
+
+  // Boxes and centroids of the triangles
+  std::vector<MeshBvhItem> items(nt);
+#pragma omp parallel for
+  for (int t = 0; t < nt; t++)
+  {
+    const Vector p[3] = { mesh.vertices[mesh.varray[3 * t]], mesh.vertices[mesh.varray[3 * t + 1]], mesh.vertices[mesh.varray[3 * t + 2]] };
+    for (int i = 0; i < 3; i++)
+    {
+      const double a = std::min(p[0][i], std::min(p[1][i], p[2][i]));
+      const double b = std::max(p[0][i], std::max(p[1][i], p[2][i]));
+      items[t].box.a[i] = RoundDown(a);
+      items[t].box.b[i] = RoundUp(b);
+      items[t].center[i] = float(0.5 * (a + b));
+    }
+    items[t].triangle = t;
+  }
+
+  // Split the range of a task, and compute the box of its node
+  std::vector<MeshBvhItem> scratch;
+  auto split = [&](MeshBvhTask& task, bool parallel)
+  {
+    const int n = task.end - task.begin;
+    const int nk = parallel ? 64 : 1;
+    const int length = (n + nk - 1) / nk;
+
+    // Boxes of the triangles and of their centroids, small nodes use local arrays
+    std::vector<MeshBvhBox> boxblocks(parallel ? 2 * nk : 0);
+    MeshBvhBox boxlocal[2];
+    MeshBvhBox* box = parallel ? &boxblocks[0] : boxlocal;
+    MeshBvhBox* center = box + nk;
+    auto bound = [&](int k)
+    {
+      for (int i = task.begin + k * length; i < task.end && i < task.begin + (k + 1) * length; i++)
+      {
+        box[k].Extend(items[i].box);
+        center[k].Extend(items[i].center);
+      }
+    };
+    Blocks(nk, bound);
+    for (int k = 1; k < nk; k++)
+    {
+      box[0].Extend(box[k]);
+      center[0].Extend(center[k]);
+    }
+    MeshBvhNode& node = nodes[task.node];
+    for (int i = 0; i < 3; i++)
+    {
+      node.a[i] = box[0].a[i];
+      node.b[i] = box[0].b[i];
+    }
+    task.mid = -1;
+    if (n <= 1)
+      return;
+
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+    {
+      if (center[0].b[i] - center[0].a[i] > center[0].b[axis] - center[0].a[axis])
+        axis = i;
+    }
+    const float extent = center[0].b[axis] - center[0].a[axis];
+
+    // Median split when centroids are equal, or to bound the depth
+    if (extent <= 0.0f || task.depth >= Depth / 2)
+    {
+      if (n <= Leaf)
+        return;
+      task.mid = task.begin + n / 2;
+      if (extent > 0.0f)
+      {
+        std::nth_element(items.begin() + task.begin, items.begin() + task.mid, items.begin() + task.end,
+          [axis](const MeshBvhItem& x, const MeshBvhItem& y) { return x.center[axis] < y.center[axis]; });
+      }
+      return;
+    }
+
+    // Bins along the axis of largest extent of the centroids, after Wald, On fast construction of SAH-based bounding volume hierarchies
+    const float scale = float(Bins) * (1.0f - 1.0e-6f) / extent;
+    auto bin = [&](const MeshBvhItem& item)
+    {
+      const int j = int((item.center[axis] - center[0].a[axis]) * scale);
+      return std::min(std::max(j, 0), Bins - 1);
+    };
+    std::vector<MeshBvhBin> binblocks(parallel ? size_t(nk) * Bins : 0);
+    MeshBvhBin binlocal[Bins];
+    MeshBvhBin* bins = parallel ? &binblocks[0] : binlocal;
+    auto fill = [&](int k)
+    {
+      MeshBvhBin* local = &bins[size_t(k) * Bins];
+      for (int j = task.begin + k * length; j < task.end && j < task.begin + (k + 1) * length; j++)
+      {
+        MeshBvhBin& b = local[bin(items[j])];
+        b.box.Extend(items[j].box);
+        b.count++;
+      }
+    };
+    Blocks(nk, fill);
+    for (int k = 1; k < nk; k++)
+    {
+      for (int j = 0; j < Bins; j++)
+      {
+        bins[j].box.Extend(bins[size_t(k) * Bins + j].box);
+        bins[j].count += bins[size_t(k) * Bins + j].count;
+      }
+    }
+
+    // Surface area heuristic, triangles are intersected by packets
+    float best = INFINITY;
+    int plane = -1;
+    float right[Bins];
+    MeshBvhBox r;
+    int count = 0;
+    for (int j = Bins - 1; j > 0; j--)
+    {
+      r.Extend(bins[j].box);
+      count += bins[j].count;
+      right[j] = r.Area() * Leaves(count);
+    }
+    MeshBvhBox l;
+    count = 0;
+    for (int j = 1; j < Bins; j++)
+    {
+      l.Extend(bins[j - 1].box);
+      count += bins[j - 1].count;
+      const float cost = l.Area() * Leaves(count) + right[j];
+      if (count > 0 && count < n && cost < best)
+      {
+        best = cost;
+        plane = j;
+      }
+    }
+    const float area = box[0].Area();
+    best = (area > 0.0f) ? 1.0f + Cost * best / area : INFINITY;
+    if (n <= Leaf && Cost <= best)
+      return;
+    if (plane < 0)
+    {
+      task.mid = task.begin + n / 2;
+      return;
+    }
+
+    // Partition, large nodes are partitioned in parallel with a stable counting sort
+    if (parallel)
+    {
+      std::vector<int> key(n), start, item;
+#pragma omp parallel for
+      for (int j = 0; j < n; j++)
+        key[j] = (bin(items[task.begin + j]) < plane) ? 0 : 1;
+      Mesh::Buckets(key, 2, start, item);
+      scratch.resize(nt);
+#pragma omp parallel for
+      for (int j = 0; j < n; j++)
+        scratch[task.begin + j] = items[task.begin + item[j]];
+      std::copy(scratch.begin() + task.begin, scratch.begin() + task.end, items.begin() + task.begin);
+      task.mid = task.begin + start[1];
+    }
+    else
+    {
+      task.mid = int(std::partition(items.begin() + task.begin, items.begin() + task.end,
+        [&](const MeshBvhItem& item) { return bin(item) < plane; }) - items.begin());
+    }
+  };
+
+  // Nodes are split level by level, large nodes one at a time with parallel loops, the others in parallel
+  nodes.reserve(nt > 0 ? 2 * size_t((nt + Leaf - 1) / Leaf) : 1);
+  nodes.push_back(MeshBvhNode());
+  std::vector<MeshBvhTask> tasks(1, MeshBvhTask{ 0, 0, nt, 0, -1 });
+  std::vector<MeshBvhTask> next;
+  const int large = 1 << 16;
+  while (!tasks.empty())
+  {
+    for (MeshBvhTask& task : tasks)
+    {
+      if (task.end - task.begin >= large)
+        split(task, true);
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < int(tasks.size()); i++)
+    {
+      if (tasks[i].end - tasks[i].begin < large)
+        split(tasks[i], false);
+    }
+
+    next.clear();
+    for (const MeshBvhTask& task : tasks)
+    {
+      MeshBvhNode& node = nodes[task.node];
+      if (task.mid < 0)
+      {
+        node.index = task.begin;
+        node.count = task.end - task.begin;
+        continue;
+      }
+      const int child = int(nodes.size());
+      node.index = child;
+      node.count = 0;
+      nodes.push_back(MeshBvhNode());
+      nodes.push_back(MeshBvhNode());
+      next.push_back(MeshBvhTask{ child, task.begin, task.mid, task.depth + 1, -1 });
+      next.push_back(MeshBvhTask{ child + 1, task.mid, task.end, task.depth + 1, -1 });
+    }
+    tasks.swap(next);
+  }
+  nodes.shrink_to_fit();
+
+  // Packets of the leaves
+  std::vector<int> leaves;
+  for (int i = 0; i < int(nodes.size()); i++)
+  {
+    if (nodes[i].count > 0)
+      leaves.push_back(i);
+  }
+  const int nl = int(leaves.size());
+  packets.resize(nl);
+  triangles.assign(size_t(nl) * Leaf, -1);
+#pragma omp parallel for
+  for (int i = 0; i < nl; i++)
+  {
+    MeshBvhNode& node = nodes[leaves[i]];
+    for (int j = 0; j < node.count; j++)
+    {
+      const int t = items[node.index + j].triangle;
+      triangles[i * Leaf + j] = t;
+      packets[i].Set(j, mesh.vertices[mesh.varray[3 * t]], mesh.vertices[mesh.varray[3 * t + 1]], mesh.vertices[mesh.varray[3 * t + 2]]);
+    }
+    node.index = i;
+  }
+}
+
+/*!
+\brief Ray in single precision, with the inverse of its direction, for box tests.
+*/
+class MeshBvhRay
+{
+public:
+  float o[3];   //!< Origin.
+  float inv[3]; //!< Inverse of the direction.
+public:
+  //! Convert a ray, null components of the direction are replaced by tiny ones.
+  explicit MeshBvhRay(const Ray& ray)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      const double d = ray.Direction()[i];
+      o[i] = float(ray.Origin()[i]);
+      inv[i] = float(1.0 / ((std::fabs(d) > 1.0e-30) ? d : (d < 0.0 ? -1.0e-30 : 1.0e-30)));
+    }
+  }
+
+  /*!
+  \brief Intersect a node.
+  \param node The node.
+  \param length Maximum distance.
+  \param t Returned entry distance.
+  */
+  bool Intersect(const MeshBvhNode& node, float length, float& t) const
+  {
+    float ta = 0.0f, tb = length;
+    for (int i = 0; i < 3; i++)
+    {
+      float x = (node.a[i] - o[i]) * inv[i];
+      float y = (node.b[i] - o[i]) * inv[i];
+      if (x > y)
+        std::swap(x, y);
+      ta = std::max(ta, x);
+      // Rounding of the distances, after Ize, Robust BVH ray traversal
+      tb = std::min(tb, y * 1.0000004f);
+    }
+    t = ta;
+    return ta <= tb;
+  }
+};
+
+/*!
+\brief Compute the closest intersection between a ray and the mesh, in front of the origin of the ray.
+\param ray The ray.
+\param t Returned intersection depth.
+\param triangle Returned index of the intersected triangle in the mesh.
+\param u,v Returned parametric coordinates of the intersection in the triangle.
+*/
+bool MeshBvh::Intersect(const Ray& ray, double& t, int& triangle, double& u, double& v) const
+{
+  if (packets.empty())
+    return false;
+  const MeshBvhRay r(ray);
+  const TrianglePacketRay tr(ray);
+  int stack[Depth];
+  int size = 0;
+  double length = INFINITY;
+  float entry;
+  triangle = -1;
+
+  int i = 0;
+  if (!r.Intersect(nodes[0], float(length), entry))
+    return false;
+  for (;;)
+  {
+    const MeshBvhNode& node = nodes[i];
+    if (node.count > 0)
+    {
+      const int j = packets[node.index].Intersect(tr, length, u, v);
+      if (j >= 0)
+        triangle = node.index * Leaf + j;
+    }
+    else
+    {
+      // Nearest child first
+      float ta, tb;
+      const bool ha = r.Intersect(nodes[node.index], float(length), ta);
+      const bool hb = r.Intersect(nodes[node.index + 1], float(length), tb);
+      if (ha && hb)
+      {
+        i = (ta <= tb) ? node.index : node.index + 1;
+        stack[size++] = (ta <= tb) ? node.index + 1 : node.index;
+        continue;
+      }
+      if (ha || hb)
+      {
+        i = ha ? node.index : node.index + 1;
+        continue;
+      }
+    }
+
+    // Nodes farther than the closest intersection are skipped
+    for (;;)
+    {
+      if (size == 0)
+      {
+        if (triangle < 0)
+          return false;
+        t = length;
+        triangle = triangles[triangle];
+        return true;
+      }
+      i = stack[--size];
+      if (r.Intersect(nodes[i], float(length), entry))
+        break;
+    }
+  }
+}
+
+/*!
+\brief Check if a ray intersects the mesh before a given distance.
+\param ray The ray.
+\param length Distance.
+*/
+bool MeshBvh::Occluded(const Ray& ray, double length) const
+{
+  if (packets.empty())
+    return false;
+  const MeshBvhRay r(ray);
+  const TrianglePacketRay tr(ray);
+  int stack[Depth];
+  int size = 0;
+  float entry;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    const MeshBvhNode& node = nodes[stack[--size]];
+    if (!r.Intersect(node, float(length), entry))
+      continue;
+    if (node.count > 0)
+    {
+      if (packets[node.index].Occluded(tr, length))
+        return true;
+    }
+    else
+    {
+      stack[size++] = node.index + 1;
+      stack[size++] = node.index;
+    }
+  }
+  return false;
+}
+
+/*!
+\brief Compute the closest intersections between a packet of coherent rays and the mesh.
+
+The rays traverse the hierarchy together: nodes are culled for the whole packet with interval arithmetic, then tested against
+all the rays at once, and the triangles of the leaves are only tested against the rays that reach them. This is faster than
+single rays when the rays have close origins and directions, such as the rays through neighboring pixels of a camera.
+\param rays Rays, at most RayPacket::Width.
+\param n Number of rays.
+\param hits Returned intersections, the triangle is -1 for the rays that miss the mesh.
+*/
+void MeshBvh::Intersect(const Ray* rays, int n, MeshHit* hits) const
+{
+  n = std::min(n, int(RayPacket::Width));
+  for (int i = 0; i < n; i++)
+    hits[i] = MeshHit();
+  if (packets.empty() || n <= 0)
+    return;
+  const RayPacket packet(rays, n);
+  TrianglePacketRay tr[RayPacket::Width];
+  double length[RayPacket::Width];
+  alignas(32) float bound[RayPacket::Width];
+  for (int i = 0; i < RayPacket::Width; i++)
+  {
+    if (i < n)
+      tr[i] = TrianglePacketRay(rays[i]);
+    length[i] = INFINITY;
+    bound[i] = INFINITY;
+  }
+  float farthest = INFINITY;
+
+  int stack[Depth];
+  int size = 0;
+  stack[size++] = 0;
+  while (size > 0)
+  {
+    const MeshBvhNode& node = nodes[stack[--size]];
+    if (packet.Culled(node.a, node.b, farthest))
+      continue;
+    int mask = packet.Intersect(node.a, node.b, bound);
+    if (mask == 0)
+      continue;
+    if (node.count > 0)
+    {
+      bool hit = false;
+      for (int i = 0; mask != 0; i++, mask >>= 1)
+      {
+        if ((mask & 1) == 0)
+          continue;
+        const int j = packets[node.index].Intersect(tr[i], length[i], hits[i].u, hits[i].v);
+        if (j >= 0)
+        {
+          hits[i].triangle = node.index * Leaf + j;
+          bound[i] = RoundUp(length[i]);
+          hit = true;
+        }
+      }
+      if (hit)
+        farthest = *std::max_element(bound, bound + n);
+    }
+    else
+    {
+      // Nearest child along the average direction first
+      const MeshBvhNode& a = nodes[node.index];
+      const MeshBvhNode& b = nodes[node.index + 1];
+      const bool first = packet.Order(a.a, a.b) <= packet.Order(b.a, b.b);
+      stack[size++] = first ? node.index + 1 : node.index;
+      stack[size++] = first ? node.index : node.index + 1;
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    if (hits[i].triangle >= 0)
+    {
+      hits[i].t = length[i];
+      hits[i].triangle = triangles[hits[i].triangle];
+    }
+  }
+}
+
+/*!
+\brief Compute the closest intersections between a stream of rays and the mesh.
+
+Rays are sorted along the Morton curve of a point at the scale of the hierarchy on every ray, so that packets gather
+rays with close origins and directions whatever the order of the stream, and the packets are traced in parallel.
+\param rays Rays.
+\param hits Returned intersections, in the order of the rays.
+*/
+void MeshBvh::Intersect(const std::vector<Ray>& rays, std::vector<MeshHit>& hits) const
+{
+  const int n = int(rays.size());
+  hits.assign(n, MeshHit());
+  if (packets.empty() || n == 0)
+    return;
+
+  const Vector a(nodes[0].a[0], nodes[0].a[1], nodes[0].a[2]);
+  const Vector b(nodes[0].b[0], nodes[0].b[1], nodes[0].b[2]);
+  const double r = Norm(b - a);
+  std::vector<Vector> points(n);
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+    points[i] = rays[i].Origin() + r * rays[i].Direction();
+  const std::vector<int> order = Mesh::MortonOrder(points, Box(points));
+
+  const int m = (n + RayPacket::Width - 1) / RayPacket::Width;
+#pragma omp parallel for schedule(dynamic, 16)
+  for (int k = 0; k < m; k++)
+  {
+    const int* index = order.data() + k * RayPacket::Width;
+    const int c = std::min(int(RayPacket::Width), n - k * RayPacket::Width);
+    Ray packet[RayPacket::Width];
+    MeshHit hit[RayPacket::Width];
+    for (int i = 0; i < c; i++)
+      packet[i] = rays[index[i]];
+    Intersect(packet, c, hit);
+    for (int i = 0; i < c; i++)
+      hits[index[i]] = hit[i];
+  }
+}
+
+/*!
+\brief Return the bounding volume hierarchy of the mesh, which is built on the first call and released when the mesh is edited.
+
+The first call may come from several threads, for instance from a parallel loop of ray queries: the build is guarded by a mutex,
+and the other threads wait for the hierarchy. It then uses a single thread, though, since nested parallel regions are disabled,
+so call this function before parallel queries to build the hierarchy in parallel. Every call reads the cached pointer atomically:
+parallel loops of single ray queries should keep the reference to the hierarchy and query it directly.
+\code
+const MeshBvh& bvh = mesh.Bvh();
+#pragma omp parallel for
+for (int i = 0; i < n; i++)
+{
+  bvh.Intersect(rays[i], t[i], triangle[i], u[i], v[i]);
+}
+\endcode
+*/
+const MeshBvh& Mesh::Bvh() const
+{
+  std::shared_ptr<const MeshBvh> hierarchy = std::atomic_load(&bvh);
+  if (!hierarchy)
+  {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    hierarchy = std::atomic_load(&bvh);
+    if (!hierarchy)
+    {
+      hierarchy = std::make_shared<const MeshBvh>(*this);
+      std::atomic_store(&bvh, hierarchy);
+    }
+  }
+  return *hierarchy;
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the mesh, in front of the origin of the ray.
+
+The query uses the bounding volume hierarchy of the mesh, which is built on the first call, see Mesh::Bvh() for parallel queries.
+\param ray The ray.
+\param t Returned intersection depth.
+\param triangle Returned index of the intersected triangle.
+\param u,v Returned parametric coordinates of the intersection in the triangle.
+*/
+bool Mesh::Intersect(const Ray& ray, double& t, int& triangle, double& u, double& v) const
+{
+  return Bvh().Intersect(ray, t, triangle, u, v);
+}
+
+/*!
+\brief Check if a ray intersects the mesh between its origin and a given distance.
+
+The query uses the bounding volume hierarchy of the mesh, which is built on the first call, see Mesh::Bvh() for parallel queries.
+\param ray The ray.
+\param length Distance.
+*/
+bool Mesh::Occluded(const Ray& ray, double length) const
+{
+  return Bvh().Occluded(ray, length);
+}
+
+/*!
+\brief Compute the closest intersections between a stream of rays and the mesh.
+
+Rays are traced in packets of coherent rays, see MeshBvh, which is faster than single queries for large batches,
+such as the rays through all the pixels of a camera. The hierarchy is built, in parallel, before the rays are traced in parallel.
+\param rays Rays.
+\param hits Returned intersections, in the order of the rays.
+*/
+void Mesh::Intersect(const std::vector<Ray>& rays, std::vector<MeshHit>& hits) const
+{
+  const MeshBvh& hierarchy = Bvh();
+  hierarchy.Intersect(rays, hits);
+}
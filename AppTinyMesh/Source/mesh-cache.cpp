@@ -0,0 +1,272 @@
+#include "mesh-cache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+
+static_assert(sizeof(Vector) == 3 * sizeof(double), "Vectors are stored as three doubles");
+static_assert(sizeof(Color) == 4 * sizeof(double), "Colors are stored as four doubles");
+
+//! Magic string of the files.
+static const char MeshCacheMagic[8] = { 'T', 'M', 'E', 'S', 'H', 'B', 'I', 'N' };
+
+//! Byte order marker.
+static const uint32_t MeshCacheEndian = 0x01020304;
+
+//! Size of the elements of the arrays.
+static const uint64_t MeshCacheSizes[6] = { sizeof(Vector), sizeof(Vector), sizeof(int), sizeof(int), sizeof(Color), sizeof(int) };
+
+/*!
+\class MeshCache mesh-cache.h
+\brief Native binary mesh files that are memory mapped and used without parsing.
+
+The file starts with a header followed by the arrays of vertices, normals, vertex and normal indexes,
+and optionally colors and color indexes, aligned on 64 bytes. Arrays are stored in the memory layout of the host,
+so that they can be accessed directly in the mapped file. Files written on a host with a different byte order are rejected.
+Normal and color indexes are not stored if they share the vertex indexes.
+
+Opening a file only checks the header, which is fast and does not depend on the size of the file.
+The checksum of the arrays and the range of the indexes are checked on demand with MeshCache::Validate().
+
+\code
+MeshCache::Save("bunny.mesh", mesh);
+
+MeshCache cache;
+if (cache.Open("bunny.mesh"))
+{
+  const Vector* v = cache.GetVertices();
+  const int* t = cache.GetVertexIndexes();
+}
+\endcode
+*/
+
+/*!
+\brief Compute the checksum of a block of memory.
+
+Blocks of one megabyte are hashed in parallel with four independent lanes of 64-bit words,
+and the hashes of the blocks are combined in order, so that the result does not depend on the number of threads.
+\param p Data.
+\param n Size in bytes.
+*/
+uint64_t MeshCache::Checksum(const char* p, uint64_t n)
+{
+  const uint64_t prime[2] = { 0x9E3779B185EBCA87ULL, 0xC2B2AE3D27D4EB4FULL };
+  auto mix = [&](uint64_t h, uint64_t x) -> uint64_t
+  {
+    h += x * prime[1];
+    h = (h << 31) | (h >> 33);
+    return h * prime[0];
+  };
+
+  const uint64_t length = 1 << 20;
+  const int nb = int((n + length - 1) / length);
+  std::vector<uint64_t> hash(nb);
+
+#pragma omp parallel for
+  for (int b = 0; b < nb; b++)
+  {
+    const char* q = p + b * length;
+    const uint64_t size = (b == nb - 1) ? n - b * length : length;
+    uint64_t h[4] = { prime[0], prime[1], prime[0] ^ prime[1], prime[0] + prime[1] };
+    uint64_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+      uint64_t x[4];
+      memcpy(x, q + i, 32);
+      for (int k = 0; k < 4; k++)
+        h[k] = mix(h[k], x[k]);
+    }
+    for (; i < size; i++)
+    {
+      h[0] = mix(h[0], (unsigned char)q[i]);
+    }
+    hash[b] = mix(mix(mix(h[0], h[1]), h[2]), h[3]) ^ size;
+  }
+
+  uint64_t h = n;
+  for (int b = 0; b < nb; b++)
+    h = mix(h, hash[b]);
+  return h ^ (h >> 29);
+}
+
+/*!
+\brief Map a file and check its header.
+\param url File name.
+\param validate Also check the checksum and the indexes, see MeshCache::Validate().
+\return Success.
+*/
+bool MeshCache::Open(const std::string& url, bool validate)
+{
+  Close();
+  if (!file.Open(url) || file.Size() < sizeof(Header))
+  {
+    Close();
+    return false;
+  }
+
+  const Header* h = (const Header*)file.Data();
+  bool valid = memcmp(h->magic, MeshCacheMagic, 8) == 0 && h->version == Version && h->endian == MeshCacheEndian;
+  valid = valid && h->check == Checksum((const char*)h, offsetof(Header, check));
+  for (int a = 0; a < Arrays && valid; a++)
+  {
+    valid = h->offset[a] % 64 == 0 && h->size[a] < (uint64_t(1) << 31) && h->offset[a] <= file.Size() && h->size[a] * MeshCacheSizes[a] <= file.Size() - h->offset[a];
+  }
+  valid = valid && h->size[VertexIndexArray] % 3 == 0 && (h->size[NormalIndexArray] == 0 || h->size[NormalIndexArray] == h->size[VertexIndexArray]);
+  valid = valid && (h->size[ColorIndexArray] == 0 || h->size[ColorIndexArray] == h->size[VertexIndexArray]);
+  if (!valid)
+  {
+    Close();
+    return false;
+  }
+
+  header = h;
+  if (validate && !Validate())
+  {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+/*!
+\brief Unmap the file.
+*/
+void MeshCache::Close()
+{
+  file.Close();
+  header = nullptr;
+}
+
+/*!
+\brief Check the checksum of the arrays and the range of the indexes.
+
+This reads the whole file, indexes are checked in parallel.
+*/
+bool MeshCache::Validate() const
+{
+  if (header == nullptr)
+    return false;
+
+  const uint64_t begin = header->offset[VertexArray];
+  if (Checksum(file.Data() + begin, file.Size() - begin) != header->checksum)
+    return false;
+
+  const int* indexes[3] = { GetVertexIndexes(), GetNormalIndexes(), GetColorIndexes() };
+  const int range[3] = { Vertexes(), Normals(), Colors() };
+  const int n = int(header->size[VertexIndexArray]);
+  int invalid = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    if (k == 2 && header->size[ColorArray] == 0)
+      continue;
+#pragma omp parallel for reduction(+:invalid)
+    for (int i = 0; i < n; i++)
+    {
+      if (indexes[k][i] < 0 || indexes[k][i] >= range[k])
+        invalid++;
+    }
+  }
+  return invalid == 0;
+}
+
+/*!
+\brief Create a mesh from the mapped file, the arrays are copied.
+
+The mesh is empty if no file is open.
+*/
+Mesh MeshCache::GetMesh() const
+{
+  if (header == nullptr)
+    return Mesh();
+  const int n = int(header->size[VertexIndexArray]);
+  if (header->size[NormalIndexArray] == 0)
+    return Mesh(std::vector<Vector>(GetVertices(), GetVertices() + Vertexes()), std::vector<Vector>(GetNormals(), GetNormals() + Normals()),
+      std::vector<int>(GetVertexIndexes(), GetVertexIndexes() + n));
+  return Mesh(std::vector<Vector>(GetVertices(), GetVertices() + Vertexes()), std::vector<Vector>(GetNormals(), GetNormals() + Normals()),
+    std::vector<int>(GetVertexIndexes(), GetVertexIndexes() + n), std::vector<int>(GetNormalIndexes(), GetNormalIndexes() + n));
+}
+
+/*!
+\brief Create a colored mesh from the mapped file, the arrays are copied.
+
+Vertices are white if the file does not store colors.
+*/
+MeshColor MeshCache::GetMeshColor() const
+{
+  if (header == nullptr || header->size[ColorArray] == 0)
+    return MeshColor(GetMesh());
+
+  const int n = int(header->size[ColorIndexArray]);
+  return MeshColor(GetMesh(), std::vector<Color>(GetColors(), GetColors() + Colors()), std::vector<int>(GetColorIndexes(), GetColorIndexes() + n));
+}
+
+/*!
+\brief Save a mesh.
+\param url File name.
+\param mesh The mesh.
+\return Success.
+*/
+bool MeshCache::Save(const std::string& url, const Mesh& mesh)
+{
+  return Save(url, mesh, std::vector<Color>(), std::vector<int>());
+}
+
+/*!
+\brief Save a colored mesh.
+\param url File name.
+\param mesh The mesh.
+\return Success.
+*/
+bool MeshCache::Save(const std::string& url, const MeshColor& mesh)
+{
+  return Save(url, mesh, mesh.colors, mesh.carray);
+}
+
+/*!
+\brief Save a mesh with colors.
+
+The file is assembled in memory and written at once.
+\param url File name.
+\param mesh The mesh.
+\param colors,carray Colors and color indexes, which may be empty.
+\return Success.
+*/
+bool MeshCache::Save(const std::string& url, const Mesh& mesh, const std::vector<Color>& colors, const std::vector<int>& carray)
+{
+  const void* arrays[Arrays] = { mesh.vertices.data(), mesh.normals.data(), mesh.varray.data(), mesh.narray.data(), colors.data(), carray.data() };
+
+  Header h;
+  memset(&h, 0, sizeof(Header));
+  memcpy(h.magic, MeshCacheMagic, 8);
+  h.version = Version;
+  h.endian = MeshCacheEndian;
+  h.size[VertexArray] = mesh.vertices.size();
+  h.size[NormalArray] = mesh.normals.size();
+  h.size[VertexIndexArray] = mesh.varray.size();
+  h.size[NormalIndexArray] = mesh.narray.size();
+  h.size[ColorArray] = colors.size();
+  h.size[ColorIndexArray] = carray.size();
+
+  uint64_t offset = (sizeof(Header) + 63) / 64 * 64;
+  for (int a = 0; a < Arrays; a++)
+  {
+    h.offset[a] = offset;
+    offset += (h.size[a] * MeshCacheSizes[a] + 63) / 64 * 64;
+  }
+
+  std::vector<char> buffer(offset, 0);
+  for (int a = 0; a < Arrays; a++)
+  {
+    if (h.size[a] > 0)
+      memcpy(buffer.data() + h.offset[a], arrays[a], h.size[a] * MeshCacheSizes[a]);
+  }
+  h.checksum = Checksum(buffer.data() + h.offset[VertexArray], offset - h.offset[VertexArray]);
+  h.check = Checksum((const char*)&h, offsetof(Header, check));
+  memcpy(buffer.data(), &h, sizeof(Header));
+
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+  out.write(buffer.data(), buffer.size());
+  return bool(out);
+}
@@ -0,0 +1,408 @@
+#include "mesh-codec.h"
+#include "mapped-file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+/*!
+\brief Header of compressed meshes.
+*/
+struct MeshCodecHeader
+{
+  char magic[8];       //!< Magic string.
+  uint32_t version;    //!< Version.
+  uint32_t bits;       //!< Number of bits per quantized coordinate.
+  uint32_t vertices;   //!< Number of vertices.
+  uint32_t normals;    //!< Number of normals.
+  uint32_t indexes;    //!< Number of vertex indexes.
+  uint32_t shared;     //!< Shared flag, set if normal indexes are the same as vertex indexes.
+  double box[6];       //!< Bounding box of the vertices.
+};
+
+//! Magic string of compressed meshes.
+static const char MeshCodecMagic[8] = { 'T', 'M', 'E', 'S', 'H', 'C', 'D', 'C' };
+
+//! Number of indexes in a block, blocks are decoded in parallel.
+static const int MeshCodecBlock = 3 << 15;
+
+/*!
+\class MeshCodec mesh-codec.h
+\brief Compression of meshes.
+
+Vertices are quantized relative to the bounding box of the mesh with a configurable number of bits, and normals are
+stored with an octahedral encoding on two 16-bit integers. Vertices and normals are renumbered in the order of their first
+use by the triangles, so that indexes mostly grow slowly, and indexes are stored as differences with the previous index,
+with a zigzag and variable length encoding. Index streams are split into blocks that are encoded and decoded in parallel,
+normal indexes are not stored if they are the same as the vertex indexes.
+
+The compression ratio and the decoding throughput of the last mesh are reported by MeshCodec::Ratio() and MeshCodec::Throughput().
+
+\code
+MeshCodec codec(16);
+codec.Save("bunny.tmz", mesh);
+codec.Load("bunny.tmz", mesh);
+std::cout << codec.Ratio() << " " << codec.Throughput() << " GB/s" << std::endl;
+\endcode
+*/
+
+/*!
+\brief Create a codec.
+\param b Number of bits per quantized coordinate, clamped between 1 and 31.
+*/
+MeshCodec::MeshCodec(int b)
+{
+  bits = b < 1 ? 1 : (b > 31 ? 31 : b);
+}
+
+/*!
+\brief Renumber elements in the order of their first use.
+\param indexes Indexes.
+\param n Number of elements, unused elements are appended.
+\param order Returned new index of every element.
+\param inverse Returned element of every new index.
+*/
+void MeshCodec::Order(const std::vector<int>& indexes, int n, std::vector<int>& order, std::vector<int>& inverse)
+{
+  order.assign(n, -1);
+  inverse.clear();
+  inverse.reserve(n);
+  for (int i : indexes)
+  {
+    if (order[i] == -1)
+    {
+      order[i] = int(inverse.size());
+      inverse.push_back(i);
+    }
+  }
+  for (int i = 0; i < n; i++)
+  {
+    if (order[i] == -1)
+    {
+      order[i] = int(inverse.size());
+      inverse.push_back(i);
+    }
+  }
+}
+
+/*!
+\brief Octahedral encoding of a unit vector.
+\param n Vector.
+\param e Returned encoding.
+*/
+void MeshCodec::Octahedral(const Vector& n, int16_t e[2])
+{
+  const double l = fabs(n[0]) + fabs(n[1]) + fabs(n[2]);
+  double x = l > 0.0 ? n[0] / l : 0.0;
+  double y = l > 0.0 ? n[1] / l : 0.0;
+  if (n[2] < 0.0)
+  {
+    const double u = (1.0 - fabs(y)) * (x >= 0.0 ? 1.0 : -1.0);
+    const double v = (1.0 - fabs(x)) * (y >= 0.0 ? 1.0 : -1.0);
+    x = u;
+    y = v;
+  }
+  e[0] = int16_t(floor(Math::Clamp(x, -1.0, 1.0) * 32767.0 + 0.5));
+  e[1] = int16_t(floor(Math::Clamp(y, -1.0, 1.0) * 32767.0 + 0.5));
+}
+
+/*!
+\brief Decode a unit vector.
+\param e Octahedral encoding.
+*/
+Vector MeshCodec::Octahedral(const int16_t e[2])
+{
+  const double x = e[0] / 32767.0;
+  const double y = e[1] / 32767.0;
+  const double z = 1.0 - fabs(x) - fabs(y);
+  const double t = Math::Max(-z, 0.0);
+  return Normalized(Vector(x + (x >= 0.0 ? -t : t), y + (y >= 0.0 ? -t : t), z));
+}
+
+/*!
+\brief Compress a mesh.
+\param mesh The mesh.
+\param data Returned data.
+*/
+void MeshCodec::Encode(const Mesh& mesh, std::vector<char>& data)
+{
+  const std::vector<int>& varray = mesh.VertexIndexes();
+  const std::vector<int>& narray = mesh.NormalIndexes();
+  const bool shared = &varray == &narray || varray == narray;
+
+  int nn = 0;
+  for (int i : narray)
+    nn = std::max(nn, i + 1);
+
+  std::vector<int> vorder, vinverse, norder, ninverse;
+  Order(varray, mesh.Vertexes(), vorder, vinverse);
+  if (shared)
+  {
+    nn = std::max(nn, mesh.Vertexes());
+    norder = vorder;
+    ninverse = vinverse;
+  }
+  else
+  {
+    Order(narray, nn, norder, ninverse);
+  }
+
+  MeshCodecHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MeshCodecMagic, 8);
+  h.version = 1;
+  h.bits = bits;
+  h.vertices = mesh.Vertexes();
+  h.normals = nn;
+  h.indexes = uint32_t(varray.size());
+  h.shared = shared ? 1 : 0;
+  const Box box = mesh.GetBox();
+  for (int k = 0; k < 3; k++)
+  {
+    h.box[k] = box[0][k];
+    h.box[3 + k] = box[1][k];
+  }
+
+  // Quantized vertices and octahedral normals
+  const int size = bits <= 16 ? 2 : 4;
+  const double scale = double((1u << bits) - 1);
+  std::vector<char> geometry(size_t(h.vertices) * 3 * size + size_t(nn) * 4);
+#pragma omp parallel for
+  for (int i = 0; i < int(h.vertices); i++)
+  {
+    const Vector p = mesh.Vertex(vinverse[i]);
+    for (int k = 0; k < 3; k++)
+    {
+      const double d = h.box[3 + k] - h.box[k];
+      const uint32_t q = d > 0.0 ? uint32_t(floor(Math::Clamp((p[k] - h.box[k]) / d) * scale + 0.5)) : 0;
+      if (size == 2)
+      {
+        const uint16_t s = uint16_t(q);
+        memcpy(geometry.data() + (size_t(i) * 3 + k) * 2, &s, 2);
+      }
+      else
+      {
+        memcpy(geometry.data() + (size_t(i) * 3 + k) * 4, &q, 4);
+      }
+    }
+  }
+  // Shared normals are stored for every vertex, missing normals are padded with null vectors
+  char* normals = geometry.data() + size_t(h.vertices) * 3 * size;
+  const int stored = int(mesh.normals.size());
+#pragma omp parallel for
+  for (int i = 0; i < nn; i++)
+  {
+    int16_t e[2];
+    Octahedral(ninverse[i] < stored ? mesh.Normal(ninverse[i]) : Vector::Null, e);
+    memcpy(normals + size_t(i) * 4, e, 4);
+  }
+
+  // Index blocks
+  const int streams = shared ? 1 : 2;
+  const int blocks = (int(h.indexes) + MeshCodecBlock - 1) / MeshCodecBlock;
+  std::vector<std::vector<char>> stream(size_t(blocks) * streams);
+#pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < blocks * streams; b++)
+  {
+    const std::vector<int>& indexes = (b < blocks) ? varray : narray;
+    const std::vector<int>& order = (b < blocks) ? vorder : norder;
+    const int begin = (b % blocks) * MeshCodecBlock;
+    const int end = std::min(begin + MeshCodecBlock, int(h.indexes));
+    std::vector<char>& out = stream[b];
+    out.reserve(size_t(end - begin) * 2);
+    int previous = 0;
+    for (int i = begin; i < end; i++)
+    {
+      const int index = order[indexes[i]];
+      const int d = index - previous;
+      previous = index;
+      uint32_t z = (uint32_t(d) << 1) ^ uint32_t(d >> 31);
+      while (z >= 0x80)
+      {
+        out.push_back(char(z | 0x80));
+        z >>= 7;
+      }
+      out.push_back(char(z));
+    }
+  }
+
+  // Header, geometry, offsets of the blocks and blocks
+  std::vector<uint64_t> offset(stream.size() + 1, 0);
+  for (int b = 0; b < int(stream.size()); b++)
+    offset[b + 1] = offset[b] + stream[b].size();
+
+  data.resize(sizeof(h) + geometry.size() + offset.size() * sizeof(uint64_t) + offset.back());
+  char* p = data.data();
+  memcpy(p, &h, sizeof(h));
+  p += sizeof(h);
+  memcpy(p, geometry.data(), geometry.size());
+  p += geometry.size();
+  memcpy(p, offset.data(), offset.size() * sizeof(uint64_t));
+  p += offset.size() * sizeof(uint64_t);
+#pragma omp parallel for
+  for (int b = 0; b < int(stream.size()); b++)
+  {
+    if (!stream[b].empty())
+      memcpy(p + offset[b], stream[b].data(), stream[b].size());
+  }
+
+  raw = size_t(h.vertices) * sizeof(Vector) + size_t(nn) * sizeof(Vector) + varray.size() * streams * sizeof(int);
+  compressed = data.size();
+}
+
+/*!
+\brief Decompress a mesh.
+
+Vertices, normals and blocks of indexes are decoded in parallel.
+\param data,n Data and size of the data.
+\param mesh Returned mesh.
+\return Success, false if the data is invalid.
+*/
+bool MeshCodec::Decode(const char* data, size_t n, Mesh& mesh)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  MeshCodecHeader h;
+  if (n < sizeof(h))
+    return false;
+  memcpy(&h, data, sizeof(h));
+  if (memcmp(h.magic, MeshCodecMagic, 8) != 0 || h.version != 1 || h.bits < 1 || h.bits > 31 || h.indexes % 3 != 0 || h.indexes > (1u << 31) - 1)
+    return false;
+  if (h.vertices > (1u << 31) - 1 || h.normals > (1u << 31) - 1)
+    return false;
+  // Shared normal indexes are vertex indexes
+  if (h.shared && h.normals < h.vertices)
+    return false;
+
+  const int size = h.bits <= 16 ? 2 : 4;
+  const int streams = h.shared ? 1 : 2;
+  const int blocks = (int(h.indexes) + MeshCodecBlock - 1) / MeshCodecBlock;
+  const size_t geometry = size_t(h.vertices) * 3 * size + size_t(h.normals) * 4;
+  const size_t table = (size_t(blocks) * streams + 1) * sizeof(uint64_t);
+  if (n < sizeof(h) + geometry + table)
+    return false;
+
+  const char* p = data + sizeof(h);
+  const char* normals = p + size_t(h.vertices) * 3 * size;
+  std::vector<uint64_t> offset(size_t(blocks) * streams + 1);
+  memcpy(offset.data(), p + geometry, table);
+  const char* indexes = p + geometry + table;
+  const size_t length = n - sizeof(h) - geometry - table;
+  for (int b = 0; b < blocks * streams; b++)
+  {
+    if (offset[b] > offset[b + 1] || offset[b + 1] > length)
+      return false;
+  }
+
+  std::vector<Vector> vertex(h.vertices);
+  std::vector<Vector> normal(h.normals);
+  std::vector<int> varray(h.indexes);
+  std::vector<int> narray;
+  if (!h.shared)
+    narray.resize(h.indexes);
+
+  const double scale = 1.0 / double((1u << h.bits) - 1);
+  const Vector a(h.box[0], h.box[1], h.box[2]);
+  const Vector d = Vector(h.box[3], h.box[4], h.box[5]) - a;
+#pragma omp parallel for
+  for (int i = 0; i < int(h.vertices); i++)
+  {
+    uint32_t q[3];
+    for (int k = 0; k < 3; k++)
+    {
+      if (size == 2)
+      {
+        uint16_t s;
+        memcpy(&s, p + (size_t(i) * 3 + k) * 2, 2);
+        q[k] = s;
+      }
+      else
+      {
+        memcpy(&q[k], p + (size_t(i) * 3 + k) * 4, 4);
+      }
+    }
+    vertex[i] = a + Vector(q[0] * scale * d[0], q[1] * scale * d[1], q[2] * scale * d[2]);
+  }
+#pragma omp parallel for
+  for (int i = 0; i < int(h.normals); i++)
+  {
+    int16_t e[2];
+    memcpy(e, normals + size_t(i) * 4, 4);
+    normal[i] = Octahedral(e);
+  }
+
+  int invalid = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:invalid)
+  for (int b = 0; b < blocks * streams; b++)
+  {
+    std::vector<int>& out = (b < blocks) ? varray : narray;
+    const int range = (b < blocks) ? int(h.vertices) : int(h.normals);
+    const int begin = (b % blocks) * MeshCodecBlock;
+    const int end = std::min(begin + MeshCodecBlock, int(h.indexes));
+    const unsigned char* q = (const unsigned char*)indexes + offset[b];
+    const unsigned char* e = (const unsigned char*)indexes + offset[b + 1];
+    int previous = 0;
+    for (int i = begin; i < end; i++)
+    {
+      uint32_t z = 0;
+      int shift = 0;
+      while (q < e && (*q & 0x80) && shift < 28)
+      {
+        z |= uint32_t(*q++ & 0x7F) << shift;
+        shift += 7;
+      }
+      if (q == e)
+      {
+        invalid++;
+        break;
+      }
+      z |= uint32_t(*q++) << shift;
+      previous += int(z >> 1) ^ -int(z & 1);
+      if (previous < 0 || previous >= range)
+      {
+        invalid++;
+        break;
+      }
+      out[i] = previous;
+    }
+  }
+  if (invalid != 0)
+    return false;
+
+  mesh = h.shared ? Mesh(std::move(vertex), std::move(normal), std::move(varray)) : Mesh(std::move(vertex), std::move(normal), std::move(varray), std::move(narray));
+
+  raw = size_t(h.vertices) * sizeof(Vector) + size_t(h.normals) * sizeof(Vector) + size_t(h.indexes) * streams * sizeof(int);
+  compressed = n;
+  time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return true;
+}
+
+/*!
+\brief Compress a mesh and save it to a file.
+\param url File name.
+\param mesh The mesh.
+\return Success.
+*/
+bool MeshCodec::Save(const std::string& url, const Mesh& mesh)
+{
+  std::vector<char> data;
+  Encode(mesh, data);
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+  out.write(data.data(), data.size());
+  return bool(out);
+}
+
+/*!
+\brief Load a compressed mesh from a file, the file is memory mapped.
+\param url File name.
+\param mesh Returned mesh.
+\return Success.
+*/
+bool MeshCodec::Load(const std::string& url, Mesh& mesh)
+{
+  MappedFile file(url);
+  return file.IsOpen() && Decode(file.Data(), file.Size(), mesh);
+}
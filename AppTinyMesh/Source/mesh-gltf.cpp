@@ -0,0 +1,884 @@
+#include "mesh-gltf.h"
+#include "mapped-file.h"
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+//! Magic number of binary glTF files.
+static const uint32_t GltfMagic = 0x46546C67;
+
+//! Type of the JSON chunk.
+static const uint32_t GltfJsonChunk = 0x4E4F534A;
+
+//! Type of the binary chunk.
+static const uint32_t GltfBinaryChunk = 0x004E4942;
+
+/*!
+\brief A JSON value, the elements of arrays and the values of objects are stored in the same array.
+*/
+struct GltfJson
+{
+  enum Type { Null, Boolean, Number, String, Array, Object };
+  Type type = Null;                //!< Type.
+  double number = 0.0;             //!< Number or boolean.
+  std::string string;              //!< String.
+  std::vector<GltfJson> values;    //!< Elements of arrays and values of objects.
+  std::vector<std::string> keys;   //!< Keys of objects.
+
+  /*!
+  \brief Return the value of a key, null if the value is not an object or if the key is missing.
+  \param key Key.
+  */
+  const GltfJson* Find(const char* key) const
+  {
+    for (int i = 0; i < int(keys.size()); i++)
+    {
+      if (keys[i] == key)
+        return &values[i];
+    }
+    return nullptr;
+  }
+
+  /*!
+  \brief Return the integer value of a key.
+  \param key Key.
+  \param d Default value, returned if the key is missing or if its value is not a number.
+  */
+  long long Integer(const char* key, long long d) const
+  {
+    const GltfJson* v = Find(key);
+    return (v != nullptr && v->type == Number) ? (long long)(v->number) : d;
+  }
+
+  /*!
+  \brief Return the element of an array, null if out of range.
+  \param i Index.
+  */
+  const GltfJson* At(long long i) const
+  {
+    return (type == Array && i >= 0 && i < (long long)(values.size())) ? &values[size_t(i)] : nullptr;
+  }
+};
+
+/*!
+\brief Skip white spaces.
+\param p,e Current position and end of the text.
+*/
+static inline void GltfSpace(const char*& p, const char* e)
+{
+  while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    p++;
+}
+
+/*!
+\brief Parse a JSON string, the current position is on the opening quote.
+\param p,e Current position and end of the text.
+\param s Returned string, escape sequences are decoded to UTF-8.
+*/
+static bool GltfString(const char*& p, const char* e, std::string& s)
+{
+  p++;
+  while (p < e && *p != '"')
+  {
+    if (*p != '\\')
+    {
+      s.push_back(*p++);
+      continue;
+    }
+    if (++p == e)
+      return false;
+    const char c = *p++;
+    switch (c)
+    {
+    case 'b': s.push_back('\b'); break;
+    case 'f': s.push_back('\f'); break;
+    case 'n': s.push_back('\n'); break;
+    case 'r': s.push_back('\r'); break;
+    case 't': s.push_back('\t'); break;
+    case 'u':
+    {
+      unsigned int u = 0;
+      if (e - p < 4 || std::from_chars(p, p + 4, u, 16).ptr != p + 4)
+        return false;
+      p += 4;
+      if (u < 0x80)
+      {
+        s.push_back(char(u));
+      }
+      else if (u < 0x800)
+      {
+        s.push_back(char(0xC0 | (u >> 6)));
+        s.push_back(char(0x80 | (u & 0x3F)));
+      }
+      else
+      {
+        s.push_back(char(0xE0 | (u >> 12)));
+        s.push_back(char(0x80 | ((u >> 6) & 0x3F)));
+        s.push_back(char(0x80 | (u & 0x3F)));
+      }
+      break;
+    }
+    default: s.push_back(c); break;
+    }
+  }
+  if (p == e)
+    return false;
+  p++;
+  return true;
+}
+
+/*!
+\brief Parse a JSON value.
+\param p,e Current position and end of the text.
+\param v Returned value.
+\param depth Nesting depth, limited to reject malicious files.
+*/
+static bool GltfParse(const char*& p, const char* e, GltfJson& v, int depth = 0)
+{
+  GltfSpace(p, e);
+  if (p == e || depth > 64)
+    return false;
+
+  if (*p == '{' || *p == '[')
+  {
+    const bool object = *p == '{';
+    const char close = object ? '}' : ']';
+    v.type = object ? GltfJson::Object : GltfJson::Array;
+    p++;
+    GltfSpace(p, e);
+    if (p < e && *p == close)
+    {
+      p++;
+      return true;
+    }
+    while (true)
+    {
+      if (object)
+      {
+        GltfSpace(p, e);
+        v.keys.emplace_back();
+        if (p == e || *p != '"' || !GltfString(p, e, v.keys.back()))
+          return false;
+        GltfSpace(p, e);
+        if (p == e || *p++ != ':')
+          return false;
+      }
+      v.values.emplace_back();
+      if (!GltfParse(p, e, v.values.back(), depth + 1))
+        return false;
+      GltfSpace(p, e);
+      if (p == e)
+        return false;
+      if (*p == close)
+      {
+        p++;
+        return true;
+      }
+      if (*p++ != ',')
+        return false;
+    }
+  }
+  if (*p == '"')
+  {
+    v.type = GltfJson::String;
+    return GltfString(p, e, v.string);
+  }
+  if (e - p >= 4 && memcmp(p, "true", 4) == 0)
+  {
+    v.type = GltfJson::Boolean;
+    v.number = 1.0;
+    p += 4;
+    return true;
+  }
+  if (e - p >= 5 && memcmp(p, "false", 5) == 0)
+  {
+    v.type = GltfJson::Boolean;
+    p += 5;
+    return true;
+  }
+  if (e - p >= 4 && memcmp(p, "null", 4) == 0)
+  {
+    p += 4;
+    return true;
+  }
+  v.type = GltfJson::Number;
+  const std::from_chars_result r = std::from_chars(p, e, v.number);
+  if (r.ec != std::errc())
+    return false;
+  p = r.ptr;
+  return true;
+}
+
+/*!
+\brief Elements of an accessor in the binary chunk.
+*/
+struct GltfView
+{
+  const char* data = nullptr; //!< First element.
+  int count = 0;              //!< Number of elements.
+  int components = 0;         //!< Number of components of the elements.
+  int type = 0;               //!< Component type.
+  int size = 0;               //!< Size of the components.
+  int stride = 0;             //!< Distance between elements.
+  bool normalized = false;    //!< Normalized integers.
+
+  /*!
+  \brief Return a component of an element, normalized integers are converted to reals.
+  \param i,k Element and component.
+  */
+  double operator()(int i, int k) const
+  {
+    const char* q = data + size_t(i) * stride + size_t(k) * size;
+    switch (type)
+    {
+    case 5120: { int8_t x; memcpy(&x, q, 1); return normalized ? Math::Max(x / 127.0, -1.0) : x; }
+    case 5121: { uint8_t x; memcpy(&x, q, 1); return normalized ? x / 255.0 : x; }
+    case 5122: { int16_t x; memcpy(&x, q, 2); return normalized ? Math::Max(x / 32767.0, -1.0) : x; }
+    case 5123: { uint16_t x; memcpy(&x, q, 2); return normalized ? x / 65535.0 : x; }
+    case 5125: { uint32_t x; memcpy(&x, q, 4); return x; }
+    default: { float x; memcpy(&x, q, 4); return x; }
+    }
+  }
+};
+
+/*!
+\brief Locate the elements of an accessor in the binary chunk and check that they fit in their buffer view.
+
+Sparse accessors and external buffers are not supported.
+\param root Document.
+\param index Index of the accessor.
+\param bin,length Binary chunk.
+\param view Returned elements.
+*/
+static bool GltfAccessor(const GltfJson& root, long long index, const char* bin, uint64_t length, GltfView& view)
+{
+  const GltfJson* accessors = root.Find("accessors");
+  const GltfJson* a = accessors != nullptr ? accessors->At(index) : nullptr;
+  if (a == nullptr || a->Find("sparse") != nullptr)
+    return false;
+
+  const GltfJson* type = a->Find("type");
+  if (type == nullptr || type->type != GltfJson::String)
+    return false;
+  const std::string& t = type->string;
+  view.components = (t == "SCALAR") ? 1 : (t == "VEC2") ? 2 : (t == "VEC3") ? 3 : (t == "VEC4") ? 4 : 0;
+  view.type = int(a->Integer("componentType", 0));
+  view.size = (view.type == 5120 || view.type == 5121) ? 1 : (view.type == 5122 || view.type == 5123) ? 2 : (view.type == 5125 || view.type == 5126) ? 4 : 0;
+  const GltfJson* normalized = a->Find("normalized");
+  view.normalized = normalized != nullptr && normalized->number != 0.0;
+  const long long count = a->Integer("count", -1);
+  if (view.components == 0 || view.size == 0 || count < 1 || count > (1ll << 31) - 1)
+    return false;
+  view.count = int(count);
+
+  const GltfJson* views = root.Find("bufferViews");
+  const GltfJson* v = views != nullptr ? views->At(a->Integer("bufferView", -1)) : nullptr;
+  if (v == nullptr || v->Integer("buffer", -1) != 0)
+    return false;
+  const long long begin = v->Integer("byteOffset", 0);
+  const long long size = v->Integer("byteLength", -1);
+  const long long offset = a->Integer("byteOffset", 0);
+  const long long element = (long long)(view.components) * view.size;
+  const long long stride = v->Integer("byteStride", element);
+  if (begin < 0 || size < 0 || offset < 0 || stride < element || uint64_t(begin + size) > length)
+    return false;
+  if (offset + stride * (count - 1) + element > size)
+    return false;
+
+  view.stride = int(stride);
+  view.data = bin + begin + offset;
+  return true;
+}
+
+/*!
+\brief Append a string to a JSON document, with escaped characters.
+\param json Document.
+\param s String.
+*/
+static void GltfQuote(std::string& json, const std::string& s)
+{
+  json += '"';
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+    {
+      json += '\\';
+      json += c;
+    }
+    else if ((unsigned char)(c) < 0x20)
+    {
+      char u[8];
+      snprintf(u, sizeof(u), "\\u%04x", (unsigned int)(c));
+      json += u;
+    }
+    else
+    {
+      json += c;
+    }
+  }
+  json += '"';
+}
+
+/*!
+\brief Append a number to a JSON document.
+\param json Document.
+\param x Number, floats are written with their shortest exact representation.
+*/
+template<typename T>
+static void GltfNumber(std::string& json, T x)
+{
+  char buffer[32];
+  json.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), x).ptr);
+}
+
+/*!
+\brief Hash of a triple of vertex, normal and color indexes.
+*/
+struct GltfCornerHash
+{
+  size_t operator()(const std::array<int, 3>& k) const
+  {
+    return size_t(k[0]) * 0x9E3779B1u ^ size_t(k[1]) * 0x85EBCA77u ^ size_t(k[2]) * 0xC2B2AE3Du;
+  }
+};
+
+/*!
+\class MeshGltf mesh-gltf.h
+\brief Import and export of meshes in the binary glTF 2.0 format.
+
+A scene is a list of meshes, possibly with colors, that are saved in a single .glb file. Every mesh is a triangle primitive with
+float positions, normals and optionally colors, and unsigned short or unsigned int indexes depending on the number of vertices.
+All arrays are stored in a single binary chunk, which is filled in parallel without formatting the elements.
+
+glTF vertices share their index for all their attributes: corners with different vertex, normal or color indexes are split when saving.
+
+\code
+MeshGltf scene;
+scene.Add(terrain, "terrain");
+scene.Add(tree, "tree");
+scene.Save("scene.glb");
+
+std::vector<MeshColor> meshes;
+MeshGltf::Load("scene.glb", meshes);
+\endcode
+*/
+
+/*!
+\brief Add a mesh to the scene, the mesh is referenced and should not be destroyed before the scene is saved.
+\param mesh The mesh.
+\param name Name of the mesh.
+*/
+void MeshGltf::Add(const Mesh& mesh, const std::string& name)
+{
+  entries.push_back({ &mesh, nullptr, nullptr, name });
+}
+
+/*!
+\brief Add a colored mesh to the scene, the mesh is referenced and should not be destroyed before the scene is saved.
+\param mesh The mesh.
+\param name Name of the mesh.
+*/
+void MeshGltf::Add(const MeshColor& mesh, const std::string& name)
+{
+  entries.push_back({ &mesh, &mesh.colors, &mesh.ColorIndexes(), name });
+}
+
+/*!
+\brief Remove all meshes from the scene.
+*/
+void MeshGltf::Clear()
+{
+  entries.clear();
+}
+
+/*!
+\brief Save the scene in a .glb file, with one node per mesh.
+
+Meshes without triangles are skipped.
+\param url File name.
+\return Success.
+*/
+bool MeshGltf::Save(const std::string& url) const
+{
+  // Vertices of the file as triples of vertex, normal and color indexes, and triangles
+  const int n = int(entries.size());
+  std::vector<std::vector<std::array<int, 3>>> corners(n);
+  std::vector<std::vector<int>> triangles(n);
+  std::vector<int> count(n);
+  for (int m = 0; m < n; m++)
+  {
+    const Mesh& mesh = *entries[m].mesh;
+    const std::vector<int>* ca = entries[m].carray;
+    if (mesh.varray.empty())
+    {
+      count[m] = 0;
+      continue;
+    }
+    const std::vector<int>& na = mesh.NormalIndexes();
+    if (na == mesh.varray && (ca == nullptr || *ca == mesh.varray))
+    {
+      count[m] = int(mesh.vertices.size());
+      continue;
+    }
+
+    std::vector<std::array<int, 3>>& c = corners[m];
+    std::vector<int>& t = triangles[m];
+    t.resize(mesh.varray.size());
+    std::unordered_map<std::array<int, 3>, int, GltfCornerHash> split;
+    split.reserve(mesh.vertices.size());
+    for (int i = 0; i < int(mesh.varray.size()); i++)
+    {
+      const std::array<int, 3> k = { mesh.varray[i], na[i], ca != nullptr ? (*ca)[i] : 0 };
+      std::unordered_map<std::array<int, 3>, int, GltfCornerHash>::const_iterator it = split.find(k);
+      if (it != split.end())
+      {
+        t[i] = it->second;
+      }
+      else
+      {
+        t[i] = int(c.size());
+        split[k] = t[i];
+        c.push_back(k);
+      }
+    }
+    count[m] = int(c.size());
+  }
+
+  // Layout of the binary chunk, with positions, normals, colors and indexes of every mesh aligned on four bytes
+  struct Layout
+  {
+    uint64_t offset[4]; //!< Offsets of positions, normals, colors and indexes.
+    uint64_t size[4];   //!< Sizes.
+  };
+  std::vector<Layout> layout(n);
+  uint64_t length = 0;
+  for (int m = 0; m < n; m++)
+  {
+    const uint64_t nv = count[m];
+    const uint64_t ni = nv > 0 ? entries[m].mesh->varray.size() : 0;
+    layout[m].size[0] = nv * 12;
+    layout[m].size[1] = nv * 12;
+    layout[m].size[2] = entries[m].colors != nullptr ? nv * 16 : 0;
+    layout[m].size[3] = ni * (nv < 65535 ? 2 : 4);
+    for (int k = 0; k < 4; k++)
+    {
+      layout[m].offset[k] = length;
+      length += (layout[m].size[k] + 3) / 4 * 4;
+    }
+  }
+
+  std::vector<char> bin(length, 0);
+  std::vector<std::array<float, 6>> box(n);
+  for (int m = 0; m < n; m++)
+  {
+    const Mesh& mesh = *entries[m].mesh;
+    const std::vector<Color>* colors = entries[m].colors;
+    const std::vector<std::array<int, 3>>& c = corners[m];
+    const bool split = !c.empty();
+    const int nv = count[m];
+    char* position = bin.data() + layout[m].offset[0];
+    char* normal = bin.data() + layout[m].offset[1];
+    char* color = bin.data() + layout[m].offset[2];
+#pragma omp parallel for
+    for (int i = 0; i < nv; i++)
+    {
+      const Vector& p = mesh.vertices[split ? c[i][0] : i];
+      const Vector& q = mesh.normals[split ? c[i][1] : i];
+      const float x[6] = { float(p[0]), float(p[1]), float(p[2]), float(q[0]), float(q[1]), float(q[2]) };
+      memcpy(position + size_t(i) * 12, x, 12);
+      memcpy(normal + size_t(i) * 12, x + 3, 12);
+      if (colors != nullptr)
+      {
+        const Color& k = (*colors)[split ? c[i][2] : i];
+        const float y[4] = { float(k[0]), float(k[1]), float(k[2]), float(k[3]) };
+        memcpy(color + size_t(i) * 16, y, 16);
+      }
+    }
+
+    const std::vector<int>& t = split ? triangles[m] : mesh.varray;
+    char* index = bin.data() + layout[m].offset[3];
+    const int ni = int(t.size());
+    const bool wide = nv >= 65535;
+#pragma omp parallel for
+    for (int i = 0; i < ni; i++)
+    {
+      if (wide)
+      {
+        const uint32_t x = t[i];
+        memcpy(index + size_t(i) * 4, &x, 4);
+      }
+      else
+      {
+        const uint16_t x = uint16_t(t[i]);
+        memcpy(index + size_t(i) * 2, &x, 2);
+      }
+    }
+
+    // Bounds of the positions, which are required by the format
+    std::array<float, 6>& b = box[m];
+    b = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < nv; i++)
+    {
+      float x[3];
+      memcpy(x, position + size_t(i) * 12, 12);
+      for (int k = 0; k < 3; k++)
+      {
+        b[k] = (i == 0 || x[k] < b[k]) ? x[k] : b[k];
+        b[3 + k] = (i == 0 || x[k] > b[3 + k]) ? x[k] : b[3 + k];
+      }
+    }
+  }
+
+  // Document
+  std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"TinyMesh\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+  std::string nodes, meshes, accessors, views;
+  int mesh = 0;
+  int accessor = 0;
+  for (int m = 0; m < n; m++)
+  {
+    if (count[m] == 0)
+      continue;
+
+    const char* types[4] = { "VEC3", "VEC3", "VEC4", "SCALAR" };
+    const int components[4] = { 5126, 5126, 5126, count[m] < 65535 ? 5123 : 5125 };
+    const uint64_t elements[4] = { uint64_t(count[m]), uint64_t(count[m]), uint64_t(count[m]), entries[m].mesh->varray.size() };
+    int first[4] = { -1, -1, -1, -1 };
+    for (int k = 0; k < 4; k++)
+    {
+      if (layout[m].size[k] == 0)
+        continue;
+      first[k] = accessor++;
+      views += views.empty() ? "{" : ",{";
+      views += "\"buffer\":0,\"byteOffset\":";
+      GltfNumber(views, layout[m].offset[k]);
+      views += ",\"byteLength\":";
+      GltfNumber(views, layout[m].size[k]);
+      views += k == 3 ? ",\"target\":34963}" : ",\"target\":34962}";
+
+      accessors += accessors.empty() ? "{" : ",{";
+      accessors += "\"bufferView\":";
+      GltfNumber(accessors, first[k]);
+      accessors += ",\"componentType\":";
+      GltfNumber(accessors, components[k]);
+      accessors += ",\"count\":";
+      GltfNumber(accessors, elements[k]);
+      accessors += ",\"type\":\"";
+      accessors += types[k];
+      accessors += '"';
+      if (k == 0)
+      {
+        for (int j = 0; j < 2; j++)
+        {
+          accessors += j == 0 ? ",\"min\":[" : "],\"max\":[";
+          for (int i = 0; i < 3; i++)
+          {
+            if (i > 0)
+              accessors += ',';
+            GltfNumber(accessors, box[m][j * 3 + i]);
+          }
+        }
+        accessors += ']';
+      }
+      accessors += '}';
+    }
+
+    if (mesh > 0)
+    {
+      json += ',';
+      nodes += ',';
+      meshes += ',';
+    }
+    GltfNumber(json, mesh);
+    nodes += "{\"mesh\":";
+    GltfNumber(nodes, mesh);
+    nodes += ",\"name\":";
+    GltfQuote(nodes, entries[m].name);
+    nodes += '}';
+    meshes += "{\"name\":";
+    GltfQuote(meshes, entries[m].name);
+    meshes += ",\"primitives\":[{\"attributes\":{\"POSITION\":";
+    GltfNumber(meshes, first[0]);
+    meshes += ",\"NORMAL\":";
+    GltfNumber(meshes, first[1]);
+    if (first[2] != -1)
+    {
+      meshes += ",\"COLOR_0\":";
+      GltfNumber(meshes, first[2]);
+    }
+    meshes += "},\"indices\":";
+    GltfNumber(meshes, first[3]);
+    meshes += ",\"mode\":4}]}";
+    mesh++;
+  }
+  json += "]}],\"nodes\":[" + nodes + "],\"meshes\":[" + meshes + "],\"accessors\":[" + accessors + "],\"bufferViews\":[" + views + "]";
+  if (length > 0)
+  {
+    json += ",\"buffers\":[{\"byteLength\":";
+    GltfNumber(json, length);
+    json += "}]";
+  }
+  json += '}';
+  while (json.size() % 4 != 0)
+    json += ' ';
+
+  // Header and chunks
+  const uint64_t total = 12 + 8 + json.size() + (length > 0 ? 8 + length : 0);
+  if (total > UINT32_MAX)
+    return false;
+  const uint32_t header[5] = { GltfMagic, 2, uint32_t(total), uint32_t(json.size()), GltfJsonChunk };
+  const uint32_t chunk[2] = { uint32_t(length), GltfBinaryChunk };
+
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+  out.write((const char*)header, sizeof(header));
+  out.write(json.data(), json.size());
+  if (length > 0)
+  {
+    out.write((const char*)chunk, sizeof(chunk));
+    out.write(bin.data(), bin.size());
+  }
+  return bool(out);
+}
+
+/*!
+\brief Import the meshes of a .glb file.
+
+The triangle primitives of every mesh of the file are merged into a colored mesh, other primitives are skipped.
+Node transformations are not applied. Smooth normals are computed for meshes without normals, and vertices are white if the mesh does not have colors.
+Arrays are read in parallel directly from the memory mapped file.
+\param url File name.
+\param meshes Returned meshes.
+\param names Returned names of the meshes, if not null.
+\return Success.
+*/
+bool MeshGltf::Load(const std::string& url, std::vector<MeshColor>& meshes, std::vector<std::string>* names)
+{
+  meshes.clear();
+  if (names != nullptr)
+    names->clear();
+
+  MappedFile file(url);
+  if (!file.IsOpen() || file.Size() < 20)
+    return false;
+
+  // Header and chunks, the binary chunk is optional
+  const char* data = file.Data();
+  uint32_t header[5];
+  memcpy(header, data, sizeof(header));
+  if (header[0] != GltfMagic || header[1] != 2 || header[2] > file.Size() || header[4] != GltfJsonChunk || uint64_t(header[3]) + 20 > header[2])
+    return false;
+  const char* text = data + 20;
+  const uint64_t end = 20 + uint64_t(header[3]);
+  const char* bin = nullptr;
+  uint64_t length = 0;
+  if (end + 8 <= header[2])
+  {
+    uint32_t chunk[2];
+    memcpy(chunk, data + end, sizeof(chunk));
+    if (chunk[1] == GltfBinaryChunk && end + 8 + chunk[0] <= header[2])
+    {
+      bin = data + end + 8;
+      length = chunk[0];
+    }
+  }
+
+  GltfJson root;
+  const char* p = text;
+  if (!GltfParse(p, text + header[3], root) || root.type != GltfJson::Object)
+    return false;
+
+  // Only the binary chunk is supported as a buffer
+  const GltfJson* buffers = root.Find("buffers");
+  if (buffers != nullptr && buffers->At(0) != nullptr)
+  {
+    const GltfJson* b = buffers->At(0);
+    if (b->Find("uri") != nullptr || bin == nullptr || uint64_t(b->Integer("byteLength", 0)) > length)
+      return false;
+  }
+
+  const GltfJson* list = root.Find("meshes");
+  if (list == nullptr || list->type != GltfJson::Array)
+    return true;
+
+  meshes.resize(list->values.size());
+  for (int m = 0; m < int(list->values.size()); m++)
+  {
+    const GltfJson& entry = list->values[m];
+    MeshColor& mesh = meshes[m];
+    if (names != nullptr)
+    {
+      const GltfJson* name = entry.Find("name");
+      names->push_back(name != nullptr ? name->string : std::string());
+    }
+
+    bool normals = true;
+    bool colors = false;
+    const GltfJson* primitives = entry.Find("primitives");
+    const int np = (primitives != nullptr && primitives->type == GltfJson::Array) ? int(primitives->values.size()) : 0;
+    for (int k = 0; k < np; k++)
+    {
+      const GltfJson& primitive = primitives->values[k];
+      const GltfJson* attributes = primitive.Find("attributes");
+      if (primitive.Integer("mode", 4) != 4 || attributes == nullptr)
+        continue;
+
+      GltfView position, normal, color, index;
+      if (!GltfAccessor(root, attributes->Integer("POSITION", -1), bin, length, position) || position.components != 3 || position.type != 5126)
+        return false;
+      const bool hasNormal = attributes->Find("NORMAL") != nullptr;
+      const bool hasColor = attributes->Find("COLOR_0") != nullptr;
+      const bool hasIndex = primitive.Find("indices") != nullptr;
+      if (hasNormal && (!GltfAccessor(root, attributes->Integer("NORMAL", -1), bin, length, normal) || normal.components != 3 || normal.count != position.count))
+        return false;
+      if (hasColor && (!GltfAccessor(root, attributes->Integer("COLOR_0", -1), bin, length, color) || color.components < 3 || color.count != position.count))
+        return false;
+      if (hasIndex && (!GltfAccessor(root, primitive.Integer("indices", -1), bin, length, index) || index.components != 1 || index.type == 5126))
+        return false;
+
+      // Missing colors of the previous primitives
+      if (hasColor && !colors)
+      {
+        mesh.colors.resize(mesh.vertices.size(), Color(1.0, 1.0, 1.0));
+        colors = true;
+      }
+      normals = normals && hasNormal;
+
+      const int base = int(mesh.vertices.size());
+      const int nv = position.count;
+      if (base + (long long)(nv) > (1ll << 31) - 1)
+        return false;
+      mesh.vertices.resize(base + nv);
+      mesh.normals.resize(base + nv, Vector::Z);
+      if (colors)
+        mesh.colors.resize(base + nv, Color(1.0, 1.0, 1.0));
+#pragma omp parallel for
+      for (int i = 0; i < nv; i++)
+      {
+        mesh.vertices[base + i] = Vector(position(i, 0), position(i, 1), position(i, 2));
+        if (hasNormal)
+          mesh.normals[base + i] = Vector(normal(i, 0), normal(i, 1), normal(i, 2));
+        if (hasColor)
+          mesh.colors[base + i] = Color(color(i, 0), color(i, 1), color(i, 2), color.components == 4 ? color(i, 3) : 1.0);
+      }
+
+      const int ni = hasIndex ? index.count : nv;
+      if (ni % 3 != 0)
+        return false;
+      const int offset = int(mesh.varray.size());
+      mesh.varray.resize(offset + size_t(ni));
+      int invalid = 0;
+#pragma omp parallel for reduction(+:invalid)
+      for (int i = 0; i < ni; i++)
+      {
+        const double j = hasIndex ? index(i, 0) : double(i);
+        if (j < 0.0 || j >= nv)
+          invalid++;
+        else
+          mesh.varray[offset + i] = base + int(j);
+      }
+      if (invalid != 0)
+        return false;
+    }
+
+    if (!normals)
+    {
+      mesh.normals.clear();
+      mesh.SmoothNormals();
+    }
+    if (!colors)
+      mesh.colors.resize(mesh.vertices.size(), Color(1.0, 1.0, 1.0));
+    mesh.narray.clear();
+  }
+  return true;
+}
+
+/*!
+\brief Import a mesh from a .glb file, all the meshes of the file are merged.
+\sa MeshGltf::Load
+\param url File name.
+\return Success.
+*/
+bool Mesh::LoadGlb(const std::string& url)
+{
+  Invalidate();
+  MeshColor mesh;
+  const bool loaded = mesh.LoadGlb(url);
+  vertices = std::move(mesh.vertices);
+  normals = std::move(mesh.normals);
+  varray = std::move(mesh.varray);
+  narray = std::move(mesh.narray);
+  return loaded;
+}
+
+/*!
+\brief Save the mesh in a .glb file.
+\sa MeshGltf::Save
+\param url File name.
+\return Success.
+*/
+bool Mesh::SaveGlb(const std::string& url) const
+{
+  MeshGltf scene;
+  scene.Add(*this);
+  return scene.Save(url);
+}
+
+/*!
+\brief Import a colored mesh from a .glb file, all the meshes of the file are merged.
+\sa MeshGltf::Load
+\param url File name.
+\return Success.
+*/
+bool MeshColor::LoadGlb(const std::string& url)
+{
+  Invalidate();
+  std::vector<MeshColor> meshes;
+  const bool loaded = MeshGltf::Load(url, meshes);
+  if (!loaded)
+    meshes.clear();
+  if (meshes.size() == 1)
+  {
+    vertices.swap(meshes[0].vertices);
+    normals.swap(meshes[0].normals);
+    colors.swap(meshes[0].colors);
+    varray.swap(meshes[0].varray);
+    narray.swap(meshes[0].narray);
+    carray.swap(meshes[0].carray);
+    return loaded;
+  }
+
+  vertices.clear();
+  normals.clear();
+  colors.clear();
+  varray.clear();
+  for (const MeshColor& mesh : meshes)
+  {
+    const int base = int(vertices.size());
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    normals.insert(normals.end(), mesh.normals.begin(), mesh.normals.end());
+    colors.insert(colors.end(), mesh.colors.begin(), mesh.colors.end());
+    for (int i : mesh.varray)
+      varray.push_back(base + i);
+  }
+  narray.clear();
+  carray.clear();
+  return loaded;
+}
+
+/*!
+\brief Save the colored mesh in a .glb file.
+\sa MeshGltf::Save
+\param url File name.
+\return Success.
+*/
+bool MeshColor::SaveGlb(const std::string& url) const
+{
+  MeshGltf scene;
+  scene.Add(*this);
+  return scene.Save(url);
+}
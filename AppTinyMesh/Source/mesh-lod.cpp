@@ -0,0 +1,259 @@
+#include "mesh-lod.h"
+#include "mesh-codec.h"
+#include "mesh-cache.h"
+#include "mapped-file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+/*!
+\brief Header of level of detail files, followed by the table of the levels and their compressed meshes.
+*/
+struct MeshLodHeader
+{
+  char magic[8];       //!< Magic string.
+  uint32_t version;    //!< Version.
+  uint32_t levels;     //!< Number of levels.
+  uint32_t vertices;   //!< Number of vertices of the mesh.
+  uint32_t triangles;  //!< Number of triangles of the mesh.
+  uint64_t checksum;   //!< Checksum of the mesh.
+};
+
+/*!
+\brief Entry of a level in the table.
+*/
+struct MeshLodEntry
+{
+  double error;        //!< Geometric error.
+  uint64_t size;       //!< Size of the compressed mesh.
+};
+
+//! Magic string of level of detail files.
+static const char MeshLodMagic[8] = { 'T', 'M', 'E', 'S', 'H', 'L', 'O', 'D' };
+
+/*!
+\class MeshLod mesh-lod.h
+\brief A chain of simplified versions of a mesh, with their geometric error.
+
+Levels are simplified from the original mesh with the quadric error metric, so that their errors do not accumulate,
+and are generated in parallel. The chain stops at the first level whose error exceeds MeshLod::Tolerance times the diagonal of the mesh. They can be saved alongside the mesh and loaded instead of being generated again,
+files store the size and a checksum of the mesh, so that levels are not loaded for another mesh.
+
+The levels of a mesh are generated with Mesh::GenerateLod() and used by the viewer, which draws the coarsest level
+whose projected error is below a tolerance in pixels.
+\code
+Mesh mesh(Sphere(Vector(0.0), 1.0), 500);
+mesh.GenerateLod(6, 0.25);
+mesh.SaveLod("sphere.lod");
+\endcode
+*/
+
+/*!
+\brief Generate the levels of detail of a mesh.
+\param mesh The mesh.
+\param n Maximum number of levels.
+\param ratio Ratio between the number of triangles of two successive levels.
+*/
+MeshLod::MeshLod(const Mesh& mesh, int n, double ratio) :vertexes(mesh.Vertexes()), triangles(mesh.Triangles()), checksum(Checksum(mesh))
+{
+  // Targets, the coarsest levels keep a few triangles
+  std::vector<int> targets;
+  double target = mesh.Triangles();
+  for (int i = 0; i < n; i++)
+  {
+    target *= ratio;
+    if (target < 16.0)
+      break;
+    targets.push_back(int(target));
+  }
+  const int nl = int(targets.size());
+  levels.resize(nl);
+  errors.resize(nl, 0.0);
+
+  // The topology is built once and shared by the copies of the mesh
+  mesh.Topology();
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int i = 0; i < nl; i++)
+  {
+    levels[i] = mesh;
+    levels[i].Simplify(targets[i], -1.0, &errors[i]);
+  }
+
+  // Levels that could not be simplified further are removed, as well as levels that are too far from the mesh,
+  // since the simplification reaches its target whatever the error
+  const double limit = Tolerance * Norm(mesh.GetBox().Diagonal());
+  int k = 0;
+  for (int i = 0; i < nl; i++)
+  {
+    if (errors[i] > limit)
+      break;
+    if (k > 0 && levels[i].Triangles() >= levels[k - 1].Triangles())
+      continue;
+    errors[k] = (k > 0) ? std::max(errors[i], errors[k - 1]) : errors[i];
+    if (k != i)
+      levels[k] = std::move(levels[i]);
+    k++;
+  }
+  levels.resize(k);
+  errors.resize(k);
+}
+
+/*!
+\brief Select the coarsest level whose error is below a tolerance.
+\param tolerance Tolerance, in the units of the mesh.
+\return The level, or -1 if the original mesh should be used.
+*/
+int MeshLod::Select(double tolerance) const
+{
+  return Select(errors, tolerance);
+}
+
+/*!
+\brief Select the coarsest level whose error is below a tolerance, given the errors of the levels.
+
+This is used by the viewer, which keeps the errors of the levels it has uploaded.
+\param errors Errors of the levels, increasing.
+\param tolerance Tolerance, in the units of the mesh.
+\return The level, or -1 if the original mesh should be used.
+*/
+int MeshLod::Select(const std::vector<double>& errors, double tolerance)
+{
+  int i = -1;
+  while (i + 1 < int(errors.size()) && errors[i + 1] <= tolerance)
+    i++;
+  return i;
+}
+
+/*!
+\brief Compute the checksum of the vertices and the vertex indexes of a mesh.
+\param mesh The mesh.
+*/
+uint64_t MeshLod::Checksum(const Mesh& mesh)
+{
+  const uint64_t v = MeshCache::Checksum((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vector));
+  const uint64_t i = MeshCache::Checksum((const char*)mesh.varray.data(), mesh.varray.size() * sizeof(int));
+  return v ^ (i * 0x9E3779B185EBCA87ULL);
+}
+
+/*!
+\brief Check if the levels were generated from a mesh, with its number of vertices and triangles and its checksum.
+\param mesh The mesh.
+*/
+bool MeshLod::Source(const Mesh& mesh) const
+{
+  return mesh.Vertexes() == vertexes && mesh.Triangles() == triangles && Checksum(mesh) == checksum;
+}
+
+/*!
+\brief Save the levels to a file, meshes are compressed.
+\param url File name.
+\return Success.
+*/
+bool MeshLod::Save(const std::string& url) const
+{
+  MeshCodec codec;
+  std::vector<std::vector<char>> data(levels.size());
+  std::vector<MeshLodEntry> table(levels.size());
+  for (int i = 0; i < int(levels.size()); i++)
+  {
+    codec.Encode(levels[i], data[i]);
+    table[i].error = errors[i];
+    table[i].size = data[i].size();
+  }
+
+  MeshLodHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, MeshLodMagic, 8);
+  h.version = Version;
+  h.levels = uint32_t(levels.size());
+  h.vertices = uint32_t(vertexes);
+  h.triangles = uint32_t(triangles);
+  h.checksum = checksum;
+
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+  out.write((const char*)&h, sizeof(h));
+  out.write((const char*)table.data(), table.size() * sizeof(MeshLodEntry));
+  for (const std::vector<char>& d : data)
+    out.write(d.data(), d.size());
+  return bool(out);
+}
+
+/*!
+\brief Load the levels from a file, the file is memory mapped.
+\param url File name.
+\return Success, levels are left empty otherwise.
+*/
+bool MeshLod::Load(const std::string& url)
+{
+  levels.clear();
+  errors.clear();
+
+  MappedFile file(url);
+  if (!file.IsOpen() || file.Size() < sizeof(MeshLodHeader))
+    return false;
+  MeshLodHeader h;
+  memcpy(&h, file.Data(), sizeof(h));
+  if (memcmp(h.magic, MeshLodMagic, 8) != 0 || h.version != Version)
+    return false;
+  if (file.Size() < sizeof(MeshLodHeader) + size_t(h.levels) * sizeof(MeshLodEntry))
+    return false;
+
+  std::vector<MeshLodEntry> table(h.levels);
+  memcpy(table.data(), file.Data() + sizeof(MeshLodHeader), table.size() * sizeof(MeshLodEntry));
+  size_t offset = sizeof(MeshLodHeader) + table.size() * sizeof(MeshLodEntry);
+  MeshCodec codec;
+  levels.resize(h.levels);
+  errors.resize(h.levels);
+  vertexes = int(h.vertices);
+  triangles = int(h.triangles);
+  checksum = h.checksum;
+  for (int i = 0; i < int(h.levels); i++)
+  {
+    if (table[i].size > file.Size() - offset || !codec.Decode(file.Data() + offset, size_t(table[i].size), levels[i]))
+    {
+      levels.clear();
+      errors.clear();
+      return false;
+    }
+    errors[i] = table[i].error;
+    offset += size_t(table[i].size);
+  }
+  return true;
+}
+
+/*!
+\brief Generate the levels of detail of the mesh, which are released when the mesh is edited.
+\param n Maximum number of levels.
+\param ratio Ratio between the number of triangles of two successive levels.
+*/
+void Mesh::GenerateLod(int n, double ratio)
+{
+  lod = std::make_shared<const MeshLod>(*this, n, ratio);
+}
+
+/*!
+\brief Save the levels of detail of the mesh.
+\param url File name.
+\return Success, false if the levels were not generated.
+*/
+bool Mesh::SaveLod(const std::string& url) const
+{
+  return lod && lod->Save(url);
+}
+
+/*!
+\brief Load levels of detail saved for the mesh.
+\param url File name.
+\return Success, false if the levels were saved for another mesh.
+*/
+bool Mesh::LoadLod(const std::string& url)
+{
+  std::shared_ptr<MeshLod> levels = std::make_shared<MeshLod>();
+  if (!levels->Load(url) || !levels->Source(*this))
+    return false;
+  lod = levels;
+  return true;
+}
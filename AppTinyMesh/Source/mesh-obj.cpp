@@ -0,0 +1,432 @@
+#include "mesh.h"
+#include "mapped-file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+//! Marker for face corners without a normal index.
+static const int ObjMissing = INT_MIN;
+
+/*!
+\brief Parsed content of a chunk of an .obj file.
+
+Negative indexes refer to the vertices or normals defined before the face. They are stored relative to
+the beginning of the chunk, and their position is recorded so that the offset of the chunk is added when chunks are merged.
+*/
+struct ObjChunk
+{
+  std::vector<Vector> vertices; //!< Vertices.
+  std::vector<Vector> normals;  //!< Normals.
+  std::vector<int> varray;      //!< Vertex indexes.
+  std::vector<int> narray;      //!< Normal indexes.
+  std::vector<int> vrelative;   //!< Positions of the vertex indexes relative to the chunk.
+  std::vector<int> nrelative;   //!< Positions of the normal indexes relative to the chunk.
+  std::vector<int> v, n, r;     //!< Vertex and normal indexes of the corners of the face being parsed, and relative flags.
+  ObjReport report;             //!< Statistics.
+};
+
+//! Skip blank characters, not including the end of line.
+static inline const char* ObjBlank(const char* p, const char* e)
+{
+  while (p < e && (*p == ' ' || *p == '\t' || *p == '\r'))
+    p++;
+  return p;
+}
+
+//! Parse a real number.
+static inline bool ObjReal(const char*& p, const char* e, double& x)
+{
+  p = ObjBlank(p, e);
+  if (p < e && *p == '+')
+    p++;
+  const std::from_chars_result r = std::from_chars(p, e, x);
+  if (r.ec != std::errc())
+    return false;
+  p = r.ptr;
+  return true;
+}
+
+//! Parse an integer.
+static inline bool ObjInteger(const char*& p, const char* e, int& x)
+{
+  if (p < e && *p == '+')
+    p++;
+  const std::from_chars_result r = std::from_chars(p, e, x);
+  if (r.ec != std::errc())
+    return false;
+  p = r.ptr;
+  return true;
+}
+
+//! Parse three real numbers, further values on the line are ignored.
+static inline bool ObjVector(const char* p, const char* e, Vector& v)
+{
+  double x, y, z;
+  if (!ObjReal(p, e, x) || !ObjReal(p, e, y) || !ObjReal(p, e, z))
+    return false;
+  v = Vector(x, y, z);
+  return true;
+}
+
+/*!
+\brief Parse a face and triangulate it as a fan.
+
+Corners may be written as <code>v</code>, <code>v/t</code>, <code>v//n</code> or <code>v/t/n</code>, with positive or negative indexes.
+A trailing comment starting with <code>#</code> ends the list of corners.
+\param p,e Begin and end of the line, after the keyword.
+\param chunk Parsed chunk.
+*/
+static bool ObjFace(const char* p, const char* e, ObjChunk& chunk)
+{
+  chunk.v.clear();
+  chunk.n.clear();
+  chunk.r.clear();
+  while (true)
+  {
+    p = ObjBlank(p, e);
+    if (p == e || *p == '#')
+      break;
+
+    int v, t, n = 0;
+    if (!ObjInteger(p, e, v) || v == 0)
+      return false;
+    if (p < e && *p == '/')
+    {
+      p++;
+      if (p < e && *p != '/' && !ObjInteger(p, e, t))
+        return false;
+      if (p < e && *p == '/')
+      {
+        p++;
+        if (!ObjInteger(p, e, n) || n == 0)
+          return false;
+      }
+    }
+    if (p < e && *p != ' ' && *p != '\t' && *p != '\r' && *p != '#')
+      return false;
+
+    // Indexes are zero based, negative ones are relative to the current number of elements
+    chunk.v.push_back(v > 0 ? v - 1 : int(chunk.vertices.size()) + v);
+    chunk.n.push_back(n > 0 ? n - 1 : (n < 0 ? int(chunk.normals.size()) + n : ObjMissing));
+    chunk.r.push_back((v < 0 ? 1 : 0) | (n < 0 ? 2 : 0));
+  }
+
+  const int k = int(chunk.v.size());
+  if (k < 3)
+    return false;
+  if (k > 3)
+    chunk.report.polygons++;
+
+  // Fan triangulation
+  for (int i = 1; i < k - 1; i++)
+  {
+    const int c[3] = { 0, i, i + 1 };
+    for (int j = 0; j < 3; j++)
+    {
+      if (chunk.r[c[j]] & 1)
+        chunk.vrelative.push_back(int(chunk.varray.size()));
+      if (chunk.r[c[j]] & 2)
+        chunk.nrelative.push_back(int(chunk.narray.size()));
+      chunk.varray.push_back(chunk.v[c[j]]);
+      chunk.narray.push_back(chunk.n[c[j]]);
+    }
+  }
+  return true;
+}
+
+/*!
+\brief Parse the lines of a chunk of an .obj file.
+\param p,e Begin and end of the chunk, the chunk starts at the beginning of a line.
+\param chunk Parsed chunk.
+*/
+static void ObjParse(const char* p, const char* e, ObjChunk& chunk)
+{
+  while (p < e)
+  {
+    const char* end = (const char*)memchr(p, '\n', e - p);
+    if (end == nullptr)
+      end = e;
+
+    p = ObjBlank(p, end);
+    if (p < end && *p != '#')
+    {
+      // Keyword
+      const char* k = p;
+      while (p < end && *p != ' ' && *p != '\t' && *p != '\r')
+        p++;
+
+      bool ok = true;
+      Vector q;
+      if (p - k == 1 && k[0] == 'v')
+      {
+        ok = ObjVector(p, end, q);
+        if (ok)
+          chunk.vertices.push_back(q);
+      }
+      else if (p - k == 2 && k[0] == 'v' && k[1] == 'n')
+      {
+        ok = ObjVector(p, end, q);
+        if (ok)
+          chunk.normals.push_back(q);
+      }
+      else if (p - k == 1 && k[0] == 'f')
+      {
+        ok = ObjFace(p, end, chunk);
+      }
+      else
+      {
+        chunk.report.ignored++;
+      }
+      if (!ok)
+        chunk.report.lines++;
+    }
+    p = end + 1;
+  }
+}
+
+/*!
+\brief Import a mesh from an .obj file.
+
+The file is memory mapped and split into chunks at line boundaries that are parsed in parallel.
+Chunks are then concatenated at offsets given by the prefix sums of their sizes. Numbers are parsed
+with std::from_chars, which does not depend on the locale.
+
+Faces may use any of the <code>v</code>, <code>v/t</code>, <code>v//n</code> and <code>v/t/n</code> forms with positive or negative indexes,
+polygons are triangulated as fans. Triangles referring to missing vertices are dropped. Corners without a valid normal
+are given smooth normals computed from the triangles.
+Only <code>v</code>, <code>vn</code> and <code>f</code> lines are processed, other lines are counted in the report.
+\param url File name.
+\param report Optional statistics on the lines that were skipped or modified.
+\return Success, false if the file could not be opened.
+*/
+bool Mesh::LoadObj(const std::string& url, ObjReport* report)
+{
+  Invalidate();
+  vertices.clear();
+  normals.clear();
+  varray.clear();
+  narray.clear();
+  if (report != nullptr)
+    *report = ObjReport();
+
+  MappedFile file(url);
+  if (!file.IsOpen())
+    return false;
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+
+  // Chunks of a few megabytes, starting at the beginning of a line
+  const size_t length = size_t(1) << 22;
+  std::vector<const char*> start;
+  start.push_back(data);
+  while (size_t(start.back() - data) + length < size)
+  {
+    const char* p = start.back() + length;
+    const char* end = (const char*)memchr(p, '\n', data + size - p);
+    if (end == nullptr)
+      break;
+    start.push_back(end + 1);
+  }
+  start.push_back(data + size);
+
+  const int n = int(start.size()) - 1;
+  std::vector<ObjChunk> chunks(n);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < n; i++)
+  {
+    ObjParse(start[i], start[i + 1], chunks[i]);
+  }
+
+  // Prefix sums
+  std::vector<int> nv(n + 1, 0), nn(n + 1, 0), ni(n + 1, 0);
+  for (int i = 0; i < n; i++)
+  {
+    nv[i + 1] = nv[i] + int(chunks[i].vertices.size());
+    nn[i + 1] = nn[i] + int(chunks[i].normals.size());
+    ni[i + 1] = ni[i] + int(chunks[i].varray.size());
+  }
+
+  vertices.resize(nv[n]);
+  normals.resize(nn[n]);
+  varray.resize(ni[n]);
+  narray.resize(ni[n]);
+
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    const ObjChunk& chunk = chunks[i];
+    std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + nv[i]);
+    std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + nn[i]);
+    std::copy(chunk.varray.begin(), chunk.varray.end(), varray.begin() + ni[i]);
+    std::copy(chunk.narray.begin(), chunk.narray.end(), narray.begin() + ni[i]);
+    for (int j : chunk.vrelative)
+      varray[ni[i] + j] += nv[i];
+    for (int j : chunk.nrelative)
+      narray[ni[i] + j] += nn[i];
+  }
+
+  ObjReport r;
+  for (int i = 0; i < n; i++)
+  {
+    r.lines += chunks[i].report.lines;
+    r.polygons += chunks[i].report.polygons;
+    r.ignored += chunks[i].report.ignored;
+  }
+  chunks.clear();
+
+  // Drop triangles with invalid vertex indexes
+  const int nvertices = int(vertices.size());
+  const int nnormals = int(normals.size());
+  int k = 0;
+  for (int i = 0; i < int(varray.size()); i += 3)
+  {
+    bool valid = true;
+    for (int j = 0; j < 3; j++)
+      valid = valid && varray[i + j] >= 0 && varray[i + j] < nvertices;
+    if (!valid)
+    {
+      r.triangles++;
+      continue;
+    }
+    for (int j = 0; j < 3; j++)
+    {
+      varray[k + j] = varray[i + j];
+      narray[k + j] = (narray[i + j] >= 0 && narray[i + j] < nnormals) ? narray[i + j] : ObjMissing;
+      if (narray[k + j] == ObjMissing)
+        r.normals++;
+    }
+    k += 3;
+  }
+  varray.resize(k);
+  narray.resize(k);
+
+  // Smooth normals, appended after the normals of the file
+  if (r.normals > 0)
+  {
+    normals.resize(nnormals + nvertices, Vector::Null);
+    for (int i = 0; i < k; i += 3)
+    {
+      const Vector tn = Triangle(vertices[varray[i]], vertices[varray[i + 1]], vertices[varray[i + 2]]).AreaNormal();
+      for (int j = 0; j < 3; j++)
+        normals[nnormals + varray[i + j]] += tn;
+    }
+#pragma omp parallel for
+    for (int i = nnormals; i < nnormals + nvertices; i++)
+    {
+      if (normals[i] != Vector::Null)
+        Normalize(normals[i]);
+    }
+    for (int i = 0; i < k; i++)
+    {
+      if (narray[i] == ObjMissing)
+        narray[i] = nnormals + varray[i];
+    }
+  }
+
+  ShareIndexes();
+  if (report != nullptr)
+    *report = r;
+  return true;
+}
+
+/*!
+\brief Format a range of lines of an .obj file.
+\param kind Kind of lines: vertices, normals or triangles.
+\param a,b Range of elements.
+\param buffer Returned text.
+*/
+void Mesh::FormatObj(int kind, int a, int b, std::vector<char>& buffer) const
+{
+  // Longest line, with 24 characters for a real and 11 for an integer
+  buffer.resize(size_t(b - a) * 96);
+  char* p = buffer.data();
+  char* e = p + buffer.size();
+  for (int i = a; i < b; i++)
+  {
+    if (kind == 2)
+    {
+      *p++ = 'f';
+      for (int j = 0; j < 3; j++)
+      {
+        *p++ = ' ';
+        p = std::to_chars(p, e, varray[i * 3 + j] + 1).ptr;
+        *p++ = '/';
+        *p++ = '/';
+        p = std::to_chars(p, e, NormalIndexes()[i * 3 + j] + 1).ptr;
+      }
+    }
+    else
+    {
+      const Vector& v = (kind == 0) ? vertices[i] : normals[i];
+      *p++ = 'v';
+      if (kind == 1)
+        *p++ = 'n';
+      for (int j = 0; j < 3; j++)
+      {
+        *p++ = ' ';
+        p = std::to_chars(p, e, v[j]).ptr;
+      }
+    }
+    *p++ = '\n';
+  }
+  buffer.resize(p - buffer.data());
+}
+
+/*!
+\brief Save the mesh in .obj format, with vertices and normals.
+
+Lines are formatted in blocks in parallel with std::to_chars, which produces the shortest representation
+that reads back to the same value, so that saving and loading the mesh is exact. Blocks are written in order,
+one write per block.
+\param url File name.
+\param name %Mesh name in the .obj file.
+\return Success.
+*/
+bool Mesh::SaveObj(const std::string& url, const std::string& name) const
+{
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+  out << "g " << name << '\n';
+
+  // Blocks of lines
+  const int size = 1 << 16;
+  std::vector<int> kind, start;
+  const int count[3] = { int(vertices.size()), int(normals.size()), Triangles() };
+  for (int k = 0; k < 3; k++)
+  {
+    for (int i = 0; i < count[k]; i += size)
+    {
+      kind.push_back(k);
+      start.push_back(i);
+    }
+  }
+
+  // Rounds of blocks, so that only part of the file is held in memory
+  const int n = int(kind.size());
+  const int round = 64;
+  std::vector<std::vector<char>> buffers(round);
+  for (int r = 0; r < n; r += round)
+  {
+    const int m = (n - r < round) ? n - r : round;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < m; i++)
+    {
+      const int k = kind[r + i];
+      const int a = start[r + i];
+      FormatObj(k, a, (a + size < count[k]) ? a + size : count[k], buffers[i]);
+    }
+
+    for (int i = 0; i < m; i++)
+    {
+      out.write(buffers[i].data(), buffers[i].size());
+    }
+  }
+  return bool(out);
+}
@@ -0,0 +1,461 @@
+#include "mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\brief Scores of the vertices for the vertex cache optimization, from their position in the cache and their number of remaining triangles.
+*/
+class ForsythScore
+{
+public:
+  static const int Cache = 32;   //!< Size of the modeled cache.
+  static const int Valence = 64; //!< Number of tabulated valences.
+protected:
+  float cache[Cache];            //!< Score of the positions in the cache.
+  float valence[Valence];        //!< Score of the number of remaining triangles.
+public:
+  //! Tabulate the scores.
+  ForsythScore()
+  {
+    for (int i = 0; i < Cache; i++)
+      cache[i] = (i < 3) ? 0.75f : float(std::pow(1.0 - double(i - 3) / double(Cache - 3), 1.5));
+    for (int i = 0; i < Valence; i++)
+      valence[i] = (i == 0) ? 0.0f : float(2.0 / std::sqrt(double(i)));
+  }
+
+  /*!
+  \brief Compute the score of a vertex.
+  \param position Position in the cache, -1 if not in the cache.
+  \param remaining Number of triangles that were not added yet.
+  */
+  float operator()(int position, int remaining) const
+  {
+    if (remaining == 0)
+      return -1.0f;
+    const float v = (remaining < Valence) ? valence[remaining] : float(2.0 / std::sqrt(double(remaining)));
+    return (position < 0) ? v : v + cache[position];
+  }
+};
+
+/*!
+\brief Renumber values in the order of their first use by a set of indexes, unused values are moved to the end.
+\param indexes Indexes, which are updated.
+\param values Values, which are reordered.
+\return The new index of every value.
+*/
+static std::vector<int> Renumber(std::vector<int>& indexes, std::vector<Vector>& values)
+{
+  std::vector<int> remap(values.size(), -1);
+  std::vector<Vector> v;
+  v.reserve(values.size());
+  for (int& i : indexes)
+  {
+    if (remap[i] == -1)
+    {
+      remap[i] = int(v.size());
+      v.push_back(values[i]);
+    }
+    i = remap[i];
+  }
+  for (int i = 0; i < int(values.size()); i++)
+  {
+    if (remap[i] == -1)
+    {
+      remap[i] = int(v.size());
+      v.push_back(values[i]);
+    }
+  }
+  values.swap(v);
+  return remap;
+}
+
+/*!
+\brief Move values to their new index.
+\param remap New index of every value.
+\param values Values.
+*/
+static void Permute(const std::vector<int>& remap, std::vector<Vector>& values)
+{
+  std::vector<Vector> v(values.size());
+#pragma omp parallel for
+  for (int i = 0; i < int(remap.size()); i++)
+    v[remap[i]] = values[i];
+  values.swap(v);
+}
+
+/*!
+\brief Compute the average cache miss ratio, the number of vertices transformed per triangle with a first-in first-out cache.
+
+The ratio is between 0.5 for an ideal order on large meshes and 3 without any reuse.
+\param size Size of the cache.
+*/
+double Mesh::Acmr(int size) const
+{
+  const int nt = Triangles();
+  if (nt == 0)
+    return 0.0;
+  std::vector<int> stamp(vertices.size(), -size - 1);
+  int misses = 0;
+  for (int c = 0; c < int(varray.size()); c++)
+  {
+    // A vertex is in the cache if less than size vertices were loaded since it was
+    if (misses - stamp[varray[c]] > size)
+    {
+      stamp[varray[c]] = misses;
+      misses++;
+    }
+  }
+  return double(misses) / double(nt);
+}
+
+/*!
+\brief Reorder the triangles for the post-transform vertex cache, and the vertices in the order they are used.
+
+Triangles are ordered with the linear speed algorithm of Tom Forsyth, which greedily adds the triangle whose vertices
+are the most recent in a modeled cache and have the fewest remaining triangles. Vertices are then renumbered in the
+order of their first use, so that vertex fetches are sequential, and unused vertices are moved to the end.
+Attributes of derived classes follow with Mesh::Remap().
+
+If overdraw is optimized, triangles are split in clusters where the cache is cold, so that reordering them costs
+few cache misses, and clusters facing away from the center of the mesh are drawn first as they are more likely to occlude
+the others, following Sander et al.
+\param overdraw Sort clusters of triangles to reduce overdraw.
+\param report Returned cache miss ratios, if not null.
+*/
+void Mesh::OptimizeCache(bool overdraw, CacheReport* report)
+{
+  const int nv = Vertexes();
+  const int nt = Triangles();
+  if (report)
+    report->before = Acmr();
+
+  std::vector<int> start, corner;
+  VertexCorners(start, corner);
+
+  // Scores of the vertices and the triangles
+  const ForsythScore score;
+  std::vector<int> remaining(nv), position(nv, -1);
+  std::vector<float> vscore(nv), tscore(nt, 0.0f);
+#pragma omp parallel for
+  for (int v = 0; v < nv; v++)
+  {
+    remaining[v] = start[v + 1] - start[v];
+    vscore[v] = score(-1, remaining[v]);
+  }
+#pragma omp parallel for
+  for (int t = 0; t < nt; t++)
+    tscore[t] = vscore[varray[3 * t]] + vscore[varray[3 * t + 1]] + vscore[varray[3 * t + 2]];
+
+  // Triangles are added greedily, restarting from the next triangle in input order when no cached vertex has triangles left
+  std::vector<unsigned char> added(nt, 0), cut(nt, 0);
+  std::vector<int> order;
+  order.reserve(nt);
+  std::vector<int> cache, next;
+  int best = -1;
+  int cursor = 0;
+  for (int k = 0; k < nt; k++)
+  {
+    if (best < 0)
+    {
+      while (added[cursor])
+        cursor++;
+      best = cursor;
+      cut[k] = 1;
+    }
+    const int t = best;
+    added[t] = 1;
+    order.push_back(t);
+
+    // Vertices of the triangle move to the front of the cache
+    next.clear();
+    for (int j = 0; j < 3; j++)
+    {
+      const int v = varray[3 * t + j];
+      remaining[v]--;
+      if (std::find(next.begin(), next.end(), v) == next.end())
+        next.push_back(v);
+    }
+    const int fresh = int(next.size());
+    for (int v : cache)
+    {
+      if (std::find(next.begin(), next.begin() + fresh, v) == next.begin() + fresh)
+        next.push_back(v);
+    }
+
+    // Scores of the cached and evicted vertices
+    for (int i = 0; i < int(next.size()); i++)
+    {
+      const int v = next[i];
+      position[v] = (i < ForsythScore::Cache) ? i : -1;
+      const float s = score(position[v], remaining[v]);
+      const float delta = s - vscore[v];
+      vscore[v] = s;
+      for (int j = start[v]; j < start[v + 1]; j++)
+      {
+        if (!added[corner[j] / 3])
+          tscore[corner[j] / 3] += delta;
+      }
+    }
+    if (int(next.size()) > ForsythScore::Cache)
+      next.resize(ForsythScore::Cache);
+    cache.swap(next);
+
+    // Best triangle among those of the cached vertices
+    best = -1;
+    float high = -1.0f;
+    for (int v : cache)
+    {
+      for (int j = start[v]; j < start[v + 1]; j++)
+      {
+        const int f = corner[j] / 3;
+        if (!added[f] && tscore[f] > high)
+        {
+          high = tscore[f];
+          best = f;
+        }
+      }
+    }
+  }
+
+  // Clusters sorted by decreasing occlusion potential
+  if (overdraw)
+  {
+    // Cache misses before every triangle in the new order
+    std::vector<int> misses(nt + 1, 0);
+    std::vector<int> stamp(nv, -17);
+    for (int k = 0; k < nt; k++)
+    {
+      misses[k + 1] = misses[k];
+      for (int j = 0; j < 3; j++)
+      {
+        const int v = varray[3 * order[k] + j];
+        if (misses[k + 1] - stamp[v] > 16)
+          stamp[v] = misses[k + 1]++;
+      }
+    }
+
+    // Clusters at the restarts, split further where the ratio of cache misses of the first part is low enough
+    const double threshold = 1.05;
+    std::vector<int> clusters;
+    for (int k = 0; k < nt; )
+    {
+      int end = k + 1;
+      while (end < nt && !cut[end])
+        end++;
+      const double acmr = double(misses[end] - misses[k]) / double(end - k);
+      clusters.push_back(k);
+      for (int i = k + 1, first = k; i < end; i++)
+      {
+        if (i - first >= 256 && double(misses[i] - misses[first]) / double(i - first) <= threshold * acmr)
+        {
+          clusters.push_back(i);
+          first = i;
+        }
+      }
+      k = end;
+    }
+    const int nk = int(clusters.size());
+    clusters.push_back(nt);
+
+    // Centroid and normal of the clusters
+    Vector center(0.0);
+    double area = 0.0;
+    std::vector<Vector> centroid(nk), normal(nk);
+    std::vector<double> weight(nk);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < nk; i++)
+    {
+      Vector c(0.0), n(0.0);
+      double w = 0.0;
+      for (int k = clusters[i]; k < clusters[i + 1]; k++)
+      {
+        const int t = order[k];
+        const Vector a = vertices[varray[3 * t]];
+        const Vector b = vertices[varray[3 * t + 1]];
+        const Vector d = vertices[varray[3 * t + 2]];
+        const Vector an = (b - a) / (d - a);
+        const double l = Norm(an);
+        c += l * (a + b + d) / 3.0;
+        n += an;
+        w += l;
+      }
+      centroid[i] = (w > 0.0) ? c / w : c;
+      normal[i] = n;
+      weight[i] = w;
+    }
+    for (int i = 0; i < nk; i++)
+    {
+      center += weight[i] * centroid[i];
+      area += weight[i];
+    }
+    if (area > 0.0)
+      center /= area;
+
+    std::vector<double> potential(nk);
+    std::vector<int> sorted(nk);
+    for (int i = 0; i < nk; i++)
+    {
+      const double l = Norm(normal[i]);
+      potential[i] = (l > 0.0) ? (centroid[i] - center) * normal[i] / l : 0.0;
+      sorted[i] = i;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [&potential](int a, int b) { return potential[a] > potential[b]; });
+
+    std::vector<int> reordered;
+    reordered.reserve(nt);
+    for (int i : sorted)
+      reordered.insert(reordered.end(), order.begin() + clusters[i], order.begin() + clusters[i + 1]);
+    order.swap(reordered);
+    if (report)
+      report->clusters = nk;
+  }
+
+  // Triangles in their new order
+  const bool shared = SharedIndexes();
+  std::vector<int> va(varray.size()), na(narray.size());
+#pragma omp parallel for
+  for (int k = 0; k < nt; k++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      va[3 * k + j] = varray[3 * order[k] + j];
+      if (!shared)
+        na[3 * k + j] = narray[3 * order[k] + j];
+    }
+  }
+
+  // Vertices, and normals unless they share the vertex indexes, in the order of their first use
+  const std::vector<int> remap = Renumber(va, vertices);
+  if (!shared)
+    Renumber(na, normals);
+  else if (normals.size() == remap.size())
+    Permute(remap, normals);
+
+  Remap(remap, nv, order);
+  varray.swap(va);
+  narray.swap(na);
+  Invalidate();
+  if (report)
+    report->after = Acmr();
+}
+
+/*!
+\brief Interleave the bits of three integers of 10 bits into a 30 bits Morton code.
+*/
+static inline unsigned int Morton(unsigned int x, unsigned int y, unsigned int z)
+{
+  auto spread = [](unsigned int a)
+  {
+    a = (a | (a << 16)) & 0x030000FF;
+    a = (a | (a << 8)) & 0x0300F00F;
+    a = (a | (a << 4)) & 0x030C30C3;
+    a = (a | (a << 2)) & 0x09249249;
+    return a;
+  };
+  return spread(x) | (spread(y) << 1) | (spread(z) << 2);
+}
+
+/*!
+\brief Sort points along the Morton curve of a box.
+
+Codes are sorted with a least significant digit radix sort, whose passes are parallel counting sorts on 10 bits digits.
+Points with the same code keep their relative order.
+\param points Points.
+\param box The box, usually the bounding box of the points.
+\return Indexes of the points in sorted order.
+*/
+std::vector<int> Mesh::MortonOrder(const std::vector<Vector>& points, const Box& box)
+{
+  const int n = int(points.size());
+  const Vector d = box.Diagonal();
+  const double sx = (d[0] > 0.0) ? 1024.0 / d[0] : 0.0;
+  const double sy = (d[1] > 0.0) ? 1024.0 / d[1] : 0.0;
+  const double sz = (d[2] > 0.0) ? 1024.0 / d[2] : 0.0;
+  auto quantize = [](double x)
+  {
+    return (x < 0.0) ? 0u : (x >= 1023.0) ? 1023u : (unsigned int)(x);
+  };
+
+  std::vector<unsigned int> code(n);
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+  {
+    const Vector p = points[i] - box[0];
+    code[i] = Morton(quantize(p[0] * sx), quantize(p[1] * sy), quantize(p[2] * sz));
+  }
+
+  std::vector<int> order(n), sorted(n), digit(n), start, item;
+#pragma omp parallel for
+  for (int i = 0; i < n; i++)
+    order[i] = i;
+  for (int shift = 0; shift < 30; shift += 10)
+  {
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      digit[i] = int((code[order[i]] >> shift) & 1023u);
+    Buckets(digit, 1024, start, item);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+      sorted[i] = order[item[i]];
+    order.swap(sorted);
+  }
+  return order;
+}
+
+/*!
+\brief Sort the vertices and the triangles along the Morton curve of the bounding box of the mesh.
+
+Vertices are sorted by their position and triangles by their centroid, so that neighbors in space are close in memory,
+which improves the locality of the passes over the mesh, such as the computation of normals or the construction of
+hierarchies for ray casting. Normals are moved with the vertices if they share the vertex indexes, otherwise
+they are renumbered in the order of their first use. Attributes of derived classes follow with Mesh::Remap().
+*/
+void Mesh::SortMorton()
+{
+  const int nv = Vertexes();
+  const int nt = Triangles();
+  const Box box = GetBox();
+
+  // Vertices
+  const std::vector<int> vertex = MortonOrder(vertices, box);
+  std::vector<int> remap(nv);
+#pragma omp parallel for
+  for (int i = 0; i < nv; i++)
+    remap[vertex[i]] = i;
+  const bool shared = SharedIndexes();
+  if (shared && normals.size() == vertices.size())
+    Permute(remap, normals);
+  Permute(remap, vertices);
+
+  // Triangles, sorted by their centroid with the new vertex indexes
+  std::vector<Vector> centroid(nt);
+#pragma omp parallel for
+  for (int t = 0; t < nt; t++)
+  {
+    varray[3 * t] = remap[varray[3 * t]];
+    varray[3 * t + 1] = remap[varray[3 * t + 1]];
+    varray[3 * t + 2] = remap[varray[3 * t + 2]];
+    centroid[t] = (vertices[varray[3 * t]] + vertices[varray[3 * t + 1]] + vertices[varray[3 * t + 2]]) / 3.0;
+  }
+  const std::vector<int> triangle = MortonOrder(centroid, box);
+
+  std::vector<int> va(varray.size()), na(narray.size());
+#pragma omp parallel for
+  for (int k = 0; k < nt; k++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      va[3 * k + j] = varray[3 * triangle[k] + j];
+      if (!shared)
+        na[3 * k + j] = narray[3 * triangle[k] + j];
+    }
+  }
+  if (!shared)
+    Renumber(na, normals);
+
+  Remap(remap, nv, triangle);
+  varray.swap(va);
+  narray.swap(na);
+  Invalidate();
+}
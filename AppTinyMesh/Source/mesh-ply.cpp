@@ -0,0 +1,617 @@
+#include "meshcolor.h"
+#include "mapped-file.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+/*!
+\brief Property of an element of a .ply file.
+*/
+struct PlyProperty
+{
+  std::string name;  //!< Name.
+  int type = -1;     //!< Type of the value, or of the items for lists.
+  int count = -1;    //!< Type of the number of items for lists, -1 for scalar properties.
+};
+
+/*!
+\brief Element of a .ply file.
+*/
+struct PlyElement
+{
+  std::string name;                     //!< Name.
+  long long size = 0;                   //!< Number of items.
+  std::vector<PlyProperty> properties;  //!< Properties.
+};
+
+//! Names and sizes of the .ply types, with their aliases.
+static const char* PlyNames[16] = { "char", "uchar", "short", "ushort", "int", "uint", "float", "double", "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64" };
+static const int PlySizes[8] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+
+//! Find the type from its name, return -1 if unknown.
+static int PlyType(const std::string& name)
+{
+  for (int i = 0; i < 16; i++)
+  {
+    if (name == PlyNames[i])
+      return i % 8;
+  }
+  return -1;
+}
+
+//! Read a binary value as a real number.
+static inline double PlyValue(const char* p, int type, bool swap)
+{
+  unsigned char b[8];
+  memcpy(b, p, PlySizes[type]);
+  if (swap)
+    std::reverse(b, b + PlySizes[type]);
+  switch (type)
+  {
+  case 0: { int8_t x; memcpy(&x, b, 1); return x; }
+  case 1: { uint8_t x; memcpy(&x, b, 1); return x; }
+  case 2: { int16_t x; memcpy(&x, b, 2); return x; }
+  case 3: { uint16_t x; memcpy(&x, b, 2); return x; }
+  case 4: { int32_t x; memcpy(&x, b, 4); return x; }
+  case 5: { uint32_t x; memcpy(&x, b, 4); return x; }
+  case 6: { float x; memcpy(&x, b, 4); return x; }
+  default: { double x; memcpy(&x, b, 8); return x; }
+  }
+}
+
+//! Scale factor that maps integer color channels to [0,1].
+static inline double PlyColorScale(int type)
+{
+  return (type == 1) ? 1.0 / 255.0 : (type == 3) ? 1.0 / 65535.0 : 1.0;
+}
+
+//! Check if the host is little endian.
+static inline bool PlyLittleEndian()
+{
+  const uint16_t x = 1;
+  unsigned char b;
+  memcpy(&b, &x, 1);
+  return b == 1;
+}
+
+/*!
+\brief Read an ASCII value.
+\param p Pointer, moved after the value.
+\param e End of the data.
+\param x Returned value.
+*/
+static inline bool PlyText(const char*& p, const char* e, double& x)
+{
+  while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    p++;
+  if (p < e && *p == '+')
+    p++;
+  const std::from_chars_result r = std::from_chars(p, e, x);
+  if (r.ec != std::errc())
+    return false;
+  p = r.ptr;
+  return true;
+}
+
+/*!
+\brief Read a .ply file.
+
+Vertex properties named x, y, z, nx, ny, nz and red, green, blue, alpha are read, other properties and elements are skipped.
+Faces are read from the vertex_indices or vertex_index list and triangulated as fans.
+\param url File name.
+\param v,n,c Returned vertices, normals and colors, normals and colors are empty if the file does not define them.
+\param t Returned triangles.
+*/
+static bool PlyRead(const std::string& url, std::vector<Vector>& v, std::vector<Vector>& n, std::vector<Color>& c, std::vector<int>& t)
+{
+  v.clear();
+  n.clear();
+  c.clear();
+  t.clear();
+
+  MappedFile file(url);
+  if (!file.IsOpen() || file.Size() < 4 || memcmp(file.Data(), "ply", 3) != 0)
+    return false;
+
+  const char* data = file.Data();
+  const char* end = data + file.Size();
+
+  // Header
+  const char* p = data;
+  int format = -1;
+  std::vector<PlyElement> elements;
+  while (true)
+  {
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    if (eol == nullptr)
+      return false;
+    std::istringstream line(std::string(p, eol));
+    p = eol + 1;
+
+    std::string keyword;
+    line >> keyword;
+    if (keyword == "format")
+    {
+      std::string f;
+      line >> f;
+      format = (f == "ascii") ? 0 : (f == "binary_little_endian") ? 1 : (f == "binary_big_endian") ? 2 : -1;
+    }
+    else if (keyword == "element")
+    {
+      PlyElement element;
+      line >> element.name >> element.size;
+      if (!line || element.size < 0)
+        return false;
+      elements.push_back(element);
+    }
+    else if (keyword == "property")
+    {
+      if (elements.empty())
+        return false;
+      PlyProperty property;
+      std::string type;
+      line >> type;
+      if (type == "list")
+      {
+        std::string count;
+        line >> count >> type;
+        property.count = PlyType(count);
+        if (property.count == -1 || property.count >= 6)
+          return false;
+      }
+      property.type = PlyType(type);
+      line >> property.name;
+      if (property.type == -1 || !line)
+        return false;
+      elements.back().properties.push_back(property);
+    }
+    else if (keyword == "end_header")
+    {
+      break;
+    }
+  }
+  if (format == -1)
+    return false;
+
+  const bool swap = (format == 2) == PlyLittleEndian();
+
+  for (const PlyElement& element : elements)
+  {
+    const bool vertex = (element.name == "vertex");
+    const bool face = (element.name == "face");
+    const int np = int(element.properties.size());
+
+    // Layout of the vertex properties: position, normal and color
+    static const char* fields[10] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue", "alpha" };
+    int slot[10], type[10], offset[10];
+    int stride = 0;
+    bool fixed = true;
+    for (int k = 0; k < 10; k++)
+    {
+      slot[k] = -1;
+      type[k] = offset[k] = 0;
+    }
+    for (int i = 0; i < np; i++)
+    {
+      const PlyProperty& property = element.properties[i];
+      for (int k = 0; k < 10; k++)
+      {
+        if (property.name == fields[k] || (k >= 6 && property.name == std::string("diffuse_") + fields[k]))
+        {
+          slot[k] = i;
+          type[k] = property.type;
+          offset[k] = stride;
+        }
+      }
+      if (property.count != -1)
+        fixed = false;
+      stride += PlySizes[property.type];
+    }
+    const bool position = slot[0] != -1 && slot[1] != -1 && slot[2] != -1;
+    const bool normal = slot[3] != -1 && slot[4] != -1 && slot[5] != -1;
+    const bool color = slot[6] != -1 && slot[7] != -1 && slot[8] != -1;
+
+    // Index list of the faces
+    int list = -1;
+    for (int i = 0; i < np && face; i++)
+    {
+      if (element.properties[i].count != -1 && (element.properties[i].name == "vertex_indices" || element.properties[i].name == "vertex_index"))
+        list = i;
+    }
+
+    if (vertex)
+    {
+      if (!position || (!fixed && format != 0))
+        return false;
+      v.resize(element.size);
+      if (normal)
+        n.resize(element.size);
+      if (color)
+        c.resize(element.size, Color(1.0));
+    }
+
+    if (format != 0 && vertex)
+    {
+      // Fixed size records read in parallel
+      if (end - p < element.size * stride)
+        return false;
+      const int size = int(element.size);
+      const double scale[4] = { PlyColorScale(type[6]), PlyColorScale(type[7]), PlyColorScale(type[8]), slot[9] != -1 ? PlyColorScale(type[9]) : 1.0 };
+#pragma omp parallel for
+      for (int i = 0; i < size; i++)
+      {
+        const char* r = p + (long long)(i) * stride;
+        v[i] = Vector(PlyValue(r + offset[0], type[0], swap), PlyValue(r + offset[1], type[1], swap), PlyValue(r + offset[2], type[2], swap));
+        if (normal)
+          n[i] = Vector(PlyValue(r + offset[3], type[3], swap), PlyValue(r + offset[4], type[4], swap), PlyValue(r + offset[5], type[5], swap));
+        if (color)
+        {
+          c[i] = Color(PlyValue(r + offset[6], type[6], swap) * scale[0], PlyValue(r + offset[7], type[7], swap) * scale[1], PlyValue(r + offset[8], type[8], swap) * scale[2],
+            slot[9] != -1 ? PlyValue(r + offset[9], type[9], swap) * scale[3] : 1.0);
+        }
+      }
+      p += element.size * stride;
+      continue;
+    }
+
+    if (format != 0 && face && np == 1 && list == 0)
+    {
+      // Triangle only faces have a fixed size and are read in parallel, checked beforehand
+      const PlyProperty& property = element.properties[0];
+      const int stride = PlySizes[property.count] + 3 * PlySizes[property.type];
+      const int size = int(element.size);
+      const bool fits = (end - p) >= element.size * stride;
+      int polygons = 0;
+#pragma omp parallel for reduction(+:polygons)
+      for (int i = 0; i < (fits ? size : 0); i++)
+      {
+        if (polygons == 0 && PlyValue(p + (long long)(i) * stride, property.count, swap) != 3.0)
+          polygons++;
+      }
+      if (fits && polygons == 0)
+      {
+        t.resize(size_t(size) * 3);
+#pragma omp parallel for
+        for (int i = 0; i < size; i++)
+        {
+          const char* r = p + (long long)(i) * stride + PlySizes[property.count];
+          for (int j = 0; j < 3; j++)
+            t[i * 3 + j] = int(PlyValue(r + j * PlySizes[property.type], property.type, swap));
+        }
+        p += element.size * stride;
+        continue;
+      }
+    }
+
+    // Generic sequential reading
+    std::vector<int> polygon;
+    for (long long i = 0; i < element.size; i++)
+    {
+      double x[10] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 1.0 };
+      for (int j = 0; j < np; j++)
+      {
+        const PlyProperty& property = element.properties[j];
+        int items = 1;
+        double value = 0.0;
+        if (property.count != -1)
+        {
+          if (format == 0)
+          {
+            if (!PlyText(p, end, value))
+              return false;
+          }
+          else
+          {
+            if (end - p < PlySizes[property.count])
+              return false;
+            value = PlyValue(p, property.count, swap);
+            p += PlySizes[property.count];
+          }
+          items = int(value);
+          if (items < 0)
+            return false;
+          polygon.clear();
+        }
+        for (int k = 0; k < items; k++)
+        {
+          if (format == 0)
+          {
+            // Round to the declared precision, so that ASCII and binary files give the same values
+            if (!PlyText(p, end, value))
+              return false;
+            if (property.type == 6)
+              value = float(value);
+          }
+          else
+          {
+            if (end - p < PlySizes[property.type])
+              return false;
+            value = PlyValue(p, property.type, swap);
+            p += PlySizes[property.type];
+          }
+          if (j == list)
+            polygon.push_back(int(value));
+        }
+        for (int k = 0; k < 10 && vertex; k++)
+        {
+          if (slot[k] == j)
+            x[k] = value * (k >= 6 ? PlyColorScale(type[k]) : 1.0);
+        }
+        if (j == list)
+        {
+          for (int k = 1; k < int(polygon.size()) - 1; k++)
+          {
+            t.push_back(polygon[0]);
+            t.push_back(polygon[k]);
+            t.push_back(polygon[k + 1]);
+          }
+        }
+      }
+      if (vertex)
+      {
+        v[i] = Vector(x[0], x[1], x[2]);
+        if (normal)
+          n[i] = Vector(x[3], x[4], x[5]);
+        if (color)
+          c[i] = Color(x[6], x[7], x[8], x[9]);
+      }
+    }
+  }
+
+  // Check indexes
+  const int nv = int(v.size());
+  for (int i : t)
+  {
+    if (i < 0 || i >= nv)
+      return false;
+  }
+  return true;
+}
+
+/*!
+\brief Hash of a triple of indexes.
+*/
+struct PlyCornerHash
+{
+  size_t operator()(const std::array<int, 3>& k) const
+  {
+    return std::hash<long long>()((long long)(k[0]) * 73856093LL ^ (long long)(k[1]) * 19349663LL ^ (long long)(k[2]) * 83492791LL);
+  }
+};
+
+/*!
+\brief Write a .ply file.
+
+Vertices are written as floats, colors as unsigned chars and faces as triangles. Corners sharing a vertex with
+different normals or colors are split into separate vertices, since .ply files only store vertex attributes.
+\param url File name.
+\param binary Binary flag, binary files use the byte order of the host.
+\param v,n,c Vertices, normals and colors, colors may be null.
+\param va,na,ca Vertex, normal and color indexes.
+*/
+static bool PlyWrite(const std::string& url, bool binary, const std::vector<Vector>& v, const std::vector<Vector>& n, const std::vector<Color>* c,
+  const std::vector<int>& va, const std::vector<int>& na, const std::vector<int>* ca)
+{
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+
+  // Vertices of the file as triples of vertex, normal and color indexes
+  std::vector<std::array<int, 3>> corners;
+  std::vector<int> t(va.size());
+  if (na == va && (ca == nullptr || *ca == va))
+  {
+    corners.resize(v.size());
+    for (int i = 0; i < int(v.size()); i++)
+      corners[i] = { i, i, i };
+    t = va;
+  }
+  else
+  {
+    std::unordered_map<std::array<int, 3>, int, PlyCornerHash> split;
+    for (int i = 0; i < int(va.size()); i++)
+    {
+      const std::array<int, 3> k = { va[i], na[i], ca != nullptr ? (*ca)[i] : 0 };
+      std::unordered_map<std::array<int, 3>, int, PlyCornerHash>::const_iterator it = split.find(k);
+      if (it != split.end())
+      {
+        t[i] = it->second;
+      }
+      else
+      {
+        t[i] = int(corners.size());
+        split[k] = t[i];
+        corners.push_back(k);
+      }
+    }
+  }
+
+  const int nv = int(corners.size());
+  const int nt = int(t.size()) / 3;
+  const bool normal = !n.empty();
+  out << "ply\n";
+  out << "format " << (binary ? (PlyLittleEndian() ? "binary_little_endian" : "binary_big_endian") : "ascii") << " 1.0\n";
+  out << "comment TinyMesh\n";
+  out << "element vertex " << nv << "\n";
+  out << "property float x\nproperty float y\nproperty float z\n";
+  if (normal)
+    out << "property float nx\nproperty float ny\nproperty float nz\n";
+  if (c != nullptr)
+    out << "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n";
+  out << "element face " << nt << "\n";
+  out << "property list uchar int vertex_indices\n";
+  out << "end_header\n";
+
+  auto channel = [](double x) -> unsigned char
+  {
+    return (unsigned char)(Math::Clamp(x) * 255.0 + 0.5);
+  };
+
+  if (binary)
+  {
+    // Records formatted in parallel in a single buffer
+    const int stride = 12 + (normal ? 12 : 0) + (c != nullptr ? 4 : 0);
+    std::vector<char> buffer(size_t(nv) * stride + size_t(nt) * 13);
+#pragma omp parallel for
+    for (int i = 0; i < nv; i++)
+    {
+      char* r = buffer.data() + size_t(i) * stride;
+      const Vector& p = v[corners[i][0]];
+      const float x[6] = { float(p[0]), float(p[1]), float(p[2]),
+        normal ? float(n[corners[i][1]][0]) : 0.0f, normal ? float(n[corners[i][1]][1]) : 0.0f, normal ? float(n[corners[i][1]][2]) : 0.0f };
+      memcpy(r, x, normal ? 24 : 12);
+      if (c != nullptr)
+      {
+        const Color& k = (*c)[corners[i][2]];
+        const unsigned char rgba[4] = { channel(k[0]), channel(k[1]), channel(k[2]), channel(k[3]) };
+        memcpy(r + (normal ? 24 : 12), rgba, 4);
+      }
+    }
+#pragma omp parallel for
+    for (int i = 0; i < nt; i++)
+    {
+      char* r = buffer.data() + size_t(nv) * stride + size_t(i) * 13;
+      r[0] = 3;
+      const int32_t x[3] = { t[i * 3], t[i * 3 + 1], t[i * 3 + 2] };
+      memcpy(r + 1, x, 12);
+    }
+    out.write(buffer.data(), buffer.size());
+  }
+  else
+  {
+    // Lines formatted with the shortest representation of the floats
+    std::vector<char> buffer(size_t(nv) * 128 + size_t(nt) * 40);
+    char* r = buffer.data();
+    char* e = r + buffer.size();
+    auto real = [&](double x, char separator)
+    {
+      r = std::to_chars(r, e, float(x)).ptr;
+      *r++ = separator;
+    };
+    for (int i = 0; i < nv; i++)
+    {
+      const Vector& p = v[corners[i][0]];
+      real(p[0], ' ');
+      real(p[1], ' ');
+      real(p[2], (normal || c != nullptr) ? ' ' : '\n');
+      if (normal)
+      {
+        const Vector& q = n[corners[i][1]];
+        real(q[0], ' ');
+        real(q[1], ' ');
+        real(q[2], c != nullptr ? ' ' : '\n');
+      }
+      if (c != nullptr)
+      {
+        const Color& k = (*c)[corners[i][2]];
+        for (int j = 0; j < 4; j++)
+        {
+          r = std::to_chars(r, e, int(channel(k[j]))).ptr;
+          *r++ = (j < 3) ? ' ' : '\n';
+        }
+      }
+    }
+    for (int i = 0; i < nt; i++)
+    {
+      *r++ = '3';
+      for (int j = 0; j < 3; j++)
+      {
+        *r++ = ' ';
+        r = std::to_chars(r, e, t[i * 3 + j]).ptr;
+      }
+      *r++ = '\n';
+    }
+    out.write(buffer.data(), r - buffer.data());
+  }
+  return bool(out);
+}
+
+/*!
+\brief Import a mesh from a .ply file, in ASCII or binary format.
+
+Binary vertex records and triangle faces are read in parallel directly from the memory mapped file.
+Polygons are triangulated as fans. Smooth normals are computed if the file does not store normals.
+\param url File name.
+\return Success.
+*/
+bool Mesh::LoadPly(const std::string& url)
+{
+  Invalidate();
+  std::vector<Color> c;
+  if (!PlyRead(url, vertices, normals, c, varray))
+  {
+    vertices.clear();
+    normals.clear();
+    varray.clear();
+    narray.clear();
+    return false;
+  }
+  if (normals.empty())
+  {
+    SmoothNormals();
+  }
+  narray.clear();
+  return true;
+}
+
+/*!
+\brief Save the mesh in .ply format, with vertices and normals.
+\param url File name.
+\param binary Binary flag, set to false for ASCII.
+\return Success.
+*/
+bool Mesh::SavePly(const std::string& url, bool binary) const
+{
+  return PlyWrite(url, binary, vertices, normals, nullptr, varray, NormalIndexes(), nullptr);
+}
+
+/*!
+\brief Import a colored mesh from a .ply file, in ASCII or binary format.
+
+Vertices are white if the file does not store colors.
+\sa Mesh::LoadPly
+\param url File name.
+\return Success.
+*/
+bool MeshColor::LoadPly(const std::string& url)
+{
+  Invalidate();
+  if (!PlyRead(url, vertices, normals, colors, varray))
+  {
+    vertices.clear();
+    normals.clear();
+    colors.clear();
+    varray.clear();
+    narray.clear();
+    carray.clear();
+    return false;
+  }
+  if (normals.empty())
+  {
+    SmoothNormals();
+  }
+  if (colors.empty())
+  {
+    colors.resize(vertices.size(), Color(1.0, 1.0, 1.0));
+  }
+  narray.clear();
+  carray.clear();
+  return true;
+}
+
+/*!
+\brief Save the mesh in .ply format, with vertices, normals and colors.
+\param url File name.
+\param binary Binary flag, set to false for ASCII.
+\return Success.
+*/
+bool MeshColor::SavePly(const std::string& url, bool binary) const
+{
+  return PlyWrite(url, binary, vertices, normals, &colors, varray, NormalIndexes(), &ColorIndexes());
+}
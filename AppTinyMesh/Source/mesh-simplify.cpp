@@ -0,0 +1,680 @@
+#include "mesh.h"
+#include "mesh-topology.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+/*!
+\brief Quadric error of a vertex, the weighted sum of the squared distances to a set of planes.
+*/
+struct SimplifyQuadric
+{
+  double q[10] = { 0.0 }; //!< Symmetric matrix, coefficients xx, xy, xz, xw, yy, yz, yw, zz, zw and ww.
+  double w = 0.0;         //!< Total area of the triangles, used for normalizing the error.
+
+  /*!
+  \brief Add the squared distance to a plane.
+  \param n Unit normal.
+  \param d Offset, so that the plane is n·p+d=0.
+  \param weight Weight.
+  */
+  void Add(const Vector& n, double d, double weight)
+  {
+    q[0] += weight * n[0] * n[0]; q[1] += weight * n[0] * n[1]; q[2] += weight * n[0] * n[2]; q[3] += weight * n[0] * d;
+    q[4] += weight * n[1] * n[1]; q[5] += weight * n[1] * n[2]; q[6] += weight * n[1] * d;
+    q[7] += weight * n[2] * n[2]; q[8] += weight * n[2] * d;
+    q[9] += weight * d * d;
+  }
+
+  //! Accumulate another quadric.
+  SimplifyQuadric& operator+=(const SimplifyQuadric& a)
+  {
+    for (int i = 0; i < 10; i++)
+      q[i] += a.q[i];
+    w += a.w;
+    return *this;
+  }
+
+  /*!
+  \brief Compute the error at a point, the mean squared distance to the planes.
+  \param p Point.
+  */
+  double Error(const Vector& p) const
+  {
+    const double x = p[0], y = p[1], z = p[2];
+    const double e = x * (q[0] * x + 2.0 * (q[1] * y + q[2] * z + q[3])) + y * (q[4] * y + 2.0 * (q[5] * z + q[6])) + z * (q[7] * z + 2.0 * q[8]) + q[9];
+    return (w > 0.0) ? std::max(e, 0.0) / w : std::max(e, 0.0);
+  }
+
+  /*!
+  \brief Compute the point that minimizes the error.
+  \param p Returned point.
+  \return False if the system is singular, for instance on flat or cylindrical regions.
+  */
+  bool Minimum(Vector& p) const
+  {
+    const double a00 = q[0], a01 = q[1], a02 = q[2], a11 = q[4], a12 = q[5], a22 = q[7];
+    const double c0 = a11 * a22 - a12 * a12;
+    const double c1 = a02 * a12 - a01 * a22;
+    const double c2 = a01 * a12 - a02 * a11;
+    const double det = a00 * c0 + a01 * c1 + a02 * c2;
+    const double scale = a00 + a11 + a22;
+    if (std::fabs(det) <= 1e-9 * scale * scale * scale)
+      return false;
+
+    // Inverse of the symmetric matrix with cofactors
+    const double i = 1.0 / det;
+    const double d00 = c0, d01 = c1, d02 = c2;
+    const double d11 = a00 * a22 - a02 * a02;
+    const double d12 = a01 * a02 - a00 * a12;
+    const double d22 = a00 * a11 - a01 * a01;
+    p = -i * Vector(d00 * q[3] + d01 * q[6] + d02 * q[8], d01 * q[3] + d11 * q[6] + d12 * q[8], d02 * q[3] + d12 * q[6] + d22 * q[8]);
+    return true;
+  }
+};
+
+/*!
+\brief Candidate edge collapse in the heap.
+*/
+struct SimplifyCollapse
+{
+  float cost;  //!< Error.
+  int a, b;    //!< Vertex kept and vertex removed.
+  int stamp;   //!< Sum of the versions of the vertices, the collapse is outdated if they changed.
+
+  //! Ordering for a min-heap.
+  bool operator<(const SimplifyCollapse& c) const
+  {
+    return cost > c.cost;
+  }
+};
+
+/*!
+\brief Simplify the mesh by collapsing edges with the quadric error metric.
+
+Every vertex accumulates the planes of its triangles weighted by their area, and the planes orthogonal to its boundary edges
+with a large weight, so that boundaries are preserved. Edges are collapsed by increasing error into the point that minimizes
+the sum of the quadrics of their vertices, stored in a heap that is updated lazily.
+
+Vertices at the same position, up to a tolerance relative to the size of the mesh, are welded first, so that the seams of parametric meshes are not handled as boundaries.
+Collapses that would change the topology, flip a triangle, or move a non-manifold vertex are rejected.
+Normals that share the vertex indexes are averaged, other normals, and normals that differ across a seam, stay with their triangle corner.
+Attributes of derived classes follow with Mesh::Remap(), every removed vertex being merged into the vertex it was collapsed into.
+
+Quadrics and the initial collapses are computed in parallel; the topology of the mesh is used for the adjacency and is released.
+\param triangles Target number of triangles.
+\param error Maximum error, the root mean squared distance of the collapsed vertices to the planes of their original triangles, negative for no bound.
+\param measured Returned error of the worst collapse, if not null.
+\return The number of triangles.
+*/
+int Mesh::Simplify(int triangles, double error, double* measured)
+{
+  const int nv = Vertexes();
+  const int nt = Triangles();
+  if (measured)
+    *measured = 0.0;
+  if (nt <= triangles)
+    return nt;
+
+  bool vertexnormals = !normals.empty() && SharedIndexes() && normals.size() == vertices.size();
+
+  // Vertices at the same position up to rounding, such as the seams and the poles of parametric meshes, are welded so that the
+  // surface is a single component for the topology, otherwise seams are boundaries that fold when they are collapsed independently
+  const Box box = GetBox();
+  const double tolerance = 1e-9 * Norm(box.Diagonal());
+  std::vector<std::array<long long, 3>> key(nv);
+  std::vector<int> order(nv), weld(nv);
+#pragma omp parallel for
+  for (int v = 0; v < nv; v++)
+  {
+    for (int k = 0; k < 3; k++)
+      key[v][k] = (tolerance > 0.0) ? std::llround((vertices[v][k] - box[0][k]) / tolerance) : 0;
+    order[v] = v;
+  }
+  std::sort(order.begin(), order.end(), [&key](int a, int b) { return (key[a] != key[b]) ? key[a] < key[b] : a < b; });
+  bool welded = false, smooth = true;
+  for (int k = 0; k < nv; k++)
+  {
+    const int v = order[k];
+    weld[v] = v;
+    if (k > 0 && key[v] == key[order[k - 1]])
+    {
+      weld[v] = weld[order[k - 1]];
+      welded = true;
+      if (vertexnormals && Norm(normals[v] - normals[weld[v]]) > 1e-6)
+        smooth = false;
+    }
+  }
+  if (welded)
+  {
+    // Normals that differ across a seam stay with their triangle corners
+    if (!normals.empty() && SharedIndexes() && (!vertexnormals || !smooth))
+    {
+      narray = varray;
+      vertexnormals = false;
+    }
+#pragma omp parallel for
+    for (int c = 0; c < int(varray.size()); c++)
+      varray[c] = weld[varray[c]];
+    Invalidate();
+  }
+
+  // Vertex every vertex was welded or collapsed into, so that attributes of derived classes can be merged
+  std::vector<int> merged = weld;
+
+  const MeshTopology& topology = Topology();
+
+  // Adjacency, the live corners of vertex v are in refs[first[v]...first[v]+count[v]], lists are appended when vertices change
+  std::vector<int> first(nv), count(nv);
+  for (int v = 0, k = 0; v < nv; v++)
+  {
+    first[v] = k;
+    count[v] = topology.Valence(v);
+    k += count[v];
+  }
+  std::vector<int> refs(varray.size());
+#pragma omp parallel for
+  for (int v = 0; v < nv; v++)
+  {
+    for (int i = 0; i < count[v]; i++)
+      refs[first[v] + i] = topology.Corner(v, i);
+  }
+
+  // Boundary vertices have a second quadric constraining them to the boundary, kept apart so that it is not measured as an error
+  std::vector<unsigned char> locked(nv);
+  std::vector<int> constraint(nv, -1);
+  int nb = 0;
+  for (int v = 0; v < nv; v++)
+  {
+    locked[v] = !topology.IsManifoldVertex(v);
+    if (topology.IsBoundaryVertex(v))
+      constraint[v] = nb++;
+  }
+
+  // Quadrics of the vertices
+  std::vector<SimplifyQuadric> quadrics(nv), constraints(nb);
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (int v = 0; v < nv; v++)
+  {
+    SimplifyQuadric& q = quadrics[v];
+    for (int i = 0; i < count[v]; i++)
+    {
+      const int c = refs[first[v] + i];
+      const Vector a = vertices[varray[c]];
+      const Vector b = vertices[varray[MeshTopology::Next(c)]];
+      const Vector p = vertices[varray[MeshTopology::Prev(c)]];
+      const Vector n = (b - a) / (p - a);
+      const double area = 0.5 * Norm(n);
+      if (area > 0.0)
+      {
+        const Vector u = n / (2.0 * area);
+        q.Add(u, -(u * a), area);
+        q.w += area;
+      }
+
+      // Boundary edges from and to the vertex, with a plane orthogonal to the triangle
+      for (int h : { c, MeshTopology::Prev(c) })
+      {
+        if (!topology.IsBoundaryEdge(topology.Edge(h)))
+          continue;
+        const Vector e = vertices[varray[MeshTopology::Next(h)]] - vertices[varray[h]];
+        Vector o = e / n;
+        const double l = Norm(o);
+        if (l > 0.0)
+        {
+          o /= l;
+          constraints[constraint[v]].Add(o, -(o * vertices[varray[h]]), 1e3 * SquaredNorm(e));
+        }
+      }
+    }
+  }
+
+  // Collapse of an edge into the point of minimal error, or the best endpoint or midpoint if it is not defined or too far
+  std::vector<Vector> point = vertices;
+  auto cost = [&](int a, int b, Vector& p)
+  {
+    SimplifyQuadric q = quadrics[a];
+    q += quadrics[b];
+    for (int v : { a, b })
+    {
+      if (constraint[v] != -1)
+        q += constraints[constraint[v]];
+    }
+    if ((constraint[a] == -1) != (constraint[b] == -1))
+    {
+      p = (constraint[a] != -1) ? point[a] : point[b];
+      return q.Error(p);
+    }
+    // Ill-conditioned minima far from the edge are discarded
+    const Vector m = 0.5 * (point[a] + point[b]);
+    if (q.Minimum(p) && SquaredNorm(p - m) <= SquaredNorm(point[b] - point[a]))
+      return q.Error(p);
+    double e = q.Error(point[a]);
+    p = point[a];
+    for (const Vector& x : { point[b], m })
+    {
+      const double f = q.Error(x);
+      if (f < e)
+      {
+        e = f;
+        p = x;
+      }
+    }
+    return e;
+  };
+
+  // Initial collapses
+  const int ne = topology.Edges();
+  std::vector<SimplifyCollapse> heap(ne);
+#pragma omp parallel for
+  for (int e = 0; e < ne; e++)
+  {
+    const int h = topology.EdgeHalfEdge(e, 0);
+    const int a = topology.Origin(h);
+    const int b = topology.Target(h);
+    Vector p;
+    heap[e] = { (locked[a] || locked[b] || a == b) ? -1.0f : float(cost(a, b, p)), a, b, 0 };
+  }
+  heap.erase(std::remove_if(heap.begin(), heap.end(), [](const SimplifyCollapse& c) { return c.cost < 0.0f; }), heap.end());
+  std::make_heap(heap.begin(), heap.end());
+
+  // Collapses by increasing error
+  std::vector<int> version(nv, 0), mark(nv, 0);
+  std::vector<unsigned char> removed(nv, 0), dead(nt, 0);
+  std::vector<int> list;
+  const size_t capacity = 2 * refs.size() + 1024;
+  const double bound = error * error;
+  int stamp = 0;
+  int live = nt;
+  double worst = 0.0;
+  while (live > triangles && !heap.empty())
+  {
+    const SimplifyCollapse collapse = heap.front();
+    std::pop_heap(heap.begin(), heap.end());
+    heap.pop_back();
+
+    const int a = collapse.a;
+    const int b = collapse.b;
+    if (removed[a] || removed[b] || collapse.stamp != version[a] + version[b])
+      continue;
+    if (error >= 0.0 && collapse.cost > bound)
+      break;
+
+    // Topology, the common neighbors should be the apexes of the triangles of the edge
+    stamp += 2;
+    for (int i = 0; i < count[a]; i++)
+    {
+      const int c = refs[first[a] + i];
+      if (dead[c / 3])
+        continue;
+      mark[varray[MeshTopology::Next(c)]] = stamp;
+      mark[varray[MeshTopology::Prev(c)]] = stamp;
+    }
+    int faces = 0, common = 0;
+    for (int i = 0; i < count[b]; i++)
+    {
+      const int c = refs[first[b] + i];
+      if (dead[c / 3])
+        continue;
+      for (int w : { varray[MeshTopology::Next(c)], varray[MeshTopology::Prev(c)] })
+      {
+        if (w == a)
+          faces++;
+        else if (mark[w] == stamp)
+        {
+          mark[w] = stamp + 1;
+          common++;
+        }
+      }
+    }
+    if (faces == 0 || faces > 2 || common != faces || (faces == 2 && constraint[a] != -1 && constraint[b] != -1))
+      continue;
+
+    // Triangles should not flip
+    Vector p;
+    cost(a, b, p);
+    bool flip = false;
+    for (int v : { a, b })
+    {
+      for (int i = 0; i < count[v] && !flip; i++)
+      {
+        const int c = refs[first[v] + i];
+        const int x = varray[MeshTopology::Next(c)];
+        const int y = varray[MeshTopology::Prev(c)];
+        if (dead[c / 3] || x == a || x == b || y == a || y == b)
+          continue;
+        const Vector n = (point[x] - point[v]) / (point[y] - point[v]);
+        const Vector m = (point[x] - p) / (point[y] - p);
+        flip = n * m <= 0.25 * Norm(n) * Norm(m);
+      }
+    }
+    if (flip)
+      continue;
+
+    // Collapse b into a, the error of the surface is measured without the boundary constraints
+    SimplifyQuadric q = quadrics[a];
+    q += quadrics[b];
+    worst = std::max(worst, q.Error(p));
+    point[a] = p;
+    quadrics[a] = q;
+    if (constraint[a] == -1)
+      constraint[a] = constraint[b];
+    else if (constraint[b] != -1)
+      constraints[constraint[a]] += constraints[constraint[b]];
+    if (vertexnormals)
+      normals[a] = Normalized(normals[a] + normals[b]);
+    list.clear();
+    for (int i = 0; i < count[a]; i++)
+    {
+      const int c = refs[first[a] + i];
+      if (dead[c / 3])
+        continue;
+      if (varray[MeshTopology::Next(c)] == b || varray[MeshTopology::Prev(c)] == b)
+      {
+        dead[c / 3] = 1;
+        live--;
+      }
+      else
+        list.push_back(c);
+    }
+    for (int i = 0; i < count[b]; i++)
+    {
+      const int c = refs[first[b] + i];
+      if (dead[c / 3])
+        continue;
+      varray[c] = a;
+      list.push_back(c);
+    }
+    removed[b] = 1;
+    merged[b] = a;
+    version[a]++;
+    version[b]++;
+
+    // Lists of the live vertices are compacted when the storage has doubled
+    if (refs.size() + list.size() > capacity)
+    {
+      std::vector<int> compact;
+      compact.reserve(refs.size() / 2 + list.size());
+      for (int v = 0; v < nv; v++)
+      {
+        const int start = int(compact.size());
+        if (!removed[v] && v != a)
+        {
+          for (int i = 0; i < count[v]; i++)
+          {
+            if (!dead[refs[first[v] + i] / 3])
+              compact.push_back(refs[first[v] + i]);
+          }
+        }
+        first[v] = start;
+        count[v] = int(compact.size()) - start;
+      }
+      refs.swap(compact);
+    }
+    first[a] = int(refs.size());
+    count[a] = int(list.size());
+    refs.insert(refs.end(), list.begin(), list.end());
+
+    // Collapses of the edges of the new vertex
+    stamp += 2;
+    for (int c : list)
+    {
+      for (int w : { varray[MeshTopology::Next(c)], varray[MeshTopology::Prev(c)] })
+      {
+        if (mark[w] == stamp || locked[w])
+          continue;
+        mark[w] = stamp;
+        heap.push_back({ float(cost(a, w, p)), a, w, version[a] + version[w] });
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+  }
+
+  // Compact vertices, normals and triangles
+  std::vector<int> remap(nv, -1);
+  std::vector<Vector> v;
+  std::vector<Vector> n;
+  std::vector<int> va, na, triangle;
+  va.reserve(size_t(live) * 3);
+  triangle.reserve(live);
+  for (int t = 0; t < nt; t++)
+  {
+    if (dead[t])
+      continue;
+    triangle.push_back(t);
+    for (int k = 0; k < 3; k++)
+    {
+      const int c = 3 * t + k;
+      int& r = remap[varray[c]];
+      if (r == -1)
+      {
+        r = int(v.size());
+        v.push_back(point[varray[c]]);
+        if (vertexnormals)
+          n.push_back(normals[varray[c]]);
+      }
+      va.push_back(r);
+    }
+  }
+  if (!vertexnormals && !narray.empty())
+  {
+    std::vector<int> nremap(normals.size(), -1);
+    na.reserve(va.size());
+    for (int t = 0; t < nt; t++)
+    {
+      if (dead[t])
+        continue;
+      for (int k = 0; k < 3; k++)
+      {
+        int& r = nremap[narray[3 * t + k]];
+        if (r == -1)
+        {
+          r = int(n.size());
+          n.push_back(normals[narray[3 * t + k]]);
+        }
+        na.push_back(r);
+      }
+    }
+  }
+
+  // Merged vertices follow the vertex they were merged into, chains are compressed
+  for (int i = 0; i < nv; i++)
+  {
+    int r = i;
+    while (merged[r] != r)
+      r = merged[r];
+    for (int j = i; merged[j] != r; )
+    {
+      const int k = merged[j];
+      merged[j] = r;
+      j = k;
+    }
+  }
+  for (int i = 0; i < nv; i++)
+    merged[i] = remap[merged[i]];
+  Remap(merged, int(v.size()), triangle);
+
+  vertices.swap(v);
+  normals.swap(n);
+  varray.swap(va);
+  narray.swap(na);
+  Invalidate();
+  if (measured)
+    *measured = std::sqrt(worst);
+  return live;
+}
+
+/*!
+\brief Simplify the mesh by clustering its vertices in a grid, for instance to get a coarse level of detail instantly.
+
+Vertices in the same cell are merged. Triangles with two vertices in the same cell are removed, and triangles
+with the same cells and orientation are merged. The vertex of a cell minimizes the quadric error of the triangles
+of its vertices if it lies in the cell, otherwise it is the mean of the vertices weighted by their number of triangles.
+Normals are the mean normals of the triangles of the cells, and share the vertex indexes.
+Attributes of derived classes follow with Mesh::Remap(), the vertices of a cell being merged.
+
+Every step is a parallel pass over the vertices, the corners or the cells, corners are grouped by cell with a counting sort.
+\param size Size of the cells, enlarged if needed so that the grid has at most 2<sup>24</sup> cells.
+\param quadric Place the vertices with the quadric error, otherwise at the mean of the vertices.
+\return The number of triangles.
+*/
+int Mesh::Cluster(double size, bool quadric)
+{
+  const int nv = Vertexes();
+  const int nc = int(varray.size());
+  const int nt = nc / 3;
+  if (nt == 0 || !(size > 0.0))
+    return nt;
+
+  // Grid
+  const Box box = GetBox();
+  const Vector diagonal = box.Diagonal();
+  const double limit = double(1 << 24);
+  double cells = 0.0;
+  do
+  {
+    cells = 1.0;
+    for (int k = 0; k < 3; k++)
+      cells *= std::max(1.0, std::ceil(diagonal[k] / size));
+    if (cells > limit)
+      size *= 1.01 * std::cbrt(cells / limit);
+  } while (cells > limit);
+  int n[3];
+  for (int k = 0; k < 3; k++)
+    n[k] = int(std::max(1.0, std::ceil(diagonal[k] / size)));
+  const int ng = n[0] * n[1] * n[2];
+
+  // Cells of the vertices, occupied cells are numbered in order
+  std::vector<int> cell(nv);
+  std::vector<int> index(ng, 0);
+#pragma omp parallel for
+  for (int v = 0; v < nv; v++)
+  {
+    int g[3];
+    for (int k = 0; k < 3; k++)
+      g[k] = std::min(n[k] - 1, int((vertices[v][k] - box[0][k]) / size));
+    const int c = (g[2] * n[1] + g[1]) * n[0] + g[0];
+    cell[v] = c;
+#pragma omp atomic
+    index[c] |= 1;
+  }
+  int nk = 0;
+  for (int g = 0; g < ng; g++)
+  {
+    const int occupied = index[g];
+    index[g] = nk;
+    nk += occupied;
+  }
+
+  // Corners grouped by cluster
+  std::vector<int> key(nc);
+#pragma omp parallel for
+  for (int c = 0; c < nc; c++)
+    key[c] = index[cell[varray[c]]];
+  std::vector<int> start, corner;
+  Buckets(key, nk, start, corner);
+
+  // Vertices and normals, triangles are kept by their lowest cluster unless they are degenerate or duplicate
+  std::vector<Vector> point(nk), normal(nk);
+  std::vector<unsigned char> keep(nt, 0);
+#pragma omp parallel
+  {
+    std::vector<std::array<int, 3>> local;
+#pragma omp for schedule(dynamic, 256)
+    for (int k = 0; k < nk; k++)
+    {
+      SimplifyQuadric q;
+      Vector mean(0.0), sum(0.0);
+      local.clear();
+      for (int j = start[k]; j < start[k + 1]; j++)
+      {
+        const int c = corner[j];
+        const Vector a = vertices[varray[c]];
+        const Vector an = (vertices[varray[MeshTopology::Next(c)]] - a) / (vertices[varray[MeshTopology::Prev(c)]] - a);
+        mean += a;
+        sum += an;
+        const double l = Norm(an);
+        if (quadric && l > 0.0)
+        {
+          const Vector u = an / l;
+          q.Add(u, -(u * a), 0.5 * l);
+          q.w += 0.5 * l;
+        }
+
+        const int y = key[MeshTopology::Next(c)];
+        const int z = key[MeshTopology::Prev(c)];
+        if (y > k && z > k && y != z)
+          local.push_back({ y, z, c / 3 });
+      }
+      if (start[k + 1] == start[k])
+        continue;
+
+      point[k] = mean / double(start[k + 1] - start[k]);
+      Vector p;
+      if (quadric && q.Minimum(p))
+      {
+        // Cell of the cluster
+        const int g = cell[varray[corner[start[k]]]];
+        const Vector lower = box[0] + size * Vector(g % n[0], (g / n[0]) % n[1], g / (n[0] * n[1]));
+        if (p[0] >= lower[0] && p[1] >= lower[1] && p[2] >= lower[2] && p[0] <= lower[0] + size && p[1] <= lower[1] + size && p[2] <= lower[2] + size)
+          point[k] = p;
+      }
+      const double l = Norm(sum);
+      normal[k] = (l > 0.0) ? sum / l : Vector::Null;
+
+      std::sort(local.begin(), local.end());
+      for (int i = 0; i < int(local.size()); i++)
+      {
+        if (i == 0 || local[i][0] != local[i - 1][0] || local[i][1] != local[i - 1][1])
+          keep[local[i][2]] = 1;
+      }
+    }
+  }
+
+  // Clusters of the remaining triangles
+  std::vector<int> remap(nk);
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int k = 0; k < nk; k++)
+  {
+    int used = 0;
+    for (int j = start[k]; j < start[k + 1] && !used; j++)
+      used = keep[corner[j] / 3];
+    remap[k] = used;
+  }
+  std::vector<Vector> v, vn;
+  for (int k = 0; k < nk; k++)
+  {
+    if (remap[k] == 0)
+    {
+      remap[k] = -1;
+      continue;
+    }
+    remap[k] = int(v.size());
+    v.push_back(point[k]);
+    vn.push_back(normal[k]);
+  }
+  std::vector<int> va, triangle;
+  for (int t = 0; t < nt; t++)
+  {
+    if (!keep[t])
+      continue;
+    triangle.push_back(t);
+    for (int j = 0; j < 3; j++)
+      va.push_back(remap[key[3 * t + j]]);
+  }
+
+  // Vertices are merged into the vertex of their cluster
+  std::vector<int> vertex(nv);
+#pragma omp parallel for
+  for (int i = 0; i < nv; i++)
+    vertex[i] = remap[index[cell[i]]];
+  Remap(vertex, int(v.size()), triangle);
+
+  vertices.swap(v);
+  normals.swap(vn);
+  varray.swap(va);
+  narray.clear();
+  Invalidate();
+  return Triangles();
+}
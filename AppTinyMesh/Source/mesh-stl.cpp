@@ -0,0 +1,290 @@
+#include "mesh.h"
+#include "mapped-file.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+/*!
+\brief Welding key of a corner, either the bits of the coordinates or their quantized values.
+*/
+struct StlKey
+{
+  long long x[3]; //!< Components.
+  bool operator==(const StlKey& k) const
+  {
+    return x[0] == k.x[0] && x[1] == k.x[1] && x[2] == k.x[2];
+  }
+};
+
+/*!
+\brief Hash of a welding key, high bits select the bucket and low bits the slot in the table of the bucket.
+*/
+struct StlHash
+{
+  size_t operator()(const StlKey& k) const
+  {
+    // Mix the components with the finalizer of splitmix64
+    unsigned long long h = 0;
+    for (int i = 0; i < 3; i++)
+    {
+      h ^= (unsigned long long)(k.x[i]) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+      h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+      h = h ^ (h >> 31);
+    }
+    return size_t(h);
+  }
+};
+
+/*!
+\brief A corner with its welding key.
+*/
+struct StlCorner
+{
+  StlKey key; //!< Key.
+  int corner; //!< Index of the corner.
+};
+
+/*!
+\brief Compute the welding key of a point.
+\param p Point.
+\param epsilon Quantization step, exact coordinates are used if null.
+*/
+static inline StlKey StlWeld(const Vector& p, double epsilon)
+{
+  StlKey k;
+  for (int i = 0; i < 3; i++)
+  {
+    if (epsilon > 0.0)
+    {
+      k.x[i] = (long long)(floor(p[i] / epsilon + 0.5));
+    }
+    else
+    {
+      // Positive and negative zeros have different bits
+      const double x = p[i] + 0.0;
+      memcpy(&k.x[i], &x, sizeof(double));
+    }
+  }
+  return k;
+}
+
+/*!
+\brief Read the corners of the triangles of an ASCII .stl file.
+\param p,e Begin and end of the file.
+\param corners Returned corners, three per triangle.
+*/
+static bool StlText(const char* p, const char* e, std::vector<Vector>& corners)
+{
+  while (true)
+  {
+    // Next vertex keyword at the beginning of a token
+    const char* k = p;
+    while (k < e)
+    {
+      k = (const char*)memchr(k, 'v', e - k);
+      if (k == nullptr || (e - k > 6 && memcmp(k, "vertex", 6) == 0 && (k == p || k[-1] == ' ' || k[-1] == '\t' || k[-1] == '\n')))
+        break;
+      k++;
+    }
+    if (k == nullptr || k >= e)
+      break;
+
+    p = k + 6;
+    double x[3];
+    for (int i = 0; i < 3; i++)
+    {
+      while (p < e && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+        p++;
+      if (p < e && *p == '+')
+        p++;
+      const std::from_chars_result r = std::from_chars(p, e, x[i]);
+      if (r.ec != std::errc())
+        return false;
+      p = r.ptr;
+    }
+    corners.push_back(Vector(x[0], x[1], x[2]));
+  }
+  return corners.size() % 3 == 0;
+}
+
+/*!
+\brief Import a mesh from an .stl file, in ASCII or binary format.
+
+Triangles are stored as independent corners in .stl files. Corners with the same position are welded into shared vertices:
+corners are hashed on their coordinates, distributed into buckets that are welded in parallel, and vertices are numbered
+in the order of their first occurrence. Triangles that collapse after welding are dropped, and smooth normals are computed.
+\param url File name.
+\param epsilon Welding tolerance, coordinates are quantized with this step. Corners are welded if their coordinates are exactly the same if null.
+\return Success.
+*/
+bool Mesh::LoadStl(const std::string& url, double epsilon)
+{
+  Invalidate();
+  vertices.clear();
+  normals.clear();
+  varray.clear();
+  narray.clear();
+
+  MappedFile file(url);
+  if (!file.IsOpen())
+    return false;
+
+  const char* data = file.Data();
+  const size_t size = file.Size();
+
+  // Binary files are recognized from their size, since some of them also start with solid
+  uint32_t count = 0;
+  if (size >= 84)
+    memcpy(&count, data + 80, 4);
+  const bool solid = size >= 5 && memcmp(data, "solid", 5) == 0;
+  const bool binary = size >= 84 && (size == 84 + size_t(count) * 50 || (!solid && size > 84 + size_t(count) * 50));
+
+  std::vector<Vector> corners;
+  if (binary)
+  {
+    corners.resize(size_t(count) * 3);
+#pragma omp parallel for
+    for (int i = 0; i < int(count); i++)
+    {
+      const char* r = data + 84 + size_t(i) * 50 + 12;
+      float x[9];
+      memcpy(x, r, sizeof(x));
+      for (int j = 0; j < 3; j++)
+        corners[i * 3 + j] = Vector(x[j * 3], x[j * 3 + 1], x[j * 3 + 2]);
+    }
+  }
+  else if (!solid || !StlText(data, data + size, corners))
+  {
+    return false;
+  }
+
+  const int nc = int(corners.size());
+
+  // Corners scattered by bucket with a parallel counting sort over blocks of corners, keeping their order within a bucket
+  const int nb = 256;
+  const int nk = 64;
+  const int length = (nc + nk - 1) / nk;
+  std::vector<unsigned char> bucket(nc);
+  std::vector<int> offset(size_t(nb) * nk + 1, 0);
+#pragma omp parallel for
+  for (int k = 0; k < nk; k++)
+  {
+    for (int i = k * length; i < nc && i < (k + 1) * length; i++)
+    {
+      bucket[i] = (unsigned char)(StlHash()(StlWeld(corners[i], epsilon)) >> 56);
+      offset[bucket[i] * nk + k + 1]++;
+    }
+  }
+  for (int b = 0; b < nb * nk; b++)
+    offset[b + 1] += offset[b];
+
+  std::vector<StlCorner> sorted(nc);
+#pragma omp parallel for
+  for (int k = 0; k < nk; k++)
+  {
+    for (int i = k * length; i < nc && i < (k + 1) * length; i++)
+    {
+      StlCorner& c = sorted[offset[bucket[i] * nk + k]++];
+      c.key = StlWeld(corners[i], epsilon);
+      c.corner = i;
+    }
+  }
+
+  // Range of the buckets
+  std::vector<int> start(nb + 1);
+  for (int b = 0; b <= nb; b++)
+    start[b] = (b == 0) ? 0 : offset[b * nk - 1];
+
+  // First corner with the same key, with an open addressing table per bucket that fits in cache
+  std::vector<int> first(nc);
+#pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < nb; b++)
+  {
+    int capacity = 16;
+    while (capacity < 2 * (start[b + 1] - start[b]))
+      capacity *= 2;
+    std::vector<int> table(capacity, -1);
+    for (int j = start[b]; j < start[b + 1]; j++)
+    {
+      size_t h = StlHash()(sorted[j].key) & (capacity - 1);
+      while (table[h] != -1 && !(sorted[table[h]].key == sorted[j].key))
+        h = (h + 1) & (capacity - 1);
+      if (table[h] == -1)
+        table[h] = j;
+      first[sorted[j].corner] = sorted[table[h]].corner;
+    }
+  }
+  sorted.clear();
+
+  // Vertices numbered in the order of their first corner
+  std::vector<int> index(nc);
+  int nv = 0;
+  for (int i = 0; i < nc; i++)
+  {
+    if (first[i] == i)
+      index[i] = nv++;
+  }
+  vertices.resize(nv);
+#pragma omp parallel for
+  for (int i = 0; i < nc; i++)
+  {
+    if (first[i] == i)
+      vertices[index[i]] = corners[i];
+  }
+
+  // Triangles, without the collapsed ones
+  varray.reserve(nc);
+  for (int i = 0; i < nc; i += 3)
+  {
+    const int a = index[first[i]];
+    const int b = index[first[i + 1]];
+    const int c = index[first[i + 2]];
+    if (a == b || b == c || c == a)
+      continue;
+    varray.push_back(a);
+    varray.push_back(b);
+    varray.push_back(c);
+  }
+
+  SmoothNormals();
+  return true;
+}
+
+/*!
+\brief Save the mesh in binary .stl format.
+
+Every triangle is written with its own corners and its geometric normal. Triangles are formatted in parallel and written at once.
+\param url File name.
+\return Success.
+*/
+bool Mesh::SaveStl(const std::string& url) const
+{
+  std::ofstream out(url, std::ios::binary);
+  if (!out)
+    return false;
+
+  const int nt = Triangles();
+  std::vector<char> buffer(84 + size_t(nt) * 50, 0);
+  const char header[] = "binary stl";
+  memcpy(buffer.data(), header, sizeof(header));
+  const uint32_t count = nt;
+  memcpy(buffer.data() + 80, &count, 4);
+
+#pragma omp parallel for
+  for (int i = 0; i < nt; i++)
+  {
+    const Triangle t = GetTriangle(i);
+    const Vector n = t.Normal();
+    const float x[12] = { float(n[0]), float(n[1]), float(n[2]),
+      float(t[0][0]), float(t[0][1]), float(t[0][2]),
+      float(t[1][0]), float(t[1][1]), float(t[1][2]),
+      float(t[2][0]), float(t[2][1]), float(t[2][2]) };
+    memcpy(buffer.data() + 84 + size_t(i) * 50, x, sizeof(x));
+  }
+
+  out.write(buffer.data(), buffer.size());
+  return bool(out);
+}
@@ -0,0 +1,238 @@
+#include "mesh-topology.h"
+
+#include <mutex>
+#include <utility>
+
+/*!
+\class MeshTopology mesh-topology.h
+\brief Adjacency of the vertices, edges and triangles of a mesh.
+
+Half-edge h is the edge of its triangle that goes from the vertex of corner h to the vertex of the next corner,
+so that half-edges need not be stored, and the topology adds the opposite half-edges and the edges.
+Vertices know their incident corners and edges know their half-edges, in compressed sparse row format.
+
+The structure is built in linear time in parallel. Corners are sorted by vertex with a counting sort, and every edge is
+then matched around its lower vertex, which avoids a global sort on edge keys and any concurrent write.
+Edges are numbered by their lower vertex, so that the result does not depend on the number of threads.
+
+The topology of a mesh is cached, see Mesh::Topology().
+\code
+const MeshTopology& topology = mesh.Topology();
+std::vector<int> ring;
+for (int v = 0; v < topology.Vertexes(); v++)
+{
+  topology.Neighbors(v, ring);
+}
+\endcode
+*/
+
+/*!
+\brief Build the topology of a mesh.
+\param mesh The mesh.
+*/
+MeshTopology::MeshTopology(const Mesh& mesh) : varray(mesh.varray)
+{
+  const int nv = int(mesh.vertices.size());
+  const int nh = int(varray.size());
+  mesh.VertexCorners(vstart, vcorner);
+
+  // Half-edges grouped by their lower vertex, counted in a first pass and numbered in a second one
+  std::vector<int> hstart(nv + 1, 0);
+  std::vector<int> ecount(nv + 1, 0);
+  twin.assign(nh, -1);
+  edge.resize(nh);
+  ehalf.resize(nh);
+  for (int pass = 0; pass < 2; pass++)
+  {
+#pragma omp parallel
+    {
+      std::vector<std::pair<int, int>> local;
+#pragma omp for schedule(dynamic, 1024)
+      for (int v = 0; v < nv; v++)
+      {
+        // Half-edges of the lower vertex, with their other vertex: outgoing half-edges, and incoming half-edges from higher vertices
+        local.clear();
+        for (int j = vstart[v]; j < vstart[v + 1]; j++)
+        {
+          const int c = vcorner[j];
+          const int b = varray[Next(c)];
+          const int a = varray[Prev(c)];
+          if (b >= v)
+            local.push_back(std::make_pair(b, c));
+          if (a > v)
+            local.push_back(std::make_pair(a, Prev(c)));
+        }
+
+        // Sorted by other vertex and half-edge, lists are short
+        for (int i = 1; i < int(local.size()); i++)
+        {
+          const std::pair<int, int> x = local[i];
+          int k = i;
+          for (; k > 0 && x < local[k - 1]; k--)
+            local[k] = local[k - 1];
+          local[k] = x;
+        }
+
+        int edges = 0;
+        for (int i = 0; i < int(local.size()); i++)
+        {
+          if (i == 0 || local[i].first != local[i - 1].first)
+            edges++;
+        }
+        if (pass == 0)
+        {
+          hstart[v + 1] = int(local.size());
+          ecount[v + 1] = edges;
+          continue;
+        }
+
+        // Edges and their half-edges, opposite half-edges are linked on manifold edges
+        int e = ecount[v] - 1;
+        for (int i = 0, k = hstart[v]; i < int(local.size()); i++, k++)
+        {
+          if (i == 0 || local[i].first != local[i - 1].first)
+          {
+            e++;
+            estart[e] = k;
+          }
+          edge[local[i].second] = e;
+          ehalf[k] = local[i].second;
+        }
+        for (int i = 0; i < int(local.size()); )
+        {
+          int j = i + 1;
+          while (j < int(local.size()) && local[j].first == local[i].first)
+            j++;
+          if (j - i == 2)
+          {
+            const int h = local[i].second;
+            const int g = local[i + 1].second;
+            if (varray[h] != varray[g])
+            {
+              twin[h] = g;
+              twin[g] = h;
+            }
+          }
+          i = j;
+        }
+      }
+    }
+
+    if (pass == 0)
+    {
+      for (int v = 0; v < nv; v++)
+      {
+        hstart[v + 1] += hstart[v];
+        ecount[v + 1] += ecount[v];
+      }
+      estart.resize(size_t(ecount[nv]) + 1);
+      estart[ecount[nv]] = nh;
+    }
+  }
+
+  // Boundary and non-manifold edges
+  const int ne = Edges();
+  int nb = 0;
+  int ns = 0;
+#pragma omp parallel for reduction(+:nb, ns)
+  for (int e = 0; e < ne; e++)
+  {
+    if (IsBoundaryEdge(e))
+      nb++;
+    else if (!IsManifoldEdge(e))
+      ns++;
+  }
+  boundary = nb;
+  singular = ns;
+
+  // Fans of triangles around the vertices, walking from corner to corner across opposite half-edges
+  flags.assign(nv, 0);
+  std::vector<unsigned char> visited(nh, 0);
+  int fanned = 0;
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:fanned)
+  for (int v = 0; v < nv; v++)
+  {
+    unsigned char f = 0;
+    int fans = 0;
+    for (int j = vstart[v]; j < vstart[v + 1]; j++)
+    {
+      const int c = vcorner[j];
+      if (!IsManifoldEdge(edge[c]) || !IsManifoldEdge(edge[Prev(c)]))
+        f |= NonManifold;
+      if (IsBoundaryEdge(edge[c]) || IsBoundaryEdge(edge[Prev(c)]))
+        f |= Boundary;
+    }
+
+    // Open fans start at corners without previous corner, closed fans are the remaining cycles
+    for (int open = 1; open >= 0; open--)
+    {
+      for (int j = vstart[v]; j < vstart[v + 1]; j++)
+      {
+        int c = vcorner[j];
+        if (visited[c] || (open == 1 && twin[Prev(c)] != -1))
+          continue;
+        fans++;
+        while (c != -1 && !visited[c])
+        {
+          visited[c] = 1;
+          c = (twin[c] == -1) ? -1 : Next(twin[c]);
+        }
+      }
+    }
+    if (fans > 1)
+      f |= NonManifold;
+    flags[v] = f;
+    if (f & NonManifold)
+      fanned++;
+  }
+  nonmanifold = fanned;
+}
+
+/*!
+\brief Compute the neighbors of a vertex.
+\param v Vertex.
+\param ring Returned neighboring vertices, sorted and without duplicates.
+*/
+void MeshTopology::Neighbors(int v, std::vector<int>& ring) const
+{
+  ring.clear();
+  for (int j = vstart[v]; j < vstart[v + 1]; j++)
+  {
+    const int c = vcorner[j];
+    for (int w : { varray[Next(c)], varray[Prev(c)] })
+    {
+      if (w == v)
+        continue;
+      int k = int(ring.size());
+      ring.push_back(w);
+      for (; k > 0 && w < ring[k - 1]; k--)
+        ring[k] = ring[k - 1];
+      ring[k] = w;
+      if (k > 0 && ring[k - 1] == w)
+        ring.erase(ring.begin() + k);
+    }
+  }
+}
+
+/*!
+\brief Return the topology of the mesh, which is built on first use and cached until the mesh is edited.
+
+The cache is shared by copies of the mesh. As for Mesh::Bvh(), the first call may come from several threads:
+the build is guarded by a mutex and the cached pointer is read atomically.
+*/
+const MeshTopology& Mesh::Topology() const
+{
+  std::shared_ptr<const MeshTopology> adjacency = std::atomic_load(&topology);
+  if (!adjacency)
+  {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    adjacency = std::atomic_load(&topology);
+    if (!adjacency)
+    {
+      adjacency = std::make_shared<const MeshTopology>(*this);
+      std::atomic_store(&topology, adjacency);
+    }
+  }
+  return *adjacency;
+}
@@ -1,6 +1,7 @@
 #include "realtime.h"
 
 #include "meshcolor.h"
+#include "mesh-lod.h"
 
 #include <iostream>
 
@@ -39,18 +40,21 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
   bbox = mesh.GetBox();
 
   // Compute plain arrays of sorted vertices & normals
-  std::vector<int> vertexIndexes = mesh.VertexIndexes();
-  std::vector<int> normalIndexes = mesh.NormalIndexes();
+  const std::vector<int>& vertexIndexes = mesh.VertexIndexes();
+  const std::vector<int>& normalIndexes = mesh.NormalIndexes();
   assert(vertexIndexes.size() == normalIndexes.size());
 
-  int nbVertex = int(vertexIndexes.size());
+  // Vertices are uploaded once and indexed if normals share the vertex indexes, so that the post-transform cache is used
+  const bool indexed = mesh.SharedIndexes();
+  int nbIndex = int(vertexIndexes.size());
+  int nbVertex = indexed ? mesh.Vertexes() : nbIndex;
   int singleBufferSize = nbVertex * 3;
   float* vertices = new float[singleBufferSize];
   float* normals = new float[singleBufferSize];
   for (int i = 0; i < nbVertex; i++)
   {
-    int indexVertex = vertexIndexes[i];
-    int indexNormal = normalIndexes[i];
+    int indexVertex = indexed ? i : vertexIndexes[i];
+    int indexNormal = indexed ? i : normalIndexes[i];
 
     Vector vertex = mesh.Vertex(indexVertex);
     vertices[i * 3 + 0] = float(vertex[0]);
@@ -62,11 +66,11 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
     normals[i * 3 + 1] = float(normal[1]);
     normals[i * 3 + 2] = float(normal[2]);
   }
-  // Indices are now sorted
-  int* indices = new int[nbVertex];
-  for (int i = 0; i < nbVertex; i++)
-    indices[i] = i;
-  triangleCount = nbVertex;
+  // Indices are now sorted, unless vertices are indexed
+  int* indices = new int[nbIndex];
+  for (int i = 0; i < nbIndex; i++)
+    indices[i] = indexed ? vertexIndexes[i] : i;
+  triangleCount = nbIndex;
 
   // Generate vao & buffers
   if (vao == 0)
@@ -101,12 +105,22 @@ MeshWidget::MeshGL::MeshGL(const Mesh& mesh, const Vector& position) : MeshGL()
   // Triangles
   glGenBuffers(1, &indexBuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbVertex, indices, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbIndex, indices, GL_STATIC_DRAW);
 
   // Free data
   delete[] vertices;
   delete[] normals;
   delete[] indices;
+
+  // Levels of detail
+  if (const MeshLod* lod = mesh.Lod())
+  {
+    for (int i = 0; i < lod->Levels(); i++)
+    {
+      levels.push_back(new MeshGL(lod->Level(i), position));
+      errors.push_back(lod->Error(i));
+    }
+  }
 }
 
 /*!
@@ -118,21 +132,24 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
   bbox = mesh.GetBox();
 
   // Compute plain arrays of sorted vertices & normals
-  std::vector<int> vertexIndexes = mesh.VertexIndexes();
-  std::vector<int> normalIndexes = mesh.NormalIndexes();
-  std::vector<int> colorIndexes = mesh.ColorIndexes();
+  const std::vector<int>& vertexIndexes = mesh.VertexIndexes();
+  const std::vector<int>& normalIndexes = mesh.NormalIndexes();
+  const std::vector<int>& colorIndexes = mesh.ColorIndexes();
   assert(vertexIndexes.size() == normalIndexes.size());
 
-  int nbVertex = int(vertexIndexes.size());
+  // Vertices are uploaded once and indexed if normals and colors share the vertex indexes, as for meshes without colors
+  const bool indexed = mesh.SharedIndexes();
+  int nbIndex = int(vertexIndexes.size());
+  int nbVertex = indexed ? mesh.Vertexes() : nbIndex;
   int singleBufferSize = nbVertex * 3;
   float* vertices = new float[singleBufferSize];
   float* normals = new float[singleBufferSize];
   float* colors = new float[singleBufferSize];
   for (int i = 0; i < nbVertex; i++)
   {
-    int indexVertex = vertexIndexes[i];
-    int indexNormal = normalIndexes[i];
-    int indexColor = colorIndexes[i];
+    int indexVertex = indexed ? i : vertexIndexes[i];
+    int indexNormal = indexed ? i : normalIndexes[i];
+    int indexColor = indexed ? i : colorIndexes[i];
 
     Vector vertex = mesh.Vertex(indexVertex);
     vertices[i * 3 + 0] = float(vertex[0]);
@@ -149,11 +166,11 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
     colors[i * 3 + 1] = float(color[1]);
     colors[i * 3 + 2] = float(color[2]);
   }
-  // Indices are now sorted
-  int* indices = new int[nbVertex];
-  for (int i = 0; i < nbVertex; i++)
-    indices[i] = i;
-  triangleCount = nbVertex;
+  // Indices are now sorted, unless vertices are indexed
+  int* indices = new int[nbIndex];
+  for (int i = 0; i < nbIndex; i++)
+    indices[i] = indexed ? vertexIndexes[i] : i;
+  triangleCount = nbIndex;
 
   // Generate vao & buffers
   if (vao == 0)
@@ -196,13 +213,26 @@ MeshWidget::MeshGL::MeshGL(const MeshColor& mesh, const Vector& fr) : MeshGL()
   // Triangles
   glGenBuffers(1, &indexBuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbVertex, indices, GL_STATIC_DRAW);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * nbIndex, indices, GL_STATIC_DRAW);
 
   // Free data
   delete[] vertices;
   delete[] normals;
   delete[] colors;
   delete[] indices;
+
+  // Levels of detail, simplification does not keep colors so that they are only drawn for meshes with a uniform color
+  const MeshLod* lod = mesh.Lod();
+  if (lod && mesh.Uniform())
+  {
+    const Color color = mesh.GetColors().empty() ? Color(1.0, 1.0, 1.0) : mesh.GetColor(0);
+    for (int i = 0; i < lod->Levels(); i++)
+    {
+      const Mesh& level = lod->Level(i);
+      levels.push_back(new MeshGL(MeshColor(level, std::vector<Color>(level.Vertexes(), color), std::vector<int>()), fr));
+      errors.push_back(lod->Error(i));
+    }
+  }
 }
 
 /*!
@@ -213,6 +243,13 @@ void MeshWidget::MeshGL::Delete()
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &fullBuffer);
   glDeleteBuffers(1, &indexBuffer);
+  for (MeshGL* level : levels)
+  {
+    level->Delete();
+    delete level;
+  }
+  levels.clear();
+  errors.clear();
 }
 
 /*!
@@ -387,9 +424,11 @@ void MeshWidget::paintGL()
     glUniform1i(glGetUniformLocation(mainShaderProgram, "material"), (int)i.value()->material);
     glUniform1i(glGetUniformLocation(mainShaderProgram, "shading"), (int)i.value()->shading);
 
-    // Draw
-    glBindVertexArray(i.value()->vao);
-    glDrawElements(GL_TRIANGLES, (GLsizei)i.value()->triangleCount, GL_UNSIGNED_INT, nullptr);
+    // Draw, with the coarsest level of detail whose projected error is small enough
+    const int level = SelectLevel(*i.value());
+    const MeshGL* drawn = (level < 0) ? i.value() : i.value()->levels[level];
+    glBindVertexArray(drawn->vao);
+    glDrawElements(GL_TRIANGLES, (GLsizei)drawn->triangleCount, GL_UNSIGNED_INT, nullptr);
   }
   profiler.EndGPU();
 
@@ -426,6 +465,28 @@ void MeshWidget::AddMesh(const QString& name, const MeshColor& mesh, const Vecto
   objects.insert(name, new MeshGL(mesh, frame));
 }
 
+/*!
+\brief Add a new mesh in the scene, the mesh is released as soon as it is uploaded.
+\param mesh new mesh
+\param frame mesh frame, identity by default.
+*/
+void MeshWidget::AddMesh(const QString& name, Mesh&& mesh, const Vector& frame)
+{
+  const Mesh uploaded(std::move(mesh));
+  AddMesh(name, uploaded, frame);
+}
+
+/*!
+\brief Add a new colored mesh in the scene, the mesh is released as soon as it is uploaded.
+\param mesh new colored mesh
+\param frame mesh frame, identity by default.
+*/
+void MeshWidget::AddMesh(const QString& name, MeshColor&& mesh, const Vector& frame)
+{
+  const MeshColor uploaded(std::move(mesh));
+  AddMesh(name, uploaded, frame);
+}
+
 /*!
 \brief Delete a mesh in the scene from its name.
 \param name mesh name
@@ -611,6 +672,37 @@ void MeshWidget::SetShadingGlobal(MeshShading shading)
     i.value()->shading = shading;
 }
 
+/*!
+\brief Set the projected error allowed when drawing levels of detail.
+\param pixels Tolerance in pixels, levels of detail are not used if it is null.
+*/
+void MeshWidget::SetLodTolerance(double pixels)
+{
+  lodTolerance = pixels;
+}
+
+/*!
+\brief Select the level of detail of a mesh, the coarsest one whose error projected at the distance of its box is below the tolerance.
+\param mesh The mesh.
+\return The level, or -1 for the original mesh.
+*/
+int MeshWidget::SelectLevel(const MeshGL& mesh) const
+{
+  if (mesh.errors.empty() || lodTolerance <= 0.0)
+    return -1;
+
+  // Size of a pixel at the distance of the box
+  double pixel = 2.0 * cameraOrthoSize / height();
+  if (perspectiveProjection)
+  {
+    const Vector center = mesh.bbox.Center() + Vector(mesh.TRSMatrix[12], mesh.TRSMatrix[13], mesh.TRSMatrix[14]);
+    const double distance = Math::Max(Norm(center - camera.Eye()) - mesh.bbox.Radius(), camera.GetNear());
+    pixel = 2.0 * distance * tan(0.5 * camera.GetAngleOfViewV(width(), height())) / height();
+  }
+
+  return MeshLod::Select(mesh.errors, lodTolerance * pixel);
+}
+
 
 /*!
 \brief Capture the rendering viewport and save it to disk.
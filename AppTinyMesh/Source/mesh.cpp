@@ -28,6 +28,17 @@ Mesh::Mesh(const std::vector<Vector>& vertices, const std::vector<int>& indices)
 	normals.resize(vertices.size(), Vector::Z);
 }
 
+/*!
+\brief Create the mesh with normals that share the vertex indexes.
+
+\param vertices Array of vertices.
+\param normals Array of normals, with one normal per vertex.
+\param va Array of vertex indexes.
+*/
+Mesh::Mesh(const std::vector<Vector>& vertices, const std::vector<Vector>& normals, const std::vector<int>& va) :vertices(vertices), normals(normals), varray(va)
+{
+}
+
 /*!
 \brief Create the mesh.
 
@@ -39,6 +50,28 @@ Mesh::Mesh(const std::vector<Vector>& vertices, const std::vector<Vector>& norma
 {
 }
 
+/*!
+\brief Create the mesh with normals that share the vertex indexes, the arrays are moved into the mesh.
+
+\param vertices Array of vertices.
+\param normals Array of normals, with one normal per vertex.
+\param va Array of vertex indexes.
+*/
+Mesh::Mesh(std::vector<Vector>&& vertices, std::vector<Vector>&& normals, std::vector<int>&& va) :vertices(std::move(vertices)), normals(std::move(normals)), varray(std::move(va))
+{
+}
+
+/*!
+\brief Create the mesh, the arrays are moved into the mesh.
+
+\param vertices Array of vertices.
+\param normals Array of normals.
+\param va, na Array of vertex and normal indexes.
+*/
+Mesh::Mesh(std::vector<Vector>&& vertices, std::vector<Vector>&& normals, std::vector<int>&& va, std::vector<int>&& na) :vertices(std::move(vertices)), normals(std::move(normals)), varray(std::move(va)), narray(std::move(na))
+{
+}
+
 /*!
 \brief Creates an axis aligned box.
 
@@ -131,6 +164,7 @@ Mesh::Mesh(const Sphere& sphere, int n)
 				AddSmoothTriangle(k1 + 1, k1 + 1, k2, k2, k2 + 1, k2 + 1);
 		}
 	}
+	ShareIndexes();
 }
 
 /*!
@@ -257,8 +291,9 @@ Mesh::Mesh(const Torus& torus, int n, int slice)
 	for (int j = 0; j < slice; j++)
 	{
 		for (int i = 0; i < p; i++)
-			AddSmoothQuadrangle(j * p + i, j * p + i, ((j + 1) % n) * p + i, ((j + 1) % n) * p + i, ((j + 1) % n) * p + (i + 1) % p, ((j + 1) % n) * p + (i + 1) % p, j * p + (i + 1) % p, j * p + (i + 1) % p);
+			AddSmoothQuadrangle(j * p + i, j * p + i, ((j + 1) % slice) * p + i, ((j + 1) % slice) * p + i, ((j + 1) % slice) * p + (i + 1) % p, ((j + 1) % slice) * p + (i + 1) % p, j * p + (i + 1) % p, j * p + (i + 1) % p);
 	}
+	ShareIndexes();
 }
 
 /*!
@@ -280,35 +315,173 @@ void Mesh::Reserve(int nv, int nn, int nvi, int nvn)
 	narray.reserve(nvn);
 }
 
+/*!
+\brief Check if normals share the vertex indexes, and if so release the array of normal indexes.
+
+Normal indexes are then the vertex indexes, and all accessors work unchanged.
+\return True if indexes are shared.
+*/
+bool Mesh::ShareIndexes()
+{
+	if (!SharedIndexes() && narray != varray)
+		return false;
+	narray.clear();
+	narray.shrink_to_fit();
+	return true;
+}
+
+/*!
+\brief Store the normal indexes explicitly if they are shared, before editing them.
+*/
+void Mesh::UnshareIndexes()
+{
+	if (SharedIndexes())
+		narray = varray;
+}
+
 /*!
 \brief Smooth the normals of the mesh.
 
-This function weights the normals of the faces by their corresponding area.
-\sa Triangle::AreaNormal()
+The normal of a vertex is the sum of the normals of its triangles, weighted either by their area or by the angle of the triangle at the vertex.
+Normals are gathered in parallel for every vertex from the list of its incident corners, without any concurrent writes, and normalized in the same loop.
+Vertices without triangles get a null normal. Normals share the vertex indexes.
+Levels of detail are released, as they keep the former normals.
+\sa Triangle::AreaNormal(), Mesh::VertexCorners()
+\param angle Angle weighting flag, normals are weighted by the area of the triangles if false.
 */
-void Mesh::SmoothNormals()
+void Mesh::SmoothNormals(bool angle)
 {
-	// Initialize 
-	normals.resize(vertices.size(), Vector::Null);
+	const int nv = int(vertices.size());
+	const int nt = Triangles();
+
+	narray.clear();
+	narray.shrink_to_fit();
 
-	narray = varray;
+	// The topology and the hierarchy do not depend on normals and are kept
+	lod.reset();
 
-	// Accumulate normals
-	for (int i = 0; i < varray.size(); i += 3)
+	// Normals of the triangles, weighted by their area
+	std::vector<Vector> tn(nt);
+#pragma omp parallel for
+	for (int i = 0; i < nt; i++)
 	{
-		Vector tn = Triangle(vertices[varray.at(i)], vertices[varray.at(i + 1)], vertices[varray.at(i + 2)]).AreaNormal();
-		normals[narray[i + 0]] += tn;
-		normals[narray[i + 1]] += tn;
-		normals[narray[i + 2]] += tn;
+		const Vector& a = vertices[varray[i * 3]];
+		tn[i] = 0.5 * ((vertices[varray[i * 3 + 1]] - a) / (vertices[varray[i * 3 + 2]] - a));
 	}
 
-	// Normalize 
-	for (int i = 0; i < normals.size(); i++)
+	std::vector<int> start, corner;
+	VertexCorners(start, corner);
+
+	// Gather and normalize
+	normals.resize(nv);
+#pragma omp parallel for
+	for (int i = 0; i < nv; i++)
 	{
-		Normalize(normals[i]);
+		Vector n = Vector::Null;
+		for (int j = start[i]; j < start[i + 1]; j++)
+		{
+			const int c = corner[j];
+			const int t = c / 3;
+			if (angle)
+			{
+				// Angle at the corner, with the robust atan2 formulation
+				const Vector u = vertices[varray[t * 3 + (c + 1) % 3]] - vertices[i];
+				const Vector v = vertices[varray[t * 3 + (c + 2) % 3]] - vertices[i];
+				const double l = Norm(tn[t]);
+				if (l > 0.0)
+					n += (atan2(Norm(u / v), u * v) / l) * tn[t];
+			}
+			else
+			{
+				n += tn[t];
+			}
+		}
+		const double l = Norm(n);
+		normals[i] = (l > 0.0) ? n * (1.0 / l) : Vector::Null;
 	}
 }
 
+/*!
+\brief Compute the corners incident to every vertex, in compressed sparse row format.
+\param start Returned offsets, the corners of vertex i are in the range [start[i], start[i + 1]).
+\param corner Returned corners, the triangle of corner c is c / 3.
+*/
+void Mesh::VertexCorners(std::vector<int>& start, std::vector<int>& corner) const
+{
+	Buckets(varray, int(vertices.size()), start, corner);
+}
+
+/*!
+\brief Group the items of an array by key, in compressed sparse row format.
+
+Items are distributed by ranges of keys with a parallel counting sort, and every range is then sorted by key in parallel.
+Items of a key are sorted by increasing index, so that the result does not depend on the number of threads.
+\param key Keys of the items, between 0 and n-1.
+\param n Number of keys.
+\param start Returned offsets, the items of key i are in the range [start[i], start[i + 1]).
+\param item Returned items.
+*/
+void Mesh::Buckets(const std::vector<int>& key, int n, std::vector<int>& start, std::vector<int>& item)
+{
+	const int ni = int(key.size());
+
+	// Buckets of consecutive keys and blocks of consecutive items
+	int shift = 0;
+	while ((n - 1) >> shift >= 256)
+		shift++;
+	const int nb = n > 0 ? ((n - 1) >> shift) + 1 : 0;
+	const int nk = 64;
+	const int length = (ni + nk - 1) / nk;
+
+	std::vector<int> offset(size_t(nb) * nk + 1, 0);
+#pragma omp parallel for
+	for (int k = 0; k < nk; k++)
+	{
+		for (int i = k * length; i < ni && i < (k + 1) * length; i++)
+			offset[(key[i] >> shift) * nk + k + 1]++;
+	}
+	for (int b = 0; b < nb * nk; b++)
+		offset[b + 1] += offset[b];
+
+	// Items and their key, scattered by bucket
+	std::vector<int> sorted(ni), keys(ni);
+#pragma omp parallel for
+	for (int k = 0; k < nk; k++)
+	{
+		for (int i = k * length; i < ni && i < (k + 1) * length; i++)
+		{
+			const int j = offset[(key[i] >> shift) * nk + k]++;
+			sorted[j] = i;
+			keys[j] = key[i];
+		}
+	}
+
+	// Sort every bucket by key
+	start.resize(n + 1);
+	item.resize(ni);
+#pragma omp parallel for schedule(dynamic)
+	for (int b = 0; b < nb; b++)
+	{
+		const int first = b << shift;
+		const int last = (first + (1 << shift) < n) ? first + (1 << shift) : n;
+		const int begin = (b == 0) ? 0 : offset[b * nk - 1];
+		const int end = offset[(b + 1) * nk - 1];
+
+		std::vector<int> fill(last - first + 1, 0);
+		for (int j = begin; j < end; j++)
+			fill[keys[j] - first + 1]++;
+		fill[0] = begin;
+		for (int i = first; i < last; i++)
+		{
+			fill[i - first + 1] += fill[i - first];
+			start[i] = fill[i - first];
+		}
+		for (int j = begin; j < end; j++)
+			item[fill[keys[j] - first]++] = sorted[j];
+	}
+	start[n] = ni;
+}
+
 /*!
 \brief Add a smooth triangle to the geometry.
 \param a, b, c Index of the vertices.
@@ -316,6 +489,8 @@ void Mesh::SmoothNormals()
 */
 void Mesh::AddSmoothTriangle(int a, int na, int b, int nb, int c, int nc)
 {
+	UnshareIndexes();
+	Invalidate();
 	varray.push_back(a);
 	narray.push_back(na);
 	varray.push_back(b);
@@ -331,6 +506,8 @@ void Mesh::AddSmoothTriangle(int a, int na, int b, int nb, int c, int nc)
 */
 void Mesh::AddTriangle(int a, int b, int c, int n)
 {
+	UnshareIndexes();
+	Invalidate();
 	varray.push_back(a);
 	narray.push_back(n);
 	varray.push_back(b);
@@ -384,6 +561,7 @@ Box Mesh::GetBox() const
 */
 void Mesh::Scale(double s)
 {
+	Invalidate();
 	// Vertexes
 	for (int i = 0; i < vertices.size(); i++)
 	{
@@ -405,6 +583,7 @@ void Mesh::Scale(double s)
 */
 void Mesh::Scale(const Matrix3& m)
 {
+	Invalidate();
 	const Matrix3 m_inv_t = m.Inverse().Transpose();
 	for (int i = 0; i < vertices.size(); i++)
 	{
@@ -418,6 +597,7 @@ void Mesh::Scale(const Matrix3& m)
 */
 void Mesh::Rotate(const Matrix3& m)
 {
+	Invalidate();
 	for (int i = 0; i < vertices.size(); i++)
 		vertices[i] = m * vertices[i];
 	for (int i = 0; i < normals.size(); i++)
@@ -427,6 +607,7 @@ void Mesh::Rotate(const Matrix3& m)
 
 void Mesh::SphereWarp(const Vector& c, double r, const Vector& d)
 {
+	Invalidate();
 	for (int i = 0; i < vertices.size(); i++)
 	{
 		const double dd = Norm(vertices[i] - c);
@@ -438,83 +619,129 @@ void Mesh::SphereWarp(const Vector& c, double r, const Vector& d)
 	SmoothNormals();
 }
 
-
-#include <QtCore/QFile>
-#include <QtCore/QTextStream>
-#include <QtCore/QRegularExpression>
-#include <QtCore/qstring.h>
+/*!
+\brief Compute the cross-section of the mesh by a plane.
+\param c,n Point on the plane and normal.
+\param contours Returned contours.
+*/
+void Mesh::Slice(const Vector& c, const Vector& n, std::vector<Contour>& contours) const
+{
+	std::vector<std::vector<Contour>> stack;
+	Slice(c, n, 0.0, 1, stack);
+	contours.swap(stack[0]);
+}
 
 /*!
-\brief Import a mesh from an .obj file.
-\param filename File name.
+\brief Compute the cross-sections of the mesh by a stack of parallel planes.
+
+Signed distances of the vertices are computed once, and triangles are bucketed by the range of planes they span,
+so that every plane only processes the triangles that cross it. Planes are processed in parallel.
+
+A vertex lying on a plane is considered above it, and crossing points are computed on edges from their end vertex indexes,
+so that neighboring triangles share bitwise identical points that are chained with the edge keys.
+\param c,n Point on the first plane and normal.
+\param spacing Distance between two planes.
+\param count Number of planes.
+\param stack Returned contours, for every plane.
 */
-void Mesh::Load(const QString& filename)
+void Mesh::Slice(const Vector& c, const Vector& n, double spacing, int count, std::vector<std::vector<Contour>>& stack) const
 {
-	vertices.clear();
-	normals.clear();
-	varray.clear();
-	narray.clear();
+	stack.clear();
+	stack.resize(count);
 
-	QFile data(filename);
+	const Vector z = Normalized(n);
+	const int nv = int(vertices.size());
+	const int nt = Triangles();
 
-	if (!data.open(QFile::ReadOnly))
-		return;
-	QTextStream in(&data);
+	// Signed distances to the first plane
+	std::vector<double> d(nv);
+#pragma omp parallel for
+	for (int i = 0; i < nv; i++)
+	{
+		d[i] = (vertices[i] - c) * z;
+	}
 
-	// Set of regular expressions : Vertex, Normal, Triangle
-	QRegularExpression rexv("v\\s*([-|+|\\s]\\d*\\.\\d+)\\s*([-|+|\\s]\\d*\\.\\d+)\\s*([-|+|\\s]\\d*\\.\\d+)");
-	QRegularExpression rexn("vn\\s*([-|+|\\s]\\d*\\.\\d+)\\s*([-|+|\\s]\\d*\\.\\d+)\\s*([-|+|\\s]\\d*\\.\\d+)");
-	QRegularExpression rext("f\\s*(\\d*)/\\d*/(\\d*)\\s*(\\d*)/\\d*/(\\d*)\\s*(\\d*)/\\d*/(\\d*)");
-	while (!in.atEnd())
+	// Range of planes spanned by a triangle, widened by one to be robust to rounding
+	auto range = [&](int t, int& ka, int& kb)
 	{
-		QString line = in.readLine();
-		QRegularExpressionMatch match = rexv.match(line);
-		QRegularExpressionMatch matchN = rexn.match(line);
-		QRegularExpressionMatch matchT = rext.match(line);
-		if (match.hasMatch())//rexv.indexIn(line, 0) > -1)
+		double a = d[varray[t * 3]], b = a;
+		for (int j = 1; j < 3; j++)
+		{
+			a = Math::Min(a, d[varray[t * 3 + j]]);
+			b = Math::Max(b, d[varray[t * 3 + j]]);
+		}
+		if (count == 1 || spacing <= 0.0)
 		{
-			Vector q = Vector(match.captured(1).toDouble(), match.captured(2).toDouble(), match.captured(3).toDouble()); vertices.push_back(q);
+			ka = 0;
+			kb = count - 1;
 		}
-		else if (matchN.hasMatch())//rexn.indexIn(line, 0) > -1)
+		else
 		{
-			Vector q = Vector(matchN.captured(1).toDouble(), matchN.captured(2).toDouble(), matchN.captured(3).toDouble());  normals.push_back(q);
+			ka = Math::Max(0, int(floor(a / spacing)));
+			kb = Math::Min(count - 1, int(floor(b / spacing)) + 1);
 		}
-		else if (matchT.hasMatch())//rext.indexIn(line, 0) > -1)
+	};
+
+	// Triangles per plane
+	std::vector<int> start(count + 1, 0);
+	for (int t = 0; t < nt; t++)
+	{
+		int ka, kb;
+		range(t, ka, kb);
+		for (int k = ka; k <= kb; k++)
+			start[k + 1]++;
+	}
+	for (int k = 0; k < count; k++)
+		start[k + 1] += start[k];
+
+	std::vector<int> bucket(start[count]);
+	std::vector<int> fill(start.begin(), start.end() - 1);
+	for (int t = 0; t < nt; t++)
+	{
+		int ka, kb;
+		range(t, ka, kb);
+		for (int k = ka; k <= kb; k++)
+			bucket[fill[k]++] = t;
+	}
+
+#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < count; k++)
+	{
+		const double h = k * spacing;
+		std::vector<long long> keys;
+		std::vector<Vector> points;
+		for (int b = start[k]; b < start[k + 1]; b++)
 		{
-			varray.push_back(matchT.captured(1).toInt() - 1);
-			varray.push_back(matchT.captured(3).toInt() - 1);
-			varray.push_back(matchT.captured(5).toInt() - 1);
-			narray.push_back(matchT.captured(2).toInt() - 1);
-			narray.push_back(matchT.captured(4).toInt() - 1);
-			narray.push_back(matchT.captured(6).toInt() - 1);
+			const int t = bucket[b];
+			for (int j = 0; j < 3; j++)
+			{
+				int ia = varray[t * 3 + j];
+				int ib = varray[t * 3 + (j + 1) % 3];
+				if ((d[ia] - h >= 0.0) == (d[ib] - h >= 0.0))
+					continue;
+				if (ia > ib)
+					std::swap(ia, ib);
+
+				const double da = d[ia] - h;
+				const double db = d[ib] - h;
+				keys.push_back((long long)(ia) * nv + ib);
+				points.push_back(vertices[ia] + (vertices[ib] - vertices[ia]) * (da / (da - db)));
+			}
 		}
+		Contour::Chain(keys, points, stack[k]);
 	}
-	data.close();
 }
 
+
+#include <QtCore/qstring.h>
+
 /*!
-\brief Save the mesh in .obj format, with vertices and normals.
-\param url Filename.
-\param meshName %Mesh name in .obj file.
+\brief Import a mesh from an .obj file.
+\sa Mesh::LoadObj
+\param filename File name.
 */
-void Mesh::SaveObj(const QString& url, const QString& meshName) const
+void Mesh::Load(const QString& filename)
 {
-	QFile data(url);
-	if (!data.open(QFile::WriteOnly))
-		return;
-	QTextStream out(&data);
-	out << "g " << meshName << Qt::endl;
-	for (int i = 0; i < vertices.size(); i++)
-		out << "v " << vertices.at(i)[0] << " " << vertices.at(i)[1] << " " << vertices.at(i)[2] << QString('\n');
-	for (int i = 0; i < normals.size(); i++)
-		out << "vn " << normals.at(i)[0] << " " << normals.at(i)[1] << " " << normals.at(i)[2] << QString('\n');
-	for (int i = 0; i < varray.size(); i += 3)
-	{
-		out << "f " << varray.at(i) + 1 << "//" << narray.at(i) + 1 << " "
-			<< varray.at(i + 1) + 1 << "//" << narray.at(i + 1) + 1 << " "
-			<< varray.at(i + 2) + 1 << "//" << narray.at(i + 2) + 1 << " "
-			<< "\n";
-	}
-	out.flush();
-	data.close();
+	// Narrow file APIs expect the local encoding, not UTF-8
+	LoadObj(std::string(filename.toLocal8Bit().constData()));
 }
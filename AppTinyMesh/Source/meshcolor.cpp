@@ -11,20 +11,42 @@ MeshColor::MeshColor()
 \brief Constructor from a Mesh with color array and indices.
 \param m Base mesh.
 \param cols Color array.
-\param carr Color indexes, should be the same size as Mesh::varray and Mesh::narray.
+\param carr Color indexes, should be the same size as Mesh::varray, or empty if colors share the vertex indexes.
 */
 MeshColor::MeshColor(const Mesh& m, const std::vector<Color>& cols, const std::vector<int>& carr) : Mesh(m), colors(cols), carray(carr)
 {
 }
 
 /*!
-\brief Constructor from a Mesh.
+\brief Constructor from a Mesh, with white vertices.
+
+Colors share the vertex indexes.
 \param m the base mesh
 */
 MeshColor::MeshColor(const Mesh& m) : Mesh(m)
 {
 	colors.resize(vertices.size(), Color(1.0, 1.0, 1.0));
-	carray = varray;
+}
+
+/*!
+\brief Constructor from a Mesh that is moved, with white vertices.
+
+Colors share the vertex indexes.
+\param m the base mesh
+*/
+MeshColor::MeshColor(Mesh&& m) : Mesh(std::move(m))
+{
+	colors.resize(vertices.size(), Color(1.0, 1.0, 1.0));
+}
+
+/*!
+\brief Constructor from a Mesh with color array and indices, which are all moved.
+\param m Base mesh.
+\param cols Color array.
+\param carr Color indexes, should be the same size as Mesh::varray, or empty if colors share the vertex indexes.
+*/
+MeshColor::MeshColor(Mesh&& m, std::vector<Color>&& cols, std::vector<int>&& carr) : Mesh(std::move(m)), colors(std::move(cols)), carray(std::move(carr))
+{
 }
 
 /*!
@@ -33,3 +55,78 @@ MeshColor::MeshColor(const Mesh& m) : Mesh(m)
 MeshColor::~MeshColor()
 {
 }
+
+/*!
+\brief Check if normals and colors share the vertex indexes, and if so release their arrays of indexes.
+\sa Mesh::ShareIndexes()
+\return True if both normal and color indexes are shared.
+*/
+bool MeshColor::ShareIndexes()
+{
+	const bool shared = Mesh::ShareIndexes();
+	if (carray.size() == varray.size() && carray != varray)
+		return false;
+	carray.clear();
+	carray.shrink_to_fit();
+	return shared;
+}
+
+/*!
+\brief Check if all the colors are the same.
+
+Levels of detail do not keep colors, so they are only drawn for meshes with a uniform color.
+*/
+bool MeshColor::Uniform() const
+{
+	for (const Color& color : colors)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			if (color[k] != colors[0][k])
+				return false;
+		}
+	}
+	return true;
+}
+
+/*!
+\brief Renumber the colors with the vertices and the triangles.
+
+Colors that share the vertex indexes are moved with their vertex, merged vertices get the mean of their colors.
+Otherwise color indexes are reordered with the triangles.
+\sa Mesh::Remap
+\param vertex New index of every vertex, -1 if it was removed.
+\param vertexes New number of vertices.
+\param triangle Former index of every new triangle.
+*/
+void MeshColor::Remap(const std::vector<int>& vertex, int vertexes, const std::vector<int>& triangle)
+{
+	if (carray.size() != varray.size())
+	{
+		std::vector<Color> c(vertexes, Color(0.0, 0.0, 0.0, 0.0));
+		std::vector<int> count(vertexes, 0);
+		for (int i = 0; i < int(vertex.size()) && i < int(colors.size()); i++)
+		{
+			if (vertex[i] == -1)
+				continue;
+			c[vertex[i]] += colors[i];
+			count[vertex[i]]++;
+		}
+		for (int i = 0; i < vertexes; i++)
+		{
+			if (count[i] > 1)
+				c[i] = c[i] / double(count[i]);
+		}
+		colors.swap(c);
+	}
+	else
+	{
+		std::vector<int> c(3 * triangle.size());
+		for (int k = 0; k < int(triangle.size()); k++)
+		{
+			for (int j = 0; j < 3; j++)
+				c[3 * k + j] = carray[3 * triangle[k] + j];
+		}
+		carray.swap(c);
+	}
+}
@@ -79,11 +79,18 @@ void MainWindow::SphereImplicitExample()
 	  cols[i] = Color(0.8, 0.8, 0.8);
 
 	meshColor = MeshColor(mesh, cols, mesh.VertexIndexes());
+
+	// Levels of detail are generated once when the mesh is created, the viewer draws the coarsest one that fits the screen
+	if (meshColor.Uniform())
+		meshColor.GenerateLod();
 	UpdateGeometry();
 }
 
 void MainWindow::UpdateGeometry()
 {
+	// Indexes repeating the vertex indexes are released, so that the mesh is uploaded with indexed vertices
+	meshColor.ShareIndexes();
+
 	meshWidget->ClearAll();
 	meshWidget->AddMesh("BoxMesh", meshColor);
 
@@ -0,0 +1,140 @@
+#include "ray-packet.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*!
+\class RayPacket ray-packet.h
+\brief A packet of rays stored in single precision structure of arrays, which traverses a hierarchy of boxes as a whole.
+
+Boxes are first tested against the whole packet with interval arithmetic over the origins and the inverses of the
+directions, after Wald et al. <I>Ray tracing deformable scenes using dynamic bounding volume hierarchies</I>, ACM
+Transactions on Graphics, 26(1), 2007: when the directions of the rays have the same signs, bounds of the entry and exit
+distances of all the rays are computed at once, which culls boxes missed by the whole packet without testing the rays.
+Remaining boxes are tested against every ray in parallel with the lanes of the build, see SimdLanes.
+
+Rounding is monotonic, so that the bounds computed in single precision also bound the distances of the rays,
+and culling never rejects a box that a ray of the packet would intersect. It is used by MeshBvh.
+*/
+
+/*!
+\brief Create a packet of rays.
+\param rays Rays.
+\param n Number of rays, at most Width.
+*/
+RayPacket::RayPacket(const Ray* rays, int n) :count(std::min(n, int(Width)))
+{
+  for (int k = 0; k < 3; k++)
+  {
+    oa[k] = ia[k] = INFINITY;
+    ob[k] = ib[k] = -INFINITY;
+    d[k] = 0.0f;
+  }
+  for (int i = 0; i < count; i++)
+  {
+    const Vector c = rays[i].Origin();
+    const Vector n = rays[i].Direction();
+    for (int k = 0; k < 3; k++)
+    {
+      // Null components of the direction are replaced by tiny ones, as for single rays
+      const double x = (std::fabs(n[k]) > 1.0e-30) ? n[k] : (n[k] < 0.0 ? -1.0e-30 : 1.0e-30);
+      o[k][i] = float(c[k]);
+      inv[k][i] = float(1.0 / x);
+      d[k] += float(n[k]);
+      oa[k] = std::min(oa[k], o[k][i]);
+      ob[k] = std::max(ob[k], o[k][i]);
+      ia[k] = std::min(ia[k], inv[k][i]);
+      ib[k] = std::max(ib[k], inv[k][i]);
+    }
+  }
+  for (int k = 0; k < 3; k++)
+  {
+    if (ia[k] < 0.0f && ib[k] > 0.0f)
+      coherent = false;
+  }
+}
+
+/*!
+\brief Intersect a box with the rays of the packet.
+\param a,b Lower and upper vertices of the box.
+\param length Maximum distances of the rays, aligned on 32 bytes, with Width entries.
+\return Rays that intersect the box.
+*/
+int RayPacket::Intersect(const float* a, const float* b, const float* length) const
+{
+  int mask = 0;
+#if defined(SIMD_LANES)
+  typedef SimdLanes L;
+  const L::Real zero = L::Zero();
+  const L::Real robust = L::Set(1.0000004f);
+  for (int i = 0; i < count; i += L::Width)
+  {
+    L::Real ta = zero, tb = L::Load(length + i);
+    for (int k = 0; k < 3; k++)
+    {
+      const L::Real c = L::Load(&o[k][i]);
+      const L::Real r = L::Load(&inv[k][i]);
+      const L::Real x = L::Mul(L::Sub(L::Set(a[k]), c), r);
+      const L::Real y = L::Mul(L::Sub(L::Set(b[k]), c), r);
+      ta = L::Max(ta, L::Min(x, y));
+      // Rounding of the distances, after Ize, Robust BVH ray traversal
+      tb = L::Min(tb, L::Mul(L::Max(x, y), robust));
+    }
+    mask |= L::Mask(L::Le(ta, tb)) << i;
+  }
+#else
+  for (int i = 0; i < count; i++)
+  {
+    float ta = 0.0f, tb = length[i];
+    for (int k = 0; k < 3; k++)
+    {
+      float x = (a[k] - o[k][i]) * inv[k][i];
+      float y = (b[k] - o[k][i]) * inv[k][i];
+      if (x > y)
+        std::swap(x, y);
+      ta = std::max(ta, x);
+      tb = std::min(tb, y * 1.0000004f);
+    }
+    if (ta <= tb)
+      mask |= 1 << i;
+  }
+#endif
+  return mask & ((1 << count) - 1);
+}
+
+/*!
+\brief Check if a box is missed by all the rays of the packet, using interval arithmetic.
+
+The test is conservative: it may fail to cull a box missed by all the rays, and always fails if the signs of the directions differ.
+\param a,b Lower and upper vertices of the box.
+\param length Largest maximum distance of the rays.
+*/
+bool RayPacket::Culled(const float* a, const float* b, float length) const
+{
+  if (!coherent)
+    return false;
+  float ta = 0.0f, tb = length;
+  for (int k = 0; k < 3; k++)
+  {
+    // Entry and exit planes are the same for all the rays
+    const float p = (ia[k] > 0.0f) ? a[k] : b[k];
+    const float q = (ia[k] > 0.0f) ? b[k] : a[k];
+
+    // Bounds of the products of the intervals are reached at their bounds
+    const float x0 = p - ob[k], x1 = p - oa[k];
+    const float y0 = q - ob[k], y1 = q - oa[k];
+    ta = std::max(ta, std::min(std::min(x0 * ia[k], x0 * ib[k]), std::min(x1 * ia[k], x1 * ib[k])));
+    tb = std::min(tb, std::max(std::max(y0 * ia[k], y0 * ib[k]), std::max(y1 * ia[k], y1 * ib[k])) * 1.0000004f);
+  }
+  return ta > tb;
+}
+
+/*!
+\brief Return a key ordering boxes along the average direction of the rays, used to visit the nearest boxes first.
+\param a,b Lower and upper vertices of the box.
+*/
+float RayPacket::Order(const float* a, const float* b) const
+{
+  return d[0] * (a[0] + b[0]) + d[1] * (a[1] + b[1]) + d[2] * (a[2] + b[2]);
+}
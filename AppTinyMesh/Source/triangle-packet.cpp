@@ -0,0 +1,254 @@
+#include "triangle-packet.h"
+#include "simd.h"
+
+#include <cmath>
+
+// Products are not fused with additions, see TrianglePacket
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+/*!
+\brief Transform a ray for the watertight intersection test.
+\param ray The ray.
+*/
+TrianglePacketRay::TrianglePacketRay(const Ray& ray)
+{
+  const Vector c = ray.Origin();
+  const Vector d = ray.Direction();
+  for (int i = 0; i < 3; i++)
+    o[i] = float(c[i]);
+
+  // Dominant axis, the winding is preserved by swapping the others if its component is negative
+  kz = 0;
+  if (std::fabs(d[1]) > std::fabs(d[kz]))
+    kz = 1;
+  if (std::fabs(d[2]) > std::fabs(d[kz]))
+    kz = 2;
+  kx = (kz + 1) % 3;
+  ky = (kx + 1) % 3;
+  if (d[kz] < 0.0)
+  {
+    const int k = kx;
+    kx = ky;
+    ky = k;
+  }
+
+  sx = float(d[kx] / d[kz]);
+  sy = float(d[ky] / d[kz]);
+  sz = float(1.0 / d[kz]);
+}
+
+/*!
+\class TrianglePacket triangle-packet.h
+\brief A packet of triangles stored in single precision structure of arrays, intersected with a ray in parallel.
+
+The intersection test is watertight, after Woop et al. <I>Watertight ray/triangle intersection</I>, Journal of Computer
+Graphics Techniques, 2(1):65-82, 2013: the ray is transformed so that its direction is the z axis, and the signed
+areas of the edges seen from the ray are computed in the plane. Edges shared by adjacent triangles give exactly
+opposite areas, so that rays do not leak between triangles, and null areas are evaluated again in double precision.
+Fused multiply-add is not used as it would break the symmetry.
+
+The eight triangles are tested in parallel with the lanes of the build, see SimdLanes, and one at a time otherwise.
+It is used in the leaves of MeshBvh.
+*/
+
+/*!
+\brief Set a triangle of the packet.
+\param i Index, the number of triangles becomes at least i + 1.
+\param a,b,c Vertices.
+*/
+void TrianglePacket::Set(int i, const Vector& a, const Vector& b, const Vector& c)
+{
+  for (int k = 0; k < 3; k++)
+  {
+    p[k][i] = float(a[k]);
+    p[3 + k][i] = float(b[k]);
+    p[6 + k][i] = float(c[k]);
+  }
+  if (i >= count)
+    count = i + 1;
+}
+
+/*!
+\brief Intersect a triangle of the packet, one at a time.
+
+Vertices are always transformed in single precision, as in the parallel test, so that edges evaluated again
+in double precision have the exact sign of the single precision ones when they are not null.
+\param i Triangle.
+\param ray The ray.
+\param length Maximum distance.
+\param t Returned distance.
+\param u,v Returned parametric coordinates.
+\return 1 if the triangle is hit, 0 if not, and -1 if an edge goes through the ray in single precision.
+*/
+template<typename R>
+int TrianglePacket::Intersect(int i, const TrianglePacketRay& ray, R length, R& t, R& u, R& v) const
+{
+  // Vertices relative to the origin, sheared
+  R x[3], y[3], z[3];
+  for (int j = 0; j < 3; j++)
+  {
+    const float c = p[3 * j + ray.kz][i] - ray.o[ray.kz];
+    x[j] = R((p[3 * j + ray.kx][i] - ray.o[ray.kx]) - ray.sx * c);
+    y[j] = R((p[3 * j + ray.ky][i] - ray.o[ray.ky]) - ray.sy * c);
+    z[j] = R(ray.sz * c);
+  }
+
+  // Signed areas of the edges seen from the ray
+  const R e0 = x[2] * y[1] - y[2] * x[1];
+  const R e1 = x[0] * y[2] - y[0] * x[2];
+  const R e2 = x[1] * y[0] - y[1] * x[0];
+  if (sizeof(R) == sizeof(float) && (e0 == R(0) || e1 == R(0) || e2 == R(0)))
+    return -1;
+  if ((e0 < R(0) || e1 < R(0) || e2 < R(0)) && (e0 > R(0) || e1 > R(0) || e2 > R(0)))
+    return 0;
+  const R det = e0 + e1 + e2;
+  if (det == R(0))
+    return 0;
+
+  // Distance, scaled by the determinant
+  const R d = e0 * z[0] + e1 * z[1] + e2 * z[2];
+  if ((det > R(0)) ? (d < R(0) || d > length * det) : (d > R(0) || d < length * det))
+    return 0;
+  t = d / det;
+  u = e1 / det;
+  v = e2 / det;
+  return 1;
+}
+
+/*!
+\brief Intersect the triangles of the packet.
+\param ray The ray.
+\param length Maximum distance.
+\param t,u,v Returned distances and parametric coordinates of the hits.
+\param edges Returned triangles with an edge through the ray, which were not tested.
+\return Triangles that were hit.
+*/
+int TrianglePacket::Hits(const TrianglePacketRay& ray, float length, float* t, float* u, float* v, int& edges) const
+{
+  const int valid = (1 << count) - 1;
+  int hits = 0;
+  edges = 0;
+#if defined(SIMD_LANES)
+  typedef SimdLanes L;
+  const L::Real zero = L::Zero();
+  const L::Real sign = L::Set(-0.0f);
+  const L::Real sx = L::Set(ray.sx), sy = L::Set(ray.sy), sz = L::Set(ray.sz);
+  const L::Real ox = L::Set(ray.o[ray.kx]), oy = L::Set(ray.o[ray.ky]), oz = L::Set(ray.o[ray.kz]);
+  const L::Real tmax = L::Set(length);
+  for (int i = 0; i < Width; i += L::Width)
+  {
+    // Vertices relative to the origin, sheared
+    L::Real x[3], y[3], z[3];
+    for (int j = 0; j < 3; j++)
+    {
+      const L::Real c = L::Sub(L::Load(&p[3 * j + ray.kz][i]), oz);
+      x[j] = L::Sub(L::Sub(L::Load(&p[3 * j + ray.kx][i]), ox), L::Mul(sx, c));
+      y[j] = L::Sub(L::Sub(L::Load(&p[3 * j + ray.ky][i]), oy), L::Mul(sy, c));
+      z[j] = L::Mul(sz, c);
+    }
+
+    // Signed areas of the edges seen from the ray
+    const L::Real e0 = L::Sub(L::Mul(x[2], y[1]), L::Mul(y[2], x[1]));
+    const L::Real e1 = L::Sub(L::Mul(x[0], y[2]), L::Mul(y[0], x[2]));
+    const L::Real e2 = L::Sub(L::Mul(x[1], y[0]), L::Mul(y[1], x[0]));
+    const L::Real negative = L::Or(L::Or(L::Lt(e0, zero), L::Lt(e1, zero)), L::Lt(e2, zero));
+    const L::Real positive = L::Or(L::Or(L::Lt(zero, e0), L::Lt(zero, e1)), L::Lt(zero, e2));
+    const L::Real degenerate = L::Or(L::Or(L::Eq(e0, zero), L::Eq(e1, zero)), L::Eq(e2, zero));
+    const L::Real det = L::Add(L::Add(e0, e1), e2);
+    edges |= L::Mask(degenerate) << i;
+    L::Real hit = L::AndNot(degenerate, L::AndNot(L::And(negative, positive), L::Neq(det, zero)));
+    if (((L::Mask(hit) << i) & valid) == 0)
+      continue;
+
+    // Distance scaled by the determinant, compared with the sign of the determinant removed
+    const L::Real d = L::Add(L::Add(L::Mul(e0, z[0]), L::Mul(e1, z[1])), L::Mul(e2, z[2]));
+    const L::Real s = L::And(det, sign);
+    const L::Real ds = L::Xor(d, s);
+    const L::Real dets = L::Xor(det, s);
+    hit = L::And(hit, L::And(L::Le(zero, ds), L::Le(ds, L::Mul(tmax, dets))));
+    const int mask = L::Mask(hit) << i;
+    if (mask & valid)
+    {
+      const L::Real r = L::Div(L::Set(1.0f), det);
+      L::Store(t + i, L::Mul(d, r));
+      L::Store(u + i, L::Mul(e1, r));
+      L::Store(v + i, L::Mul(e2, r));
+      hits |= mask;
+    }
+  }
+#else
+  for (int i = 0; i < count; i++)
+  {
+    const int hit = Intersect<float>(i, ray, length, t[i], u[i], v[i]);
+    if (hit > 0)
+      hits |= 1 << i;
+    else if (hit < 0)
+      edges |= 1 << i;
+  }
+#endif
+  edges &= valid;
+  return hits & valid;
+}
+
+/*!
+\brief Compute the closest intersection between a ray and the triangles of the packet.
+\param ray The ray.
+\param t Maximum distance, returned distance of the intersection.
+\param u,v Returned parametric coordinates of the intersection.
+\return The intersected triangle, -1 if none.
+*/
+int TrianglePacket::Intersect(const TrianglePacketRay& ray, double& t, double& u, double& v) const
+{
+  float tt[Width], uu[Width], vv[Width];
+  int edges;
+  int hits = Hits(ray, float(t), tt, uu, vv, edges);
+  int triangle = -1;
+  for (int i = 0; hits != 0; i++, hits >>= 1)
+  {
+    if ((hits & 1) && tt[i] <= t)
+    {
+      t = tt[i];
+      u = uu[i];
+      v = vv[i];
+      triangle = i;
+    }
+  }
+  for (int i = 0; edges != 0; i++, edges >>= 1)
+  {
+    double d, a, b;
+    if ((edges & 1) && Intersect<double>(i, ray, t, d, a, b) > 0)
+    {
+      t = d;
+      u = a;
+      v = b;
+      triangle = i;
+    }
+  }
+  return triangle;
+}
+
+/*!
+\brief Check if a ray intersects a triangle of the packet before a given distance.
+\param ray The ray.
+\param length Distance.
+*/
+bool TrianglePacket::Occluded(const TrianglePacketRay& ray, double length) const
+{
+  float tt[Width], uu[Width], vv[Width];
+  int edges;
+  if (Hits(ray, float(length), tt, uu, vv, edges) != 0)
+    return true;
+  for (int i = 0; edges != 0; i++, edges >>= 1)
+  {
+    double d, a, b;
+    if ((edges & 1) && Intersect<double>(i, ray, length, d, a, b) > 0)
+      return true;
+  }
+  return false;
+}
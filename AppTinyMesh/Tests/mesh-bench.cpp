@@ -0,0 +1,437 @@
+// Benchmarks of the geometry processing, run with MeshBench [benchmark] [triangles]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+#include "implicits.h"
+#include "mesh-bvh.h"
+#include "meshcolor.h"
+
+static std::atomic<long long> allocations(0); //!< Number of allocations.
+static std::atomic<long long> allocated(0);   //!< Number of bytes allocated.
+static std::atomic<long long> live(0);        //!< Number of bytes currently allocated.
+static std::atomic<long long> peak(0);        //!< Largest number of bytes allocated at the same time.
+
+/*!
+\brief Allocate memory and count the allocation, the size is stored before the block.
+
+Array and sized variants call this one and the matching deallocation, over-aligned allocations are not counted.
+\param n Size in bytes.
+*/
+void* operator new(size_t n)
+{
+  char* p = (char*)std::malloc(n + 16);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  *(size_t*)p = n;
+  allocations++;
+  allocated += n;
+  const long long current = (live += n);
+  long long highest = peak;
+  while (current > highest && !peak.compare_exchange_weak(highest, current))
+    ;
+  return p + 16;
+}
+
+/*!
+\brief Release memory allocated by the counting operator new.
+\param p The memory.
+*/
+void operator delete(void* p) noexcept
+{
+  if (p == nullptr)
+    return;
+  char* q = (char*)p - 16;
+  live -= *(size_t*)q;
+  std::free(q);
+}
+
+/*!
+\brief Release memory allocated by the counting operator new, the size is the stored one.
+\param p The memory.
+*/
+void operator delete(void* p, size_t) noexcept
+{
+  operator delete(p);
+}
+
+/*!
+\brief Return the time elapsed since an instant, in seconds.
+\param start The instant.
+*/
+static double Seconds(const std::chrono::steady_clock::time_point& start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+\brief A sphere with bumps, whose curvature varies so that simplification and ray casting are not trivial.
+*/
+class BumpyField : public AnalyticScalarField
+{
+public:
+  //! Signed distance like field.
+  double Value(const Vector& p) const override
+  {
+    return Norm(p) - 1.0 - 0.1 * std::sin(8.0 * p[0]) * std::sin(8.0 * p[1]) * std::sin(8.0 * p[2]);
+  }
+};
+
+/*!
+\brief Polygonize the bumpy sphere with about a given number of triangles.
+\param triangles Number of triangles.
+*/
+static Mesh Surface(int triangles)
+{
+  const BumpyField field;
+  const Box box(Vector(-1.2), Vector(1.2));
+  Mesh mesh;
+  field.Polygonize(64, mesh, box);
+  const int n = std::max(8, int(64.0 * std::sqrt(double(triangles) / double(std::max(mesh.Triangles(), 1)))));
+  field.Polygonize(n, mesh, box);
+  return mesh;
+}
+
+/*!
+\brief Distance to the surface of a mesh, its triangles are stored in a grid.
+*/
+class SurfaceDistance
+{
+protected:
+  const Mesh& mesh;       //!< The mesh.
+  Box box;                //!< Box of the grid.
+  double size = 1.0;      //!< Size of the cells.
+  int n[3] = { 1, 1, 1 }; //!< Number of cells along every axis.
+  std::vector<int> start; //!< Triangles of cell c are in item[start[c]...start[c+1]].
+  std::vector<int> item;  //!< Triangles of the cells.
+public:
+  explicit SurfaceDistance(const Mesh&);
+  double operator()(const Vector&) const;
+protected:
+  static Vector Closest(const Vector&, const Vector&, const Vector&, const Vector&);
+  int Index(double, int) const;
+};
+
+/*!
+\brief Store the triangles of a mesh in a grid, whose cells have about as many triangles as a row of the grid.
+\param mesh The mesh, which should not be destroyed before the distance.
+*/
+SurfaceDistance::SurfaceDistance(const Mesh& mesh) :mesh(mesh), box(mesh.GetBox())
+{
+  const Vector d = box.Diagonal();
+  size = Math::Max(Norm(d) / std::sqrt(double(std::max(mesh.Triangles(), 1))), 1e-9);
+  for (int k = 0; k < 3; k++)
+  {
+    n[k] = std::min(128, std::max(1, int(std::ceil(d[k] / size))));
+    size = Math::Max(size, d[k] / n[k]);
+  }
+
+  // Cells overlapped by the boxes of the triangles, grouped with a counting sort
+  start.assign(n[0] * n[1] * n[2] + 1, 0);
+  for (int pass = 0; pass < 2; pass++)
+  {
+    if (pass == 1)
+    {
+      for (int c = 1; c < int(start.size()); c++)
+        start[c] += start[c - 1];
+      item.resize(start.back());
+    }
+    for (int t = mesh.Triangles() - 1; t >= 0; t--)
+    {
+      const Box b = mesh.GetTriangle(t).GetBox();
+      for (int z = Index(b[0][2], 2); z <= Index(b[1][2], 2); z++)
+        for (int y = Index(b[0][1], 1); y <= Index(b[1][1], 1); y++)
+          for (int x = Index(b[0][0], 0); x <= Index(b[1][0], 0); x++)
+          {
+            const int c = (z * n[1] + y) * n[0] + x;
+            if (pass == 0)
+              start[c]++;
+            else
+              item[--start[c]] = t;
+          }
+    }
+  }
+}
+
+/*!
+\brief Return the cell of a coordinate along an axis, clamped to the grid.
+\param x Coordinate.
+\param k Axis.
+*/
+int SurfaceDistance::Index(double x, int k) const
+{
+  return std::min(n[k] - 1, std::max(0, int((x - box[0][k]) / size)));
+}
+
+/*!
+\brief Compute the closest point of a triangle, after Ericson, Real-Time Collision Detection.
+\param p Point.
+\param a,b,c Vertices of the triangle.
+*/
+Vector SurfaceDistance::Closest(const Vector& p, const Vector& a, const Vector& b, const Vector& c)
+{
+  const Vector ab = b - a, ac = c - a, ap = p - a;
+  const double d1 = ab * ap, d2 = ac * ap;
+  if (d1 <= 0.0 && d2 <= 0.0)
+    return a;
+  const Vector bp = p - b;
+  const double d3 = ab * bp, d4 = ac * bp;
+  if (d3 >= 0.0 && d4 <= d3)
+    return b;
+  const double vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    return a + (d1 / (d1 - d3)) * ab;
+  const Vector cp = p - c;
+  const double d5 = ab * cp, d6 = ac * cp;
+  if (d6 >= 0.0 && d5 <= d6)
+    return c;
+  const double vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    return a + (d2 / (d2 - d6)) * ac;
+  const double va = d3 * d6 - d5 * d4;
+  if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+    return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+  const double w = 1.0 / (va + vb + vc);
+  return a + (vb * w) * ab + (vc * w) * ac;
+}
+
+/*!
+\brief Compute the distance of a point to the surface, cells are visited by shells of increasing size.
+\param p Point.
+*/
+double SurfaceDistance::operator()(const Vector& p) const
+{
+  const int c[3] = { Index(p[0], 0), Index(p[1], 1), Index(p[2], 2) };
+  const int m = std::max(n[0], std::max(n[1], n[2]));
+  double best = INFINITY;
+  for (int r = 0; r < m; r++)
+  {
+    for (int z = std::max(0, c[2] - r); z <= std::min(n[2] - 1, c[2] + r); z++)
+      for (int y = std::max(0, c[1] - r); y <= std::min(n[1] - 1, c[1] + r); y++)
+      {
+        // Only the cells of the shell, the inner cells were visited before
+        const bool inner = std::abs(z - c[2]) < r && std::abs(y - c[1]) < r;
+        for (int x = std::max(0, c[0] - r); x <= std::min(n[0] - 1, c[0] + r); x += (inner && x == c[0] - r) ? 2 * r : 1)
+        {
+          if (inner && std::abs(x - c[0]) < r)
+            continue;
+          const int g = (z * n[1] + y) * n[0] + x;
+          for (int i = start[g]; i < start[g + 1]; i++)
+          {
+            const Triangle t = mesh.GetTriangle(item[i]);
+            best = std::min(best, SquaredNorm(p - Closest(p, t[0], t[1], t[2])));
+          }
+        }
+      }
+    // Cells beyond the shell are farther than r cells
+    if (best <= (r * size) * (r * size))
+      break;
+  }
+  return std::sqrt(best);
+}
+
+/*!
+\brief Compute the largest distance of the samples of a mesh to another mesh.
+
+Samples are the vertices, the midpoints of the edges and the centers of the triangles.
+\param a Sampled mesh.
+\param b The other mesh.
+*/
+static double Deviation(const Mesh& a, const Mesh& b)
+{
+  const SurfaceDistance distance(b);
+  const int nt = a.Triangles();
+  std::vector<double> d(nt, 0.0);
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int i = 0; i < nt; i++)
+  {
+    const Triangle t = a.GetTriangle(i);
+    for (const Vector& p : { t[0], t[1], t[2], 0.5 * (t[0] + t[1]), 0.5 * (t[1] + t[2]), 0.5 * (t[2] + t[0]), t.Center() })
+      d[i] = Math::Max(d[i], distance(p));
+  }
+  double h = 0.0;
+  for (int i = 0; i < nt; i++)
+    h = Math::Max(h, d[i]);
+  return h;
+}
+
+/*!
+\brief Compute the sampled two-sided Hausdorff distance between two meshes.
+\param a,b Meshes.
+*/
+static double Hausdorff(const Mesh& a, const Mesh& b)
+{
+  return Math::Max(Deviation(a, b), Deviation(b, a));
+}
+
+/*!
+\brief Simplify a mesh to a tenth and a hundredth of its triangles, reports the time and the Hausdorff distance to the mesh.
+\param triangles Number of triangles of the mesh.
+*/
+static void BenchSimplify(int triangles)
+{
+  const Mesh mesh = Surface(triangles);
+  const double diagonal = Norm(mesh.GetBox().Diagonal());
+  for (int ratio : { 10, 100 })
+  {
+    Mesh simplified = mesh;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double error = 0.0;
+    simplified.Simplify(mesh.Triangles() / ratio, -1.0, &error);
+    const double time = Seconds(start);
+    const double hausdorff = Hausdorff(mesh, simplified);
+    std::printf("simplify %d to %d triangles: %.3f s, quadric error %g, Hausdorff distance %g, %.3f%% of the diagonal\n",
+      mesh.Triangles(), simplified.Triangles(), time, error, hausdorff, 100.0 * hausdorff / diagonal);
+  }
+}
+
+/*!
+\brief Trace rays through a hierarchy as single rays, occlusion rays and a stream of packets, reports the number of millions of rays per second.
+\param bvh The hierarchy.
+\param rays Rays.
+\param name Name of the rays.
+*/
+static void Trace(const MeshBvh& bvh, const std::vector<Ray>& rays, const char* name)
+{
+  const int n = int(rays.size());
+  std::vector<int> hit(n);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (int i = 0; i < n; i++)
+  {
+    double t, u, v;
+    int triangle;
+    hit[i] = bvh.Intersect(rays[i], t, triangle, u, v) ? 1 : 0;
+  }
+  const double single = Seconds(start);
+  int hits = 0;
+  for (int i = 0; i < n; i++)
+    hits += hit[i];
+
+  start = std::chrono::steady_clock::now();
+#pragma omp parallel for schedule(dynamic, 1024)
+  for (int i = 0; i < n; i++)
+    hit[i] = bvh.Occluded(rays[i], 10.0) ? 1 : 0;
+  const double occluded = Seconds(start);
+
+  std::vector<MeshHit> packets;
+  start = std::chrono::steady_clock::now();
+  bvh.Intersect(rays, packets);
+  const double stream = Seconds(start);
+
+  std::printf("%d %s rays, %d hits: single %.2f Mrays/s, occlusion %.2f Mrays/s, stream of packets %.2f Mrays/s\n",
+    n, name, hits, 1e-6 * n / single, 1e-6 * n / occluded, 1e-6 * n / stream);
+}
+
+/*!
+\brief Build the hierarchy of a mesh and trace coherent camera rays and incoherent random rays, reports the build time and the number of rays per second.
+\param triangles Number of triangles of the mesh.
+*/
+static void BenchBvh(int triangles)
+{
+  const Mesh mesh = Surface(triangles);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const MeshBvh bvh(mesh);
+  std::printf("hierarchy of %d triangles: %.3f s, %d nodes\n", mesh.Triangles(), Seconds(start), bvh.Nodes());
+
+  // Rays through the pixels of a camera looking at the mesh
+  const int w = 1024;
+  std::vector<Ray> rays(w * w);
+  const Vector eye(0.5, 0.8, 3.0);
+  const Vector view = Normalized(-eye);
+  const Vector right = Normalized(view / Vector(0.0, 1.0, 0.0));
+  const Vector up = right / view;
+  for (int y = 0; y < w; y++)
+  {
+    for (int x = 0; x < w; x++)
+      rays[y * w + x] = Ray(eye, Normalized(view + 0.8 * ((x + 0.5) / w - 0.5) * right + 0.8 * ((y + 0.5) / w - 0.5) * up));
+  }
+  Trace(bvh, rays, "camera");
+
+  // Rays from random points around the mesh toward random points inside it
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  for (Ray& ray : rays)
+  {
+    const Vector o = 3.0 * Vector(uniform(random), uniform(random), uniform(random));
+    const Vector p = Vector(uniform(random), uniform(random), uniform(random));
+    ray = Ray(o, Normalized(p - o));
+  }
+  Trace(bvh, rays, "random");
+}
+
+/*!
+\brief Run a stage of a pipeline, reports its number of allocations, the number of bytes allocated and the peak memory above the memory before the stage.
+\param name Name of the stage.
+\param stage The stage.
+*/
+template<typename Stage>
+static void Allocations(const char* name, Stage stage)
+{
+  const long long count = allocations, bytes = allocated, before = live;
+  peak = before;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  stage();
+  std::printf("%s: %.3f s, %lld allocations, %.1f MB allocated, peak %.1f MB\n",
+    name, Seconds(start), allocations - count, 1e-6 * double(allocated - bytes), 1e-6 * double(peak - before));
+}
+
+/*!
+\brief Count the allocations of a pipeline, polygonization, colors and accessors, and compare copies with moves.
+\param triangles Number of triangles of the mesh.
+*/
+static void BenchAllocations(int triangles)
+{
+  Mesh mesh;
+  Allocations("polygonize", [&]() { mesh = Surface(triangles); });
+  std::printf("mesh of %d triangles and %d vertices, %.1f MB of arrays\n", mesh.Triangles(), mesh.Vertexes(),
+    1e-6 * double(mesh.Vertexes() * 2 * sizeof(Vector) + mesh.VertexIndexes().size() * sizeof(int)));
+
+  MeshColor colored;
+  Allocations("colored mesh from a copy", [&]() { colored = MeshColor(mesh); });
+  Allocations("colored mesh from a move", [&]() { colored = MeshColor(std::move(mesh)); });
+
+  size_t size = 0;
+  Allocations("accessors, 1000 calls", [&]()
+    {
+      for (int i = 0; i < 1000; i++)
+        size += colored.VertexIndexes().size() + colored.NormalIndexes().size() + colored.GetColors().size() + colored.ColorIndexes().size();
+    });
+  Allocations("copy of the colored mesh", [&]() { MeshColor copy(colored); size += copy.GetColors().size(); });
+  Allocations("move of the colored mesh", [&]() { MeshColor moved(std::move(colored)); size += moved.GetColors().size(); });
+  if (size == 0)
+    std::printf("empty mesh\n");
+}
+
+int main(int argc, char** argv)
+{
+  const char* name = (argc > 1) ? argv[1] : "all";
+  const int triangles = (argc > 2) ? std::atoi(argv[2]) : 1000000;
+  const struct { const char* name; void (*run)(int); } benchmarks[] = {
+    { "simplify", BenchSimplify },
+    { "bvh", BenchBvh },
+    { "allocations", BenchAllocations },
+  };
+  bool found = false;
+  for (const auto& benchmark : benchmarks)
+  {
+    if (std::strcmp(name, "all") == 0 || std::strcmp(name, benchmark.name) == 0)
+    {
+      benchmark.run(triangles);
+      found = true;
+    }
+  }
+  if (!found)
+  {
+    std::fprintf(stderr, "usage: MeshBench [all|simplify|bvh|allocations] [triangles]\n");
+    return 1;
+  }
+  return 0;
+}
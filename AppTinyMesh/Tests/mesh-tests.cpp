@@ -0,0 +1,639 @@
+// Regression checks of the geometry processing, run with ctest
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <utility>
+
+#include "meshcolor.h"
+#include "mesh-lod.h"
+#include "mesh-bvh.h"
+#include "mesh-cache.h"
+#include "mesh-codec.h"
+#include "mesh-gltf.h"
+#include "implicits-animation.h"
+#include "implicits-shard.h"
+#include "implicits-lod.h"
+
+static int failures = 0; //!< Number of failed checks.
+
+/*!
+\brief Report a check.
+\param ok Result.
+\param name Description of the check.
+*/
+static void Check(bool ok, const char* name)
+{
+  std::printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+  if (!ok)
+    failures++;
+}
+
+/*!
+\brief Simplify the UV sphere, whose seam and poles are made of coincident vertices, the surface should not fold.
+*/
+static void SimplifySeams()
+{
+  const int cases[3][2] = { { 200, 1000 }, { 50, 400 }, { 50, 100 } };
+  for (const int* c : cases)
+  {
+    Mesh mesh(Sphere(Vector(0.0), 1.0), c[0]);
+    double error;
+    const int triangles = mesh.Simplify(c[1], -1.0, &error);
+    double deviation = 0.0;
+    for (int i = 0; i < mesh.Vertexes(); i++)
+      deviation = std::fmax(deviation, std::fabs(Norm(mesh.Vertex(i)) - 1.0));
+    int flipped = 0;
+    for (int i = 0; i < mesh.Triangles(); i++)
+    {
+      const Triangle t = mesh.GetTriangle(i);
+      if (t.AreaNormal() * t.Center() <= 0.0)
+        flipped++;
+    }
+
+    char name[128];
+    std::snprintf(name, sizeof(name), "sphere %d simplified to %d triangles: %d, error %g, deviation %g, flipped %d", c[0], c[1], triangles, error, deviation, flipped);
+    Check(triangles == c[1] && error < 0.05 && deviation < 0.05 && flipped == 0, name);
+  }
+}
+
+/*!
+\brief Generate levels of detail, levels should be coarser and coarser and stay close to the mesh.
+*/
+static void LevelsOfDetail()
+{
+  const Mesh meshes[2] = { Mesh(Sphere(Vector(0.0), 1.0), 200), Mesh(Cylinder(Vector(0.0), Vector(0.0, 0.0, 1.0), 0.5), 256) };
+  for (const Mesh& mesh : meshes)
+  {
+    const MeshLod lod(mesh);
+    const double limit = MeshLod::Tolerance * Norm(mesh.GetBox().Diagonal());
+    bool ok = true;
+    for (int i = 0; i < lod.Levels(); i++)
+    {
+      const int previous = (i > 0) ? lod.Level(i - 1).Triangles() : mesh.Triangles();
+      ok = ok && lod.Level(i).Triangles() < previous && lod.Error(i) <= limit && (i == 0 || lod.Error(i) >= lod.Error(i - 1));
+    }
+
+    char name[128];
+    std::snprintf(name, sizeof(name), "levels of detail of a mesh of %d triangles: %d levels", mesh.Triangles(), lod.Levels());
+    Check(ok, name);
+  }
+}
+
+/*!
+\brief Cluster the vertices of meshes, output triangles should have valid and distinct vertices, and should not be duplicated.
+*/
+static void ClusterTriangles()
+{
+  const Mesh meshes[2] = { Mesh(Sphere(Vector(0.0), 1.0), 64), Mesh(Torus(Vector(0.0), Vector(0.0, 0.0, 1.0), 1.0, 0.25), 48, 24) };
+  for (const Mesh& original : meshes)
+  {
+    for (double size : { 0.05, 0.2, 0.5 })
+    {
+      Mesh mesh = original;
+      const int triangles = mesh.Cluster(size);
+      int invalid = 0, degenerate = 0;
+      std::vector<std::array<int, 3>> keys;
+      for (int t = 0; t < mesh.Triangles(); t++)
+      {
+        std::array<int, 3> key = { mesh.VertexIndex(t, 0), mesh.VertexIndex(t, 1), mesh.VertexIndex(t, 2) };
+        for (int j = 0; j < 3; j++)
+        {
+          if (key[j] < 0 || key[j] >= mesh.Vertexes())
+            invalid++;
+        }
+        if (key[0] == key[1] || key[1] == key[2] || key[2] == key[0])
+          degenerate++;
+
+        // Same triangle with the same orientation, whatever its first vertex
+        std::rotate(key.begin(), std::min_element(key.begin(), key.end()), key.end());
+        keys.push_back(key);
+      }
+      std::sort(keys.begin(), keys.end());
+      const int duplicate = int(keys.end() - std::unique(keys.begin(), keys.end()));
+
+      char name[160];
+      std::snprintf(name, sizeof(name), "clustering of a mesh of %d triangles with cells of size %g: %d triangles, %d invalid indexes, %d degenerate, %d duplicate",
+        original.Triangles(), size, triangles, invalid, degenerate, duplicate);
+      Check(triangles == mesh.Triangles() && triangles > 0 && triangles < original.Triangles() && invalid == 0 && degenerate == 0 && duplicate == 0
+        && int(mesh.NormalIndexes().size()) == 3 * triangles, name);
+    }
+  }
+}
+
+/*!
+\brief Compute the closest intersection of a ray with a mesh by testing all the triangles.
+\param mesh The mesh.
+\param ray The ray.
+\param t Returned intersection depth.
+\return The intersected triangle, -1 if the ray misses the mesh.
+*/
+static int BruteIntersect(const Mesh& mesh, const Ray& ray, double& t)
+{
+  int triangle = -1;
+  t = INFINITY;
+  for (int i = 0; i < mesh.Triangles(); i++)
+  {
+    double d, u, v;
+    if (mesh.GetTriangle(i).Intersect(ray, d, u, v) && d > 0.0 && d < t)
+    {
+      t = d;
+      triangle = i;
+    }
+  }
+  return triangle;
+}
+
+/*!
+\brief Check if two intersections are the same, up to the precision of the single precision kernels.
+
+Triangles may differ for rays through a shared edge, the depths should then be the same.
+\param a,b Triangles.
+\param ta,tb Depths.
+*/
+static bool SameHit(int a, int b, double ta, double tb)
+{
+  return (a < 0 && b < 0) || (a >= 0 && b >= 0 && std::fabs(ta - tb) <= 1e-4 * std::fmax(1.0, tb));
+}
+
+/*!
+\brief Cast random rays at meshes, the closest hits and the occlusion of single rays, packets and streams should match a loop over all the triangles.
+*/
+static void RayQueries()
+{
+  const Mesh meshes[2] = { Mesh(Sphere(Vector(0.0), 1.0), 40), Mesh(Torus(Vector(0.0), Normalized(Vector(1.0, 0.2, 0.5)), 1.0, 0.3), 48, 24) };
+  std::mt19937 random(1);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  auto point = [&](double r) { return r * Vector(uniform(random), uniform(random), uniform(random)); };
+  for (const Mesh& mesh : meshes)
+  {
+    // Rays from around the mesh toward points inside its sphere, in groups of coherent rays from the same origin
+    const int n = 4000;
+    std::vector<Ray> rays(n);
+    for (int i = 0; i < n; i += RayPacket::Width)
+    {
+      const Vector o = point(3.0);
+      const Vector target = point(1.2);
+      for (int j = i; j < i + RayPacket::Width; j++)
+        rays[j] = Ray(o, Normalized(target + point(0.1) - o));
+    }
+
+    std::vector<int> expected(n);
+    std::vector<double> depth(n);
+    for (int i = 0; i < n; i++)
+      expected[i] = BruteIntersect(mesh, rays[i], depth[i]);
+
+    int single = 0, occluded = 0, packet = 0, stream = 0, hits = 0;
+    std::vector<MeshHit> streamed;
+    mesh.Intersect(rays, streamed);
+    for (int i = 0; i < n; i += RayPacket::Width)
+    {
+      MeshHit packed[RayPacket::Width];
+      mesh.Bvh().Intersect(rays.data() + i, RayPacket::Width, packed);
+      for (int j = i; j < i + RayPacket::Width; j++)
+      {
+        double t = 0.0, u, v;
+        int triangle = -1;
+        if (!mesh.Intersect(rays[j], t, triangle, u, v))
+          triangle = -1;
+        single += !SameHit(triangle, expected[j], t, depth[j]);
+        packet += !SameHit(packed[j - i].triangle, expected[j], packed[j - i].t, depth[j]);
+        stream += !SameHit(streamed[j].triangle, expected[j], streamed[j].t, depth[j]);
+        hits += expected[j] >= 0;
+
+        // Occlusion before and after the hit
+        if (expected[j] >= 0)
+          occluded += mesh.Occluded(rays[j], 0.99 * depth[j]) || !mesh.Occluded(rays[j], 1.01 * depth[j]);
+        else
+          occluded += mesh.Occluded(rays[j], 10.0);
+      }
+    }
+
+    char name[192];
+    std::snprintf(name, sizeof(name), "rays cast at a mesh of %d triangles: %d hits out of %d, mismatches single %d, occluded %d, packets %d, stream %d",
+      mesh.Triangles(), hits, n, single, occluded, packet, stream);
+    Check(hits > n / 4 && hits < n && single == 0 && occluded == 0 && packet == 0 && stream == 0, name);
+  }
+}
+
+/*!
+\brief Color a mesh, red on the positive side of the x axis and blue on the other.
+\param mesh The mesh.
+\param corners Store color indexes equal to the vertex indexes, instead of sharing them.
+*/
+static MeshColor Halves(const Mesh& mesh, bool corners)
+{
+  std::vector<Color> colors(mesh.Vertexes());
+  for (int i = 0; i < mesh.Vertexes(); i++)
+    colors[i] = (mesh.Vertex(i)[0] > 0.0) ? Color(1.0, 0.0, 0.0) : Color(0.0, 0.0, 1.0);
+  return MeshColor(mesh, colors, corners ? mesh.VertexIndexes() : std::vector<int>());
+}
+
+/*!
+\brief Count the corners whose color is not the one of their side of the x axis.
+\param mesh The mesh.
+\param margin Corners closer to the plane x=0 are skipped, as their colors may be blended.
+*/
+static int Miscolored(const MeshColor& mesh, double margin)
+{
+  const std::vector<int>& vertexes = mesh.VertexIndexes();
+  const std::vector<int>& colors = mesh.ColorIndexes();
+  int wrong = 0;
+  for (int c = 0; c < int(vertexes.size()); c++)
+  {
+    const double x = mesh.Vertex(vertexes[c])[0];
+    if (colors[c] < 0 || colors[c] >= int(mesh.GetColors().size()))
+      wrong++;
+    else if (std::fabs(x) > margin && (mesh.GetColor(colors[c])[0] > 0.5) != (x > 0.0))
+      wrong++;
+  }
+  return wrong;
+}
+
+/*!
+\brief Reorder a colored sphere, colors should follow their vertices, whether they share the vertex indexes or not.
+*/
+static void ColorsFollowVertices()
+{
+  typedef void (*Operation)(MeshColor&);
+  const std::pair<const char*, Operation> operations[] = {
+    { "Morton order", [](MeshColor& m) { m.SortMorton(); } },
+    { "vertex cache optimization", [](MeshColor& m) { m.OptimizeCache(true); } },
+    { "simplification", [](MeshColor& m) { m.Simplify(m.Triangles() / 10); } },
+    { "vertex clustering", [](MeshColor& m) { m.Cluster(0.1); } },
+  };
+  const Mesh sphere(Sphere(Vector(0.0), 1.0), 64);
+  for (const std::pair<const char*, Operation>& operation : operations)
+  {
+    for (bool corners : { false, true })
+    {
+      MeshColor mesh = Halves(sphere, corners);
+      operation.second(mesh);
+      const int wrong = Miscolored(mesh, 0.25);
+
+      char name[128];
+      std::snprintf(name, sizeof(name), "colors of a sphere after %s, %s indexes: %d wrong corners", operation.first, corners ? "color" : "shared", wrong);
+      Check(wrong == 0 && mesh.Triangles() > 0, name);
+    }
+  }
+}
+
+/*!
+\brief Compute the largest distance between the corners of the triangles of two meshes.
+\param a,b The meshes.
+\param normals Compare the normals of the corners instead of their vertices.
+\return The distance, infinite if the meshes do not have the same number of triangles.
+*/
+static double Deviation(const Mesh& a, const Mesh& b, bool normals)
+{
+  if (a.Triangles() != b.Triangles())
+    return INFINITY;
+  double e = 0.0;
+  for (int t = 0; t < a.Triangles(); t++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      const Vector d = normals ? a.Normal(a.NormalIndex(t, j)) - b.Normal(b.NormalIndex(t, j)) : a.Vertex(t, j) - b.Vertex(t, j);
+      e = std::fmax(e, Norm(d));
+    }
+  }
+  return e;
+}
+
+/*!
+\brief Write a text file.
+\param url File name.
+\param text Contents.
+*/
+static bool WriteText(const char* url, const char* text)
+{
+  FILE* f = std::fopen(url, "wb");
+  if (f == nullptr)
+    return false;
+  const bool ok = std::fputs(text, f) >= 0;
+  return std::fclose(f) == 0 && ok;
+}
+
+/*!
+\brief Load handcrafted .obj and .stl files, with negative indexes, polygons, comments and corners to weld.
+*/
+static void HandcraftedFiles()
+{
+  const char* obj = "mesh-tests.obj";
+  WriteText(obj,
+    "v 0 0 0\n"
+    "v 1 0 0\n"
+    "v 1 1 0\n"
+    "v 0 1 0\n"
+    "vn 0 0 1\n"
+    "f -4//-1 -3//-1 -2//-1 -1//-1\n"
+    "f 1/1 2/2 3/3 # comment 4\n"
+    "f 1 2 5\n"
+    "vt 0 0\n");
+  Mesh mesh;
+  ObjReport report;
+  const bool loaded = mesh.LoadObj(obj, &report);
+  const std::vector<int> triangles = { 0, 1, 2, 0, 2, 3, 0, 1, 2 };
+
+  char name[192];
+  std::snprintf(name, sizeof(name), ".obj file with negative indexes, a polygon and a comment: %d triangles, %d polygons, %d dropped, %d ignored lines",
+    mesh.Triangles(), report.polygons, report.triangles, report.ignored);
+  Check(loaded && mesh.VertexIndexes() == triangles && report.polygons == 1 && report.triangles == 1 && report.ignored == 1 && report.lines == 0
+    && Norm(mesh.Normal(mesh.NormalIndex(0, 0)) - Vector(0.0, 0.0, 1.0)) < 1e-12, name);
+  std::remove(obj);
+
+  // Two triangles whose shared edge is perturbed in the second one
+  const char* stl = "mesh-tests.stl";
+  WriteText(stl,
+    "solid square\n"
+    "facet normal 0 0 1\nouter loop\nvertex 0 0 0\nvertex 1 0 0\nvertex 1 0.25 0\nendloop\nendfacet\n"
+    "facet normal 0 0 1\nouter loop\nvertex 0.0000001 0 0\nvertex 1 0.2500001 0\nvertex 0 0.25 0\nendloop\nendfacet\n"
+    "endsolid square\n");
+  for (double epsilon : { 0.0, 0.001 })
+  {
+    const bool ok = mesh.LoadStl(stl, epsilon);
+    const int vertexes = (epsilon == 0.0) ? 6 : 4;
+    std::snprintf(name, sizeof(name), ".stl file welded with tolerance %g: %d vertices, %d triangles", epsilon, mesh.Vertexes(), mesh.Triangles());
+    Check(ok && mesh.Vertexes() == vertexes && mesh.Triangles() == 2, name);
+  }
+  std::remove(stl);
+}
+
+/*!
+\brief Save meshes in every format and load them back, they should be the same within the precision of the format.
+*/
+static void RoundTrips()
+{
+  const Mesh sphere(Sphere(Vector(0.0), 1.0), 64);
+  const Mesh torus(Torus(Vector(0.0), Vector(0.0, 0.0, 1.0), 1.0, 0.25), 48, 24);
+  char name[192];
+
+  // Text and native files are exact
+  Mesh mesh;
+  const char* obj = "mesh-tests.obj";
+  bool ok = sphere.SaveObj(obj) && mesh.LoadObj(obj);
+  Check(ok && Deviation(sphere, mesh, false) == 0.0 && Deviation(sphere, mesh, true) == 0.0 && mesh.Vertexes() == sphere.Vertexes(), ".obj round trip");
+  std::remove(obj);
+
+  const char* cache = "mesh-tests.tmc";
+  MeshCache file;
+  ok = MeshCache::Save(cache, sphere) && file.Open(cache) && file.Validate();
+  mesh = file.GetMesh();
+  Check(ok && file.Vertexes() == sphere.Vertexes() && Deviation(sphere, mesh, false) == 0.0 && Deviation(sphere, mesh, true) == 0.0, "cache round trip");
+  file.Close();
+
+  // A corrupted array fails the checksum, a corrupted header fails opening
+  const int offsets[2] = { 256, 12 };
+  for (int offset : offsets)
+  {
+    FILE* f = std::fopen(cache, "r+b");
+    ok = f != nullptr && std::fseek(f, offset, SEEK_SET) == 0;
+    const int c = ok ? std::fgetc(f) : EOF;
+    ok = ok && c != EOF && std::fseek(f, offset, SEEK_SET) == 0 && std::fputc(c ^ 0x10, f) != EOF;
+    if (f != nullptr)
+      std::fclose(f);
+    const bool opened = file.Open(cache);
+    const bool valid = opened && file.Validate();
+    file.Close();
+
+    std::snprintf(name, sizeof(name), "cache with a corrupted byte at offset %d: %s", offset, opened ? "opened" : "rejected");
+    Check(ok && !valid && (offset != 12 || !opened), name);
+  }
+  std::remove(cache);
+
+  // Floats
+  const Mesh meshes[2] = { sphere, torus };
+  for (const Mesh& original : meshes)
+  {
+    for (bool binary : { false, true })
+    {
+      const char* ply = "mesh-tests.ply";
+      ok = original.SavePly(ply, binary) && mesh.LoadPly(ply);
+      const double e = Deviation(original, mesh, false), n = Deviation(original, mesh, true);
+      std::snprintf(name, sizeof(name), "%s .ply round trip of a mesh of %d triangles: deviation %g, normals %g", binary ? "binary" : "ASCII", original.Triangles(), e, n);
+      Check(ok && e < 1e-6 && n < 1e-6, name);
+      std::remove(ply);
+    }
+
+    // Welded corners should give back the vertices of the torus, the sphere has coincident vertices on its seam and poles
+    const char* stl = "mesh-tests.stl";
+    ok = original.SaveStl(stl) && mesh.LoadStl(stl);
+    const double e = Deviation(original, mesh, false);
+    std::snprintf(name, sizeof(name), ".stl round trip of a mesh of %d vertices: %d vertices, deviation %g", original.Vertexes(), mesh.Vertexes(), e);
+    Check(ok && e < 1e-6 && mesh.Vertexes() <= original.Vertexes() && (&original == &meshes[0] || mesh.Vertexes() == original.Vertexes()), name);
+    std::remove(stl);
+
+    // Quantized vertices are rounded to the closest step of the bounding box
+    for (int bits : { 8, 16, 24 })
+    {
+      const char* tmz = "mesh-tests.tmz";
+      MeshCodec codec(bits);
+      ok = codec.Save(tmz, original) && codec.Load(tmz, mesh);
+      const double bound = Norm(original.GetBox().Diagonal()) / (2.0 * double((1u << bits) - 1));
+      const double e = Deviation(original, mesh, false), n = Deviation(original, mesh, true);
+      std::snprintf(name, sizeof(name), "%d bit compression of a mesh of %d triangles: deviation %g, bound %g, normals %g", bits, original.Triangles(), e, bound, n);
+      Check(ok && e <= bound * (1.0 + 1e-9) && n < 1e-3, name);
+      std::remove(tmz);
+    }
+  }
+
+  // Several meshes in a binary glTF file, meshes without colors are loaded white
+  const char* glb = "mesh-tests.glb";
+  const MeshColor colored = Halves(torus, false);
+  MeshGltf scene;
+  scene.Add(sphere, "sphere");
+  scene.Add(colored, "torus");
+  std::vector<MeshColor> loaded;
+  std::vector<std::string> names;
+  ok = scene.Save(glb) && MeshGltf::Load(glb, loaded, &names) && loaded.size() == 2 && names.size() == 2;
+  double e = INFINITY, n = INFINITY;
+  int wrong = -1;
+  if (ok)
+  {
+    e = std::fmax(Deviation(sphere, loaded[0], false), Deviation(torus, loaded[1], false));
+    n = std::fmax(Deviation(sphere, loaded[0], true), Deviation(torus, loaded[1], true));
+    wrong = Miscolored(loaded[1], 0.0);
+    ok = names[0] == "sphere" && names[1] == "torus" && loaded[0].Uniform() && loaded[0].GetColor(0)[0] == 1.0;
+  }
+  std::snprintf(name, sizeof(name), ".glb round trip of two meshes: deviation %g, normals %g, %d wrong colors", e, n, wrong);
+  Check(ok && e < 1e-6 && n < 1e-6 && wrong == 0, name);
+  std::remove(glb);
+}
+
+/*!
+\brief Check that two meshes have the same triangles with the same orientation, whatever the order of their triangles and vertices.
+\param a,b The meshes.
+\param tolerance Largest distance between matching vertices.
+*/
+static bool SameTriangles(const Mesh& a, const Mesh& b, double tolerance)
+{
+  if (a.Triangles() != b.Triangles())
+    return false;
+
+  // Triangles of the second mesh sorted by the abscissa of their center
+  std::vector<std::pair<double, int>> centers(b.Triangles());
+  for (int t = 0; t < b.Triangles(); t++)
+    centers[t] = { b.GetTriangle(t).Center()[0], t };
+  std::sort(centers.begin(), centers.end());
+
+  std::vector<bool> used(b.Triangles(), false);
+  for (int t = 0; t < a.Triangles(); t++)
+  {
+    const double x = a.GetTriangle(t).Center()[0];
+    bool found = false;
+    for (auto it = std::lower_bound(centers.begin(), centers.end(), std::make_pair(x - tolerance, -1)); it != centers.end() && it->first <= x + tolerance && !found; it++)
+    {
+      const int u = it->second;
+      for (int r = 0; r < 3 && !found && !used[u]; r++)
+      {
+        found = true;
+        for (int j = 0; j < 3; j++)
+          found = found && Norm(a.Vertex(t, j) - b.Vertex(u, (j + r) % 3)) <= tolerance;
+        if (found)
+          used[u] = true;
+      }
+    }
+    if (!found)
+      return false;
+  }
+  return true;
+}
+
+/*!
+\brief Track an animated surface, every frame should be the surface polygonized over the whole grid at the same time.
+*/
+static void AnimationFrames()
+{
+  AnimatedScalarField field;
+  const Box box(2.0);
+  const int n = 32;
+  AnimationPolygonizer animation(field, box, n);
+  int wrong = 0;
+  for (int i = 0; i < 20; i++)
+  {
+    const double t = i * 0.1;
+    Mesh mesh, reference;
+    animation.Polygonize(t, mesh);
+    field.SetTime(t);
+    field.Polygonize(n + 1, reference, box);
+    if (mesh.Triangles() == 0 || !SameTriangles(mesh, reference, 1e-9))
+      wrong++;
+  }
+
+  char name[128];
+  std::snprintf(name, sizeof(name), "animation of a surface on a grid of %d cells: %d frames out of 20 differ from the whole grid", n, wrong);
+  Check(wrong == 0, name);
+}
+
+/*!
+\brief Polygonize a surface in shards processed by worker processes, merged shards should be the surface polygonized in one pass.
+
+Workers are forked before any parallel region, so this test runs first.
+*/
+static void ShardedSurfaces()
+{
+  const AnalyticScalarField field;
+  const Box box(2.0);
+  const int n = 37;
+  ShardedPolygonizer one(field, box, n, 1), three(field, box, n, 3), four(field, box, n, 4);
+  ShardedPolygonizer* polygonizers[3] = { &one, &three, &four };
+  for (ShardedPolygonizer* sharded : polygonizers)
+    sharded->Spawn();
+
+  Mesh reference;
+  field.Polygonize(n + 1, reference, box);
+  for (ShardedPolygonizer* sharded : polygonizers)
+  {
+    Mesh mesh;
+    const bool ok = sharded->Polygonize(mesh, "mesh-tests");
+
+    char name[128];
+    std::snprintf(name, sizeof(name), "surface polygonized in %d shards by %d workers: %d triangles, %d in one pass", sharded->Shards(), sharded->Workers(), mesh.Triangles(), reference.Triangles());
+    Check(ok && sharded->Workers() == sharded->Shards() && mesh.Triangles() > 0 && SameTriangles(mesh, reference, 1e-9), name);
+  }
+}
+
+/*!
+\brief Polygonize a surface in chunks of mixed resolutions, the chunks welded by vertex positions should form a closed manifold surface.
+*/
+static void WatertightChunks()
+{
+  const AnalyticScalarField field;
+  const Box box(2.1);
+  for (int setup = 0; setup < 2; setup++)
+  {
+    ChunkedPolygonizer chunks(field, box, 4, 4, 4, 16, 3);
+    if (setup == 0)
+    {
+      chunks.SetLevels(Vector(1.5, 0.3, 0.2), 0.8);
+    }
+    else
+    {
+      // Coarse chunks refined around two corners of the grid
+      for (int c = 0; c < chunks.Chunks(); c++)
+        chunks.SetLevel(c % 4, (c / 4) % 4, c / 16, 2);
+      chunks.SetLevel(0, 0, 0, 0);
+      chunks.SetLevel(3, 2, 1, 0);
+      chunks.Balance();
+    }
+    int mixed = 0;
+    for (int c = 0; c < chunks.Chunks(); c++)
+      mixed |= 1 << chunks.Level(c % 4, (c / 4) % 4, c / 16);
+
+    std::vector<Mesh> meshes;
+    chunks.Polygonize(meshes);
+
+    // Weld vertices with the same position, and count the triangles sharing every edge
+    std::map<std::array<double, 3>, int> welded;
+    std::map<std::pair<int, int>, int> edges;
+    int triangles = 0;
+    for (const Mesh& mesh : meshes)
+    {
+      for (int t = 0; t < mesh.Triangles(); t++)
+      {
+        int v[3];
+        for (int j = 0; j < 3; j++)
+        {
+          const Vector p = mesh.Vertex(t, j);
+          v[j] = welded.insert({ { p[0], p[1], p[2] }, int(welded.size()) }).first->second;
+        }
+        if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+          continue;
+        triangles++;
+        for (int j = 0; j < 3; j++)
+          edges[std::minmax(v[j], v[(j + 1) % 3])]++;
+      }
+    }
+    int open = 0, nonmanifold = 0;
+    for (const std::pair<const std::pair<int, int>, int>& edge : edges)
+    {
+      if (edge.second == 1)
+        open++;
+      else if (edge.second > 2)
+        nonmanifold++;
+    }
+
+    char name[160];
+    std::snprintf(name, sizeof(name), "surface polygonized in chunks of levels %s%s%s: %d triangles, %d open edges, %d non-manifold edges",
+      (mixed & 1) ? "0 " : "", (mixed & 2) ? "1 " : "", (mixed & 4) ? "2" : "", triangles, open, nonmanifold);
+    Check(triangles > 0 && (mixed & (mixed - 1)) != 0 && open == 0 && nonmanifold == 0, name);
+  }
+}
+
+int main()
+{
+  ShardedSurfaces();
+  SimplifySeams();
+  LevelsOfDetail();
+  ClusterTriangles();
+  RayQueries();
+  ColorsFollowVertices();
+  HandcraftedFiles();
+  RoundTrips();
+  AnimationFrames();
+  WatertightChunks();
+  return (failures == 0) ? 0 : 1;
+}